@@ -0,0 +1,35 @@
+#
+# Find the lz4 includes and library
+#
+# This module defines
+# LZ4_INCLUDE_DIRS, where to find lz4.h
+# LZ4_LIBRARIES, the libraries to link against to use lz4.
+# LZ4_FOUND, If false, do not try to use lz4.
+
+INCLUDE(FindPkgConfig)
+PKG_CHECK_MODULES(PC_LZ4 liblz4)
+
+FIND_PATH(LZ4_INCLUDE_DIRS
+  NAMES lz4.h
+  HINTS ${PC_LZ4_INCLUDE_DIRS}
+  ${CMAKE_INSTALL_PREFIX}/include
+  PATHS
+  /usr/local/include
+  /usr/include
+  )
+
+FIND_LIBRARY(LZ4_LIBRARIES
+  NAMES lz4
+  HINTS ${PC_LZ4_LIBDIR}
+  ${CMAKE_INSTALL_PREFIX}/lib
+  ${CMAKE_INSTALL_PREFIX}/lib64
+  PATHS
+  /usr/local/lib
+  /usr/local/lib64
+  /usr/lib
+  /usr/lib64
+  )
+
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(LZ4 DEFAULT_MSG LZ4_LIBRARIES LZ4_INCLUDE_DIRS)
+MARK_AS_ADVANCED(LZ4_LIBRARIES LZ4_INCLUDE_DIRS)
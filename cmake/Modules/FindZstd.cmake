@@ -0,0 +1,35 @@
+#
+# Find the zstd includes and library
+#
+# This module defines
+# ZSTD_INCLUDE_DIRS, where to find zstd.h
+# ZSTD_LIBRARIES, the libraries to link against to use zstd.
+# ZSTD_FOUND, If false, do not try to use zstd.
+
+INCLUDE(FindPkgConfig)
+PKG_CHECK_MODULES(PC_ZSTD libzstd)
+
+FIND_PATH(ZSTD_INCLUDE_DIRS
+  NAMES zstd.h
+  HINTS ${PC_ZSTD_INCLUDE_DIRS}
+  ${CMAKE_INSTALL_PREFIX}/include
+  PATHS
+  /usr/local/include
+  /usr/include
+  )
+
+FIND_LIBRARY(ZSTD_LIBRARIES
+  NAMES zstd
+  HINTS ${PC_ZSTD_LIBDIR}
+  ${CMAKE_INSTALL_PREFIX}/lib
+  ${CMAKE_INSTALL_PREFIX}/lib64
+  PATHS
+  /usr/local/lib
+  /usr/local/lib64
+  /usr/lib
+  /usr/lib64
+  )
+
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(ZSTD DEFAULT_MSG ZSTD_LIBRARIES ZSTD_INCLUDE_DIRS)
+MARK_AS_ADVANCED(ZSTD_LIBRARIES ZSTD_INCLUDE_DIRS)
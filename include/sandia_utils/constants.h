@@ -34,6 +34,8 @@ namespace sandia_utils {
    static const pmt::pmt_t BURST_STOP_KEY = pmt::string_to_symbol("eob");
    static const pmt::pmt_t PDU_KEY = pmt::string_to_symbol("pdu");
    static const pmt::pmt_t FNAME_KEY = pmt::string_to_symbol("fname");
+   static const pmt::pmt_t CHANNEL_KEY = pmt::string_to_symbol("channel");
+   static const pmt::pmt_t CRC32C_KEY = pmt::string_to_symbol("crc32c");
    static const pmt::pmt_t IN_KEY = pmt::string_to_symbol("in");
    static const pmt::pmt_t OUT_KEY = pmt::string_to_symbol("out");
    static const pmt::pmt_t TUNE_KEY = pmt::string_to_symbol("tune");
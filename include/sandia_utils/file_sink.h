@@ -23,14 +23,18 @@ enum trigger_type_t { MANUAL = 0, TRIGGERED = 1 };
  * \ingroup sandia_utils
  *
  * Augmented in-tree file sink capabilities to support:
- *   - Various file output types (RAW, RAW+HEADER, BLUEFILE, MESSAGE)
+ *   - Various file output types (RAW, RAW+HEADER, RAW DIRECT I/O, SIGMF, BLUEFILE,
+ *     MESSAGE)
  *   - Dynamic file name based on signal parameters:
  *       - Sampling rate
  *       - Frequency
  *       - Start time
  *   - Manual or triggered based file saving
+ *   - Pre and post trigger samples around triggered bursts
+ *   - Concurrent, overlapping triggered bursts
  *   - Rolling output files based on specified file size (samples)
  *   - Alignment of start of file to nearest second boundary
+ *   - Multiple input channels, each recorded to its own files
  *
  * This block will save data to files.  File length specified in number
  * of samples, where 0 will result in a single file being generated.  Successive
@@ -57,6 +61,44 @@ enum trigger_type_t { MANUAL = 0, TRIGGERED = 1 };
  *            be specified to determine the number of files generated.  For
  *           example, %03fd will wrap after 1000 files (0-999),
  *           prepending zeros to ensure 3 characters per file number.
+ * %ch       Input channel number (starting at 0)
+ *
+ * With more than one channel, each input has its own file writer, time
+ * base and recording state, driven by the tags on that input, and the name
+ * specifier must contain %ch.  Background I/O for all channels is shared
+ * by a common set of I/O threads.
+ *
+ * In TRIGGERED mode a file is recorded from each "sob" (start of burst) tag
+ * through the matching "eob" (end of burst) tag.  If the tag value is an
+ * integer it is used as the burst id, and an end of burst ends the burst
+ * with the same id.  Otherwise an end of burst ends the oldest burst in
+ * progress.
+ *
+ * The "sigmf" file type writes a .sigmf-data file and, when it is closed, a
+ * matching .sigmf-meta file.  A change of frequency or time starts a new
+ * capture in the same file rather than a new file, and each burst (in either
+ * mode) is recorded as an annotation, excluding pre and post trigger
+ * samples.  A change of sample rate still starts a new file.
+ *
+ * The "raw_header_v2" file type writes Raw IQ + Header files that hold an
+ * index of segments, appended when the file is closed.  A change of
+ * frequency, rate or time starts a new segment rather than a new file.  The
+ * header is unchanged and describes the first sample, but readers of the
+ * original format will see the index as extra samples at the end.
+ *
+ * The "compressed" file type splits the stream into 1 MiB blocks that are
+ * compressed on worker threads (zstd or LZ4, when available at build time),
+ * followed by an index of the blocks so the file can be read from any
+ * position.  Blocks of 16 bit samples (complex_int, short) are first packed
+ * to the fewest bits that hold every sample in the block.  This is lossless;
+ * blocks that do not get smaller are stored as is.
+ *
+ * With the "message" data type, messages are written to a single file named
+ * by the name specifier, buffered and written in batches at least once a
+ * second.  The "message_log" file type adds a file header, the time each
+ * message was logged and an index of message positions, appended when the
+ * file is closed, so the file source can seek by message and replay at the
+ * recorded timing.  Other file types write the original message format.
  *
  */
 class SANDIA_UTILS_API file_sink : virtual public gr::sync_block
@@ -76,6 +118,7 @@ public:
      * \param out_dir Base output directory
      * \param name_spec Name specification format string
      * \param debug turn on debug functionality
+     * \param nchan Number of input channels
      */
     static sptr make(std::string data_type,
                      size_t itemsize,
@@ -85,7 +128,8 @@ public:
                      int rate,
                      std::string out_dir,
                      std::string name_spec,
-                     bool debug = false);
+                     bool debug = false,
+                     int nchan = 1);
 
     /*!
      * \brief Set/Get recording state
@@ -162,6 +206,128 @@ public:
      */
     virtual void set_file_num_rollover(int rollover) = 0;
     virtual int get_file_num_rollover() = 0;
+
+    /*!
+     * \brief Set/Get background file I/O
+     *
+     * When enabled, the work function only copies samples into a bounded ring
+     * of \p nbuffers preallocated buffers of \p buffer_size bytes each.  A
+     * dedicated thread writes the buffers to disk and handles file rollover,
+     * so slow disk operations do not stall the flowgraph.  When all buffers
+     * are in use the work function blocks until one is released, or, if
+     * \p drop is true, the samples are discarded.
+     *
+     */
+    virtual void set_async(bool enable,
+                           int nbuffers = 16,
+                           int buffer_size = 4194304,
+                           bool drop = false) = 0;
+    virtual bool get_async() = 0;
+
+    /*!
+     * \brief Set/Get number of background I/O threads
+     *
+     * Number of threads shared by all channels to write data to disk when
+     * background I/O is enabled.  A value less than or equal to 0 uses one
+     * thread per channel.  Takes effect the next time background I/O is
+     * enabled.
+     *
+     */
+    virtual void set_io_threads(int nthreads) = 0;
+    virtual int get_io_threads() = 0;
+
+    /*!
+     * \brief Get number of input channels
+     *
+     */
+    virtual int get_nchan() = 0;
+
+    /*!
+     * \brief Set/Get maximum number of concurrent bursts
+     *
+     * In TRIGGERED mode, each channel keeps a pool of \p nbursts file
+     * writers so that overlapping bursts are recorded to separate files.
+     * A start of burst while all writers are in use is dropped.  With more
+     * than one writer, file numbers are shared by the writers of a channel.
+     * Each writer has its own background I/O buffers.  Bursts in progress
+     * are ended.
+     *
+     */
+    virtual void set_max_bursts(int nbursts) = 0;
+    virtual int get_max_bursts() = 0;
+
+    /*!
+     * \brief Set/Get burst pre-trigger samples
+     *
+     * In TRIGGERED mode, the most recent \p nsamples samples before the start
+     * of burst are kept in a preallocated ring and written to the start of
+     * the burst file.  The file time is moved back accordingly.  Changing the
+     * value discards any samples already kept.
+     *
+     */
+    virtual void set_pretrigger(int nsamples) = 0;
+    virtual int get_pretrigger() = 0;
+
+    /*!
+     * \brief Set/Get burst post-trigger samples
+     *
+     * In TRIGGERED mode, recording continues for \p nsamples samples after
+     * the end of burst.  A start of burst within this tail continues the
+     * same file when no other file writer is free.
+     *
+     */
+    virtual void set_posttrigger(int nsamples) = 0;
+    virtual int get_posttrigger() = 0;
+
+    /*!
+     * \brief Set/Get opening of next file in advance
+     *
+     * When enabled, the file following the one currently being written is
+     * created by a helper thread before it is needed, so that rolling over to
+     * the next file only swaps file handles.  An unused file is removed when
+     * recording stops.  Only applies when the number of samples per file is
+     * non-zero.
+     *
+     */
+    virtual void set_preopen(bool preopen) = 0;
+    virtual bool get_preopen() = 0;
+
+    /*!
+     * \brief Set/Get preallocation of output files
+     *
+     * When enabled and the number of samples per file is non-zero, the full
+     * size of each file is reserved when it is opened so the file system
+     * does not have to allocate space on every write.  Files closed early
+     * are truncated to the data written.
+     *
+     */
+    virtual void set_preallocate(bool preallocate) = 0;
+    virtual bool get_preallocate() = 0;
+
+    /*!
+     * \brief Set/Get per-file checksums
+     *
+     * When enabled, a CRC32C checksum of the samples in each file is
+     * computed as they are written, by the background I/O thread when
+     * enabled, and added to the file's pdu message under the "crc32c" key.
+     * File headers and metadata are not included, so for Raw IQ files it is
+     * the checksum of the whole file.  Takes effect on the next file.
+     *
+     */
+    virtual void set_checksum(bool checksum) = 0;
+    virtual bool get_checksum() = 0;
+
+    /*!
+     * \brief Get background I/O statistics
+     *
+     * Number of times the work function blocked waiting for a free buffer, and
+     * number of samples discarded because no buffer was available, and
+     * number of queued writes or file changes that failed in the background.
+     *
+     */
+    virtual uint64_t get_nstalls() = 0;
+    virtual uint64_t get_ndropped() = 0;
+    virtual uint64_t get_nerrors() = 0;
 };
 } // namespace sandia_utils
 } // namespace gr
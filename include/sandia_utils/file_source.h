@@ -30,6 +30,25 @@ namespace sandia_utils {
  * if the beginning tags are populated, the first sample of every file will
  *  contain that tag.
  *
+ * The raw_header and raw_header_mmap file types also read files written by
+ * the file sink's raw_header_v2 file type.  When file tags are added, the
+ * metadata of each segment after the first is tagged on the first sample of
+ * that segment.
+ *
+ * The raw_mmap and raw_header_mmap file types read Raw IQ and Raw IQ + Header
+ * files through a memory mapping rather than stdio, which reduces CPU load
+ * when replaying large captures at high rates.
+ *
+ * The compressed file type reads files written by the file sink's compressed
+ * file type, decoding blocks ahead of the current position on worker
+ * threads.  It provides the same stream tags as Raw IQ + Header.
+ *
+ * The message file type reads files written by the file sink's message data
+ * type, in either the original or the indexed message_log format.  Messages
+ * are emitted at the message hop period, as fast as possible when the period
+ * is 0, or at the times they were logged when recorded timing is enabled and
+ * the file holds them.  Seeking and the current position count messages.
+ *
  * PDU sink port allows remote control of the file to be played. PDU
  * must contain a dict with the key of fname. The value associated with fname
  * is the file name that will be replayed.
@@ -68,11 +87,76 @@ public:
     /*!
      * \brief seek file to \p seek_point relative to \p whence
      *
+     * Offsets are 64-bit sample counts, so files larger than 2 GB can be
+     * addressed on all platforms.  SEEK_SET is relative to the first sample
+     * (after any file header).
+     *
      * \param seek_point	sample offset in file
      * \param whence	one of SEEK_SET, SEEK_CUR, SEEK_END (man fseek)
-     * @return bool - 0 or false on success
+     * @return bool - true on success
+     */
+    virtual bool seek(int64_t seek_point, int whence) = 0;
+
+    /*!
+     * \brief current sample offset in file
+     *
+     * @return uint64_t - sample offset from the first sample of the file
      */
-    virtual bool seek(long seek_point, int whence) = 0;
+    virtual uint64_t tell() = 0;
+
+    /*!
+     * \brief seek file to the first sample at or after \p time
+     *
+     * The sample offset is computed from the start time and sample rate of
+     * the file, or of the segment holding the time for files with metadata
+     * changes, so it is available for file types that record timing
+     * (raw_header, raw_header_mmap, compressed, bluefile).  The time, rate
+     * and frequency in effect at the new position are tagged on the next
+     * sample produced.
+     *
+     * \param time	time in seconds since the epoch
+     * @return bool - true on success, false if the file has no timing or
+     *                the time is outside the file
+     */
+    virtual bool seek_time(double time) = 0;
+
+    /*!
+     * \brief Play samples back in real time
+     *
+     * Samples are released on a monotonic clock schedule at the sample rate
+     * recorded in the file (raw_header, raw_header_mmap, compressed,
+     * bluefile), or at \p rate for files without one, so a throttle is not
+     * needed.  Samples are released in groups of about a millisecond.  Time
+     * gaps between segments of a file are replayed; each new file, repeat or
+     * seek to a time starts from the current time.
+     *
+     * \param realtime  pace samples in real time
+     * \param rate  sample rate (Hz) for files that do not record one, 0 to
+     *              only pace files that do
+     */
+    virtual void set_realtime(bool realtime, double rate = 0.0) = 0;
+    virtual bool get_realtime() = 0;
+
+    /*!
+     * \brief Convert file samples to float as they are read
+     *
+     * Files hold samples of \p input_type, which are converted to float
+     * output while they are copied out of the read buffer, so a separate
+     * conversion block is not needed.  Each output item of itemsize bytes is
+     * read from a file item with the same number of components, so sc16
+     * files are played as complex float with an itemsize of
+     * sizeof(gr_complex).  The file that is open is reopened from the start.
+     *
+     * \param input_type  file sample type: sc16, sc8 or fc32, or none to
+     *                    disable conversion
+     * \param scale  file values are divided by the scale
+     * \param byte_swap  swap the byte order of file values recorded on a
+     *                   host of the other byte order.  Bluefiles record
+     *                   their byte order and are swapped as they are read
+     */
+    virtual void set_conversion(const std::string& input_type,
+                                double scale = 1.0,
+                                bool byte_swap = false) = 0;
 
     /*!
      * \brief Opens a new file.
@@ -101,6 +185,19 @@ public:
      */
     virtual void set_file_queue_depth(size_t depth) = 0;
 
+    /*!
+     * \brief Set the number of queued files opened ahead of playback
+     *
+     * A background thread opens up to \p depth files from the file queue and
+     * requests their initial data from disk, so that moving to the next file
+     * at the end of the current one does not stall the output.  A depth of 0
+     * opens each file when it is needed.
+     *
+     * \param depth Number of files
+     */
+    virtual void set_prefetch_depth(int depth) = 0;
+    virtual int get_prefetch_depth() = 0;
+
     /*!
      * \brief Add tags to output stream when file is opened.
      *
@@ -115,11 +212,21 @@ public:
      * \brief Set the message hop period
      *
      * Set the amount of time between message emissions from a file in
-     * milliseconds.
+     * milliseconds.  A period of 0 emits messages as fast as possible.
      *
      * \param period_ms  Emission period (ms)
      */
     virtual void set_msg_hop_period(int period_ms) = 0;
+
+    /*!
+     * \brief Replay messages at their recorded timing
+     *
+     * Emit messages with the spacing they were logged with, for files that
+     * hold message times.  The hop period is used for other files.
+     *
+     * \param enable  Use recorded timing
+     */
+    virtual void set_msg_recorded_timing(bool enable) = 0;
 };
 
 } // namespace sandia_utils
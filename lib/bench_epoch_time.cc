@@ -0,0 +1,126 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Sample time benchmark.
+ *
+ * epoch_time is advanced by a fixed number of samples per call, as the file
+ * sink does once per work() call, and compared with the previous floating
+ * point implementation that added N * T to the fractional second and
+ * reduced it with fmod().  The cost per call and the error after all calls,
+ * against the exact time, are reported for each rate.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "epoch_time.h"
+#include <boost/format.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace gr::sandia_utils;
+
+typedef std::chrono::steady_clock bench_clock;
+
+namespace {
+
+/*
+ * Previous sample time, seconds and a fractional second advanced by N * T
+ */
+struct double_time {
+    uint64_t sec;
+    double frac;
+    double T;
+
+    void advance(int N)
+    {
+        frac += (double)N * T;
+        sec += uint64_t(frac / 1.0);
+        frac = fmod(frac, 1.0);
+    }
+};
+
+void bench_rate(double rate, int nsamples, uint64_t ncalls)
+{
+    epoch_time t(1000, 0.25);
+    t.set_rate(rate);
+    bench_clock::time_point start = bench_clock::now();
+    for (uint64_t i = 0; i < ncalls; i++) {
+        t.advance(nsamples);
+    }
+    double ns_ticks =
+        std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() /
+        ncalls;
+
+    double_time d = { 1000, 0.25, 1.0 / rate };
+    start = bench_clock::now();
+    for (uint64_t i = 0; i < ncalls; i++) {
+        d.advance(nsamples);
+    }
+    double ns_double =
+        std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() /
+        ncalls;
+
+    // exact elapsed time, rates are whole thousandths of a sample per second
+    uint64_t rate_num = (uint64_t)std::round(rate * 1000.0);
+    uint64_t nticks = (uint64_t)nsamples * ncalls * 1000;
+    uint64_t sec = 1000 + nticks / rate_num;
+    double frac = 0.25 + (double)(nticks % rate_num) / (double)rate_num;
+
+    double err_ticks =
+        ((double)t.epoch_sec() - (double)sec) + (t.epoch_frac() - frac);
+    double err_double = ((double)d.sec - (double)sec) + (d.frac - frac);
+    std::cout << boost::format("%12.3f %8d %12lu %10.2f %10.2f %12.3g %12.3g") % rate %
+                     nsamples % ncalls % ns_ticks % ns_double % err_ticks % err_double
+              << std::endl;
+}
+
+void usage(const char* name)
+{
+    std::cerr << "usage: " << name << " [options]\n"
+              << "  -n N     calls per rate (default: 100000000)\n"
+              << "  -s N     samples per call (default: 4096)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint64_t ncalls = 100000000;
+    int nsamples = 4096;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            ncalls = strtoull(optarg, NULL, 10);
+            break;
+        case 's':
+            nsamples = std::max(1, atoi(optarg));
+            break;
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    std::cout << boost::format("%12s %8s %12s %10s %10s %12s %12s") % "rate" % "samples" %
+                     "calls" % "ns/call" % "ns(double)" % "error(s)" % "err(double)"
+              << std::endl;
+    bench_rate(30.72e6, nsamples, ncalls);
+    bench_rate(1e6, nsamples, ncalls);
+    bench_rate(2.5e6 / 3.0, nsamples, ncalls);
+    return 0;
+}
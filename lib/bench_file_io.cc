@@ -0,0 +1,443 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Throughput benchmark for the file sink writers and file source readers.
+ *
+ * Each writer type is driven directly (no flowgraph) across item sizes, file
+ * lengths and name specifiers.  For every case the sustained rate, the
+ * median and 99th percentile latency of a single write() call, and the
+ * worst latency of a write() call that rolled over to a new file are
+ * reported.  Files are then read back with each reader type.
+ *
+ * The cost of generating a file name from each name specifier, which is paid
+ * on every rollover, is measured separately.
+ *
+ * Results depend heavily on the page cache; use a data set larger than
+ * memory (-s) or drop caches between runs for disk-bound numbers.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "file_sink/file_name_spec.h"
+#include "file_sink/file_writer_base.h"
+#include "file_source/file_reader_base.h"
+#include "file_source/file_reader_compressed.h"
+#include "file_source/file_reader_mmap.h"
+#include "file_source/file_reader_raw_header.h"
+#include <gnuradio/logger.h>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = boost::filesystem;
+using namespace gr::sandia_utils;
+
+typedef std::chrono::steady_clock bench_clock;
+
+namespace {
+
+struct bench_options_t {
+    std::string dir;
+    uint64_t nbytes;
+    int write_items;
+    bool async;
+    bool preopen;
+    bool preallocate;
+    bool checksum;
+    bool names_only;
+};
+
+struct bench_result_t {
+    double mbps;
+    double p50_us;
+    double p99_us;
+    double rollover_us;
+    int nfiles;
+};
+
+double elapsed_us(bench_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(bench_clock::now() - start).count();
+}
+
+double percentile(std::vector<double>& values, double p)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+
+    size_t index = std::min(values.size() - 1, (size_t)(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+gr::logger_ptr bench_logger()
+{
+    static gr::logger_ptr logger, debug_logger;
+    if (not logger) {
+        gr::configure_default_loggers(logger, debug_logger, "bench_file_io");
+    }
+    return logger;
+}
+
+std::string data_type(size_t itemsize)
+{
+    switch (itemsize) {
+    case 1:
+        return "byte";
+    case 2:
+        return "short";
+    case 4:
+        return "float";
+    default:
+        return "complex";
+    }
+}
+
+// remove files left by the previous case, dir is the benchmark's own
+// scratch directory
+void clear_dir(const std::string& dir)
+{
+    std::vector<fs::path> paths;
+    for (fs::directory_iterator it(dir); it != fs::directory_iterator(); ++it) {
+        paths.push_back(it->path());
+    }
+    for (size_t i = 0; i < paths.size(); i++) {
+        fs::remove_all(paths[i]);
+    }
+}
+
+bench_result_t bench_writer(const bench_options_t& opts,
+                            const std::string& file_type,
+                            size_t itemsize,
+                            uint64_t nsamples,
+                            const std::string& name_spec)
+{
+    bench_result_t result = bench_result_t();
+    clear_dir(opts.dir);
+
+    file_writer_base::sptr writer = file_writer_base::make(data_type(itemsize),
+                                                           file_type,
+                                                           itemsize,
+                                                           nsamples,
+                                                           1000000,
+                                                           opts.dir,
+                                                           name_spec,
+                                                           bench_logger());
+    writer->register_callback(
+        [&result](std::string fname, epoch_time t, double freq, double rate, int64_t crc) {
+            result.nfiles++;
+        });
+    writer->set_freq(100000000);
+    writer->set_preopen(opts.preopen);
+    writer->set_preallocate(opts.preallocate);
+    writer->set_checksum(opts.checksum);
+    if (opts.async) {
+        writer->set_async(true);
+    }
+
+    // distinct data so nothing can be elided
+    std::vector<char> buffer(opts.write_items * itemsize);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = (char)i;
+    }
+
+    uint64_t nitems = opts.nbytes / itemsize;
+    uint64_t nwrites = std::max<uint64_t>(1, nitems / opts.write_items);
+    std::vector<double> latency;
+    latency.reserve(nwrites);
+
+    bench_clock::time_point start = bench_clock::now();
+    writer->start(epoch_time(1600000000, 0.0));
+    uint64_t nwritten = 0;
+    for (uint64_t i = 0; i < nwrites; i++) {
+        bench_clock::time_point t0 = bench_clock::now();
+        writer->write(&buffer[0], opts.write_items);
+        double us = elapsed_us(t0);
+        latency.push_back(us);
+
+        // write crossed a file boundary
+        uint64_t before = nwritten;
+        nwritten += opts.write_items;
+        if (nsamples and ((before / nsamples) != (nwritten / nsamples))) {
+            result.rollover_us = std::max(result.rollover_us, us);
+        }
+    }
+    writer->stop();
+    writer->flush();
+    writer.reset();
+    double total_us = elapsed_us(start);
+
+    result.mbps = (double)(nwrites * opts.write_items * itemsize) / total_us;
+    result.p50_us = percentile(latency, 0.50);
+    result.p99_us = percentile(latency, 0.99);
+    return result;
+}
+
+bench_result_t bench_reader(const bench_options_t& opts,
+                            const std::string& reader_type,
+                            size_t itemsize)
+{
+    bench_result_t result = bench_result_t();
+
+    file_reader_base::sptr reader;
+    if (reader_type == "raw") {
+        reader.reset(new file_reader_base(itemsize, bench_logger()));
+    } else if (reader_type == "raw_header") {
+        reader.reset(new file_reader_raw_header(itemsize, bench_logger()));
+    } else if (reader_type == "raw_mmap") {
+        reader.reset(new file_reader_mmap(itemsize, false, bench_logger()));
+    } else if (reader_type == "compressed") {
+        reader.reset(new file_reader_compressed(itemsize, bench_logger()));
+    } else {
+        reader.reset(new file_reader_mmap(itemsize, true, bench_logger()));
+    }
+
+    std::vector<std::string> files;
+    for (fs::directory_iterator it(opts.dir); it != fs::directory_iterator(); ++it) {
+        files.push_back(it->path().string());
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<char> buffer(opts.write_items * itemsize);
+    std::vector<double> latency;
+    uint64_t nread = 0;
+
+    bench_clock::time_point start = bench_clock::now();
+    for (size_t i = 0; i < files.size(); i++) {
+        reader->open(files[i].c_str());
+        result.nfiles++;
+        while (true) {
+            bench_clock::time_point t0 = bench_clock::now();
+            int n = reader->read(&buffer[0], opts.write_items);
+            latency.push_back(elapsed_us(t0));
+            if (n <= 0) {
+                break;
+            }
+            nread += n;
+        }
+        reader->close();
+    }
+    double total_us = elapsed_us(start);
+
+    result.mbps = (double)(nread * itemsize) / total_us;
+    result.p50_us = percentile(latency, 0.50);
+    result.p99_us = percentile(latency, 0.99);
+    return result;
+}
+
+void bench_name_spec(const bench_options_t& opts,
+                     const std::string& label,
+                     const std::string& spec)
+{
+    const int NNAMES = 1000000;
+
+    file_name_spec name_spec;
+    name_spec.compile(spec, opts.dir, 100000000, 1000000);
+
+    // one name per second, as when rolling over every second
+    std::string fname;
+    std::vector<double> latency;
+    latency.reserve(NNAMES);
+    bench_clock::time_point start = bench_clock::now();
+    for (int i = 0; i < NNAMES; i++) {
+        bench_clock::time_point t0 = bench_clock::now();
+        name_spec.render(fname, i, 1600000000 + i);
+        latency.push_back(elapsed_us(t0));
+    }
+    double total_us = elapsed_us(start);
+
+    std::cout << boost::format("%-8s %10.1f %9.3f %9.3f  %s") % label %
+                     (1000.0 * total_us / NNAMES) % percentile(latency, 0.50) %
+                     percentile(latency, 0.99) % fname
+              << std::endl;
+}
+
+void print_result(const std::string& op,
+                  const std::string& type,
+                  size_t itemsize,
+                  uint64_t nsamples,
+                  const std::string& spec,
+                  const bench_result_t& r)
+{
+    std::cout << boost::format("%-5s %-16s %4d %10d %-8s %6d %10.1f %9.1f %9.1f %11.1f") %
+                     op % type % itemsize % nsamples % spec % r.nfiles % r.mbps %
+                     r.p50_us % r.p99_us % r.rollover_us
+              << std::endl;
+}
+
+void usage(const char* name)
+{
+    std::cerr << "usage: " << name << " [options]\n"
+              << "  -d DIR   directory to create the scratch directory in (default: .)\n"
+              << "  -s MB    data written per case (default: 256)\n"
+              << "  -w N     items per write() call (default: 8192)\n"
+              << "  -a       enable background I/O thread\n"
+              << "  -p       open next file in advance\n"
+              << "  -f       preallocate files\n"
+              << "  -c       compute per-file checksums\n"
+              << "  -n       only measure file name generation\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bench_options_t opts;
+    opts.dir = fs::current_path().string();
+    opts.nbytes = 256ULL * 1024 * 1024;
+    opts.write_items = 8192;
+    opts.async = false;
+    opts.preopen = false;
+    opts.preallocate = false;
+    opts.checksum = false;
+    opts.names_only = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:s:w:apfcnh")) != -1) {
+        switch (opt) {
+        case 'd':
+            opts.dir = optarg;
+            break;
+        case 's':
+            opts.nbytes = strtoull(optarg, NULL, 10) * 1024 * 1024;
+            break;
+        case 'w':
+            opts.write_items = std::max(1, atoi(optarg));
+            break;
+        case 'a':
+            opts.async = true;
+            break;
+        case 'p':
+            opts.preopen = true;
+            break;
+        case 'f':
+            opts.preallocate = true;
+            break;
+        case 'c':
+            opts.checksum = true;
+            break;
+        case 'n':
+            opts.names_only = true;
+            break;
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    std::vector<std::string> writer_types;
+    writer_types.push_back("raw");
+    writer_types.push_back("raw_header");
+    writer_types.push_back("raw_direct");
+    writer_types.push_back("compressed");
+#ifdef HAVE_LIBURING
+    writer_types.push_back("uring");
+#endif
+#ifdef HAVE_BLUEFILE_LIB
+    writer_types.push_back("bluefile");
+#endif
+
+    std::vector<size_t> itemsizes;
+    itemsizes.push_back(2);
+    itemsizes.push_back(8);
+    itemsizes.push_back(32);
+
+    // single file, one second and a tenth of a second at 1 Msps
+    std::vector<uint64_t> file_lengths;
+    file_lengths.push_back(0);
+    file_lengths.push_back(1000000);
+    file_lengths.push_back(100000);
+
+    std::vector<std::pair<std::string, std::string>> name_specs;
+    name_specs.push_back(std::make_pair("simple", "bench_%05fd.dat"));
+    name_specs.push_back(
+        std::make_pair("complex", "%Y%m%d_%H_%M_%S_fc=%fcMHz_fs=%fskHz_%06fd.dat"));
+    name_specs.push_back(std::make_pair("strftime", "%F_%T_%a_%b_%3fd.dat"));
+
+    std::cout << boost::format("%-8s %10s %9s %9s  %s") % "spec" % "ns/name" % "p50(us)" %
+                     "p99(us)" % "last name"
+              << std::endl;
+    for (size_t s = 0; s < name_specs.size(); s++) {
+        bench_name_spec(opts, name_specs[s].first, name_specs[s].second);
+    }
+    std::cout << std::endl;
+    if (opts.names_only) {
+        return 0;
+    }
+
+    // files are written to a new directory so nothing of the user's is
+    // replaced or removed
+    fs::path scratch = fs::path(opts.dir) / fs::unique_path("bench_file_io_%%%%%%%%");
+    fs::create_directories(scratch);
+    opts.dir = scratch.string();
+
+    std::cout << boost::format("%-5s %-16s %4s %10s %-8s %6s %10s %9s %9s %11s") % "op" %
+                     "type" % "size" % "nsamples" % "spec" % "files" % "MB/s" %
+                     "p50(us)" % "p99(us)" % "rollover(us)"
+              << std::endl;
+
+    for (size_t t = 0; t < writer_types.size(); t++) {
+        for (size_t i = 0; i < itemsizes.size(); i++) {
+            for (size_t n = 0; n < file_lengths.size(); n++) {
+                for (size_t s = 0; s < name_specs.size(); s++) {
+                    // name specifier only matters when rolling over, and
+                    // only the first two differ enough to matter for I/O
+                    if (((file_lengths[n] == 0) and (s > 0)) or (s > 1)) {
+                        continue;
+                    }
+
+                    bench_result_t r = bench_writer(opts,
+                                                    writer_types[t],
+                                                    itemsizes[i],
+                                                    file_lengths[n],
+                                                    name_specs[s].second);
+                    print_result("write",
+                                 writer_types[t],
+                                 itemsizes[i],
+                                 file_lengths[n],
+                                 name_specs[s].first,
+                                 r);
+
+                    // read back files in the layout just written
+                    if (writer_types[t] == "raw") {
+                        print_result("read", "raw", itemsizes[i], file_lengths[n],
+                                     name_specs[s].first,
+                                     bench_reader(opts, "raw", itemsizes[i]));
+                        print_result("read", "raw_mmap", itemsizes[i], file_lengths[n],
+                                     name_specs[s].first,
+                                     bench_reader(opts, "raw_mmap", itemsizes[i]));
+                    } else if (writer_types[t] == "raw_header") {
+                        print_result("read", "raw_header", itemsizes[i], file_lengths[n],
+                                     name_specs[s].first,
+                                     bench_reader(opts, "raw_header", itemsizes[i]));
+                        print_result("read", "raw_header_mmap", itemsizes[i],
+                                     file_lengths[n], name_specs[s].first,
+                                     bench_reader(opts, "raw_header_mmap", itemsizes[i]));
+                    } else if (writer_types[t] == "compressed") {
+                        print_result("read", "compressed", itemsizes[i], file_lengths[n],
+                                     name_specs[s].first,
+                                     bench_reader(opts, "compressed", itemsizes[i]));
+                    }
+                }
+            }
+        }
+    }
+
+    fs::remove_all(opts.dir);
+    return 0;
+}
@@ -0,0 +1,252 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Tag handling benchmark for the file sink.
+ *
+ * A flowgraph of null source -> packet tagger -> head -> file sink is run
+ * with a tag stream typical of packetized radios, where every packet
+ * carries an rx_time tag.  The cases are:
+ *
+ *   none    - no tags, the baseline
+ *   time    - continuous rx_time tag on every packet
+ *   jump    - rx_time on every packet with a time discontinuity every
+ *             -j packets, which starts a new file
+ *   burst   - triggered mode with a burst on every packet
+ *
+ * The sustained rate in samples per second and the number of files written
+ * are reported for each case.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gnuradio/blocks/head.h>
+#include <gnuradio/blocks/null_source.h>
+#include <gnuradio/io_signature.h>
+#include <gnuradio/sync_block.h>
+#include <gnuradio/top_block.h>
+#include <sandia_utils/constants.h>
+#include <sandia_utils/file_sink.h>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = boost::filesystem;
+using namespace gr::sandia_utils;
+
+typedef std::chrono::steady_clock bench_clock;
+
+namespace {
+
+const double SAMP_RATE = 10e6;
+
+struct bench_options_t {
+    std::string dir;
+    uint64_t nsamples;
+    int packet_size;
+    int jump_packets;
+};
+
+enum tag_mode_t { TAGS_NONE = 0, TAGS_TIME, TAGS_JUMP, TAGS_BURST };
+
+/*
+ * Pass through block that tags the first sample of every packet
+ */
+class packet_tagger : public gr::sync_block
+{
+public:
+    typedef boost::shared_ptr<packet_tagger> sptr;
+
+    static sptr make(size_t itemsize, tag_mode_t mode, int packet_size, int jump_packets)
+    {
+        return gnuradio::get_initial_sptr(
+            new packet_tagger(itemsize, mode, packet_size, jump_packets));
+    }
+
+    packet_tagger(size_t itemsize, tag_mode_t mode, int packet_size, int jump_packets)
+        : gr::sync_block("packet_tagger",
+                         gr::io_signature::make(1, 1, itemsize),
+                         gr::io_signature::make(1, 1, itemsize)),
+          d_itemsize(itemsize),
+          d_mode(mode),
+          d_packet_size(packet_size),
+          d_jump_packets(jump_packets),
+          d_jump(0)
+    {
+        set_tag_propagation_policy(TPP_DONT);
+    }
+
+    int work(int noutput_items,
+             gr_vector_const_void_star& input_items,
+             gr_vector_void_star& output_items)
+    {
+        memcpy(output_items[0], input_items[0], noutput_items * d_itemsize);
+
+        uint64_t start = nitems_written(0);
+        uint64_t end = start + noutput_items;
+
+        // first packet boundary at or after start
+        uint64_t offset = ((start + d_packet_size - 1) / d_packet_size) * d_packet_size;
+        for (; offset < end; offset += d_packet_size) {
+            uint64_t packet = offset / d_packet_size;
+            if (offset == 0) {
+                add_item_tag(0, offset, RATE_KEY, pmt::from_double(SAMP_RATE));
+            }
+
+            if ((d_mode == TAGS_TIME) or (d_mode == TAGS_JUMP)) {
+                if ((d_mode == TAGS_JUMP) and packet and (packet % d_jump_packets == 0)) {
+                    d_jump += 1;
+                }
+
+                // whole seconds and fraction kept apart so the fraction does
+                // not lose precision to the epoch seconds
+                uint64_t rate = (uint64_t)SAMP_RATE;
+                uint64_t sec = 1500000000 + d_jump + offset / rate;
+                double frac = (double)(offset % rate) / (double)rate;
+                add_item_tag(0,
+                             offset,
+                             RX_TIME_KEY,
+                             pmt::make_tuple(pmt::from_uint64(sec), pmt::from_double(frac)));
+            } else if (d_mode == TAGS_BURST) {
+                add_item_tag(0, offset, BURST_START_KEY, pmt::PMT_T);
+                add_item_tag(0, offset + d_packet_size - 1, BURST_STOP_KEY, pmt::PMT_T);
+            }
+        }
+
+        return noutput_items;
+    }
+
+private:
+    size_t d_itemsize;
+    tag_mode_t d_mode;
+    int d_packet_size;
+    int d_jump_packets;
+    uint64_t d_jump;
+};
+
+// remove files left by the previous case, dir is the benchmark's own
+// scratch directory
+void clear_dir(const std::string& dir)
+{
+    std::vector<fs::path> paths;
+    for (fs::directory_iterator it(dir); it != fs::directory_iterator(); ++it) {
+        paths.push_back(it->path());
+    }
+    for (size_t i = 0; i < paths.size(); i++) {
+        fs::remove_all(paths[i]);
+    }
+}
+
+void bench_case(const bench_options_t& opts, const std::string& name, tag_mode_t mode)
+{
+    clear_dir(opts.dir);
+
+    trigger_type_t trigger = (mode == TAGS_BURST) ? TRIGGERED : MANUAL;
+    gr::blocks::null_source::sptr src(gr::blocks::null_source::make(sizeof(gr_complex)));
+    packet_tagger::sptr tagger(packet_tagger::make(
+        sizeof(gr_complex), mode, opts.packet_size, opts.jump_packets));
+    gr::blocks::head::sptr head(gr::blocks::head::make(sizeof(gr_complex), opts.nsamples));
+    file_sink::sptr sink(file_sink::make("complex",
+                                         sizeof(gr_complex),
+                                         "raw",
+                                         trigger,
+                                         0,
+                                         (int)SAMP_RATE,
+                                         opts.dir,
+                                         "bench_%06fd.fc32"));
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+    if (trigger == MANUAL) {
+        sink->set_recording(true);
+    }
+
+    gr::top_block_sptr tb(gr::make_top_block("bench_file_sink_tags"));
+    tb->connect(src, 0, tagger, 0);
+    tb->connect(tagger, 0, head, 0);
+    tb->connect(head, 0, sink, 0);
+
+    bench_clock::time_point start = bench_clock::now();
+    tb->run();
+    double seconds =
+        std::chrono::duration<double>(bench_clock::now() - start).count();
+
+    int nfiles = 0;
+    for (fs::directory_iterator it(opts.dir); it != fs::directory_iterator(); ++it) {
+        nfiles++;
+    }
+
+    std::cout << boost::format("%-6s %8d %10.2f %7d") % name % opts.packet_size %
+                     ((double)opts.nsamples / seconds / 1e6) % nfiles
+              << std::endl;
+}
+
+void usage(const char* name)
+{
+    std::cerr << "usage: " << name << " [options]\n"
+              << "  -d DIR   directory to create the scratch directory in (default: .)\n"
+              << "  -n N     samples per case (default: 50000000)\n"
+              << "  -p N     samples per packet (default: 1024)\n"
+              << "  -j N     packets between time discontinuities (default: 1000)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bench_options_t opts;
+    opts.dir = fs::current_path().string();
+    opts.nsamples = 50000000;
+    opts.packet_size = 1024;
+    opts.jump_packets = 1000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:n:p:j:h")) != -1) {
+        switch (opt) {
+        case 'd':
+            opts.dir = optarg;
+            break;
+        case 'n':
+            opts.nsamples = strtoull(optarg, NULL, 10);
+            break;
+        case 'p':
+            opts.packet_size = std::max(1, atoi(optarg));
+            break;
+        case 'j':
+            opts.jump_packets = std::max(1, atoi(optarg));
+            break;
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    // files are written to a new directory so nothing of the user's is
+    // replaced or removed
+    fs::path scratch = fs::path(opts.dir) / fs::unique_path("bench_file_sink_tags_%%%%%%%%");
+    fs::create_directories(scratch);
+    opts.dir = scratch.string();
+
+    std::cout << boost::format("%-6s %8s %10s %7s") % "tags" % "packet" % "MS/s" % "files"
+              << std::endl;
+    bench_case(opts, "none", TAGS_NONE);
+    bench_case(opts, "time", TAGS_TIME);
+    bench_case(opts, "jump", TAGS_JUMP);
+    bench_case(opts, "burst", TAGS_BURST);
+
+    fs::remove_all(opts.dir);
+    return 0;
+}
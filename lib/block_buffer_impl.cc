@@ -12,6 +12,7 @@
 #endif
 
 #include "block_buffer_impl.h"
+#include "epoch_time.h"
 #include <gnuradio/block_detail.h>
 #include <gnuradio/buffer.h>
 #include <gnuradio/io_signature.h>
@@ -318,22 +319,18 @@ int block_buffer_impl::general_work(int noutput_items,
             // estimate and add an rx_time tag
             if (pmt::eqv(d_buf[d_writing].rx_time, pmt::PMT_NIL) &&
                 numsamples_skipped > 0) {
-                // estimate the time elapsed since last received rx_time tag
-                double time_elapsed =
-                    (d_buf[d_writing].abs_read_idx - d_current_rx_time_tag.offset) /
-                    d_samp_rate;
-                // add that time to the last received rx_time
-                double frac_seconds =
-                    pmt::to_double(pmt::tuple_ref(d_current_rx_time_tag.value, 1)) +
-                    time_elapsed;
-                // subtract any whole seconds
-                uint64_t seconds = floor(frac_seconds);
-                frac_seconds -= seconds;
-                // add on the whole seconds from the last rx_time
-                seconds += pmt::to_uint64(pmt::tuple_ref(d_current_rx_time_tag.value, 0));
+                // advance the last received rx_time by the number of samples
+                // elapsed since it was received
+                epoch_time buf_time(
+                    pmt::to_uint64(pmt::tuple_ref(d_current_rx_time_tag.value, 0)),
+                    pmt::to_double(pmt::tuple_ref(d_current_rx_time_tag.value, 1)));
+                buf_time.set_rate(d_samp_rate);
+                buf_time.advance(d_buf[d_writing].abs_read_idx -
+                                 d_current_rx_time_tag.offset);
                 // create the rx_time tag and add it to the stream
-                d_buf[d_writing].rx_time = pmt::make_tuple(
-                    pmt::from_uint64(seconds), pmt::from_double(frac_seconds));
+                d_buf[d_writing].rx_time =
+                    pmt::make_tuple(pmt::from_uint64(buf_time.epoch_sec()),
+                                    pmt::from_double(buf_time.epoch_frac()));
                 add_item_tag(0,
                              d_buf[d_writing].abs_write_idx,
                              PMT_RX_TIME,
@@ -0,0 +1,330 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "compressed_format.h"
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+// upper limit of worker threads chosen automatically
+#define MAX_CODEC_THREADS 4
+
+// zstd level - favor speed, captures are written in real time
+#define ZSTD_LEVEL 1
+
+namespace gr {
+  namespace sandia_utils {
+
+    namespace {
+      // smallest two's complement width holding all samples
+      int packed_width(const int16_t *in, size_t n)
+      {
+        int16_t lo = 0, hi = 0;
+        for (size_t i = 0; i < n; i++) {
+          lo = std::min(lo, in[i]);
+          hi = std::max(hi, in[i]);
+        }
+
+        int bits = 1;
+        while ((bits < 16) and
+               ((lo < -(1 << (bits - 1))) or (hi > (1 << (bits - 1)) - 1))) {
+          bits++;
+        }
+        return bits;
+      }
+
+      size_t packed_size(size_t n, int bits)
+      {
+        return (n * bits + 7) / 8;
+      }
+
+      void pack(const int16_t *in, size_t n, int bits, char *out)
+      {
+        uint64_t mask = (1ULL << bits) - 1;
+        uint64_t acc = 0;
+        int nacc = 0;
+        for (size_t i = 0; i < n; i++) {
+          acc |= ((uint64_t)(uint16_t)in[i] & mask) << nacc;
+          nacc += bits;
+          if (nacc >= 32) {
+            uint32_t word = (uint32_t)acc;
+            memcpy(out, &word, sizeof(word));
+            out += sizeof(word);
+            acc >>= 32;
+            nacc -= 32;
+          }
+        }
+        while (nacc > 0) {
+          *out++ = (char)(acc & 0xff);
+          acc >>= 8;
+          nacc -= 8;
+        }
+      }
+
+      void unpack(const char *in, size_t n, int bits, int16_t *out)
+      {
+        uint64_t mask = (1ULL << bits) - 1;
+        int shift = 64 - bits;
+        uint64_t acc = 0;
+        int nacc = 0;
+        size_t nbytes = packed_size(n, bits);
+        size_t pos = 0;
+        for (size_t i = 0; i < n; i++) {
+          if (nacc < bits) {
+            // refill with whole words where available
+            if (pos + sizeof(uint32_t) <= nbytes) {
+              uint32_t word;
+              memcpy(&word, in + pos, sizeof(word));
+              acc |= (uint64_t)word << nacc;
+              pos += sizeof(word);
+              nacc += 32;
+            }
+            while ((nacc < bits) and (pos < nbytes)) {
+              acc |= (uint64_t)(uint8_t)in[pos++] << nacc;
+              nacc += 8;
+            }
+          }
+
+          // sign extend
+          out[i] = (int16_t)((int64_t)((acc & mask) << shift) >> shift);
+          acc >>= bits;
+          nacc -= bits;
+        }
+      }
+
+      // compress into out, returns 0 if the codec is unavailable or does
+      // not reduce the size
+      size_t compress(block_codec_t codec, const char *in, size_t n, std::vector<char> &out)
+      {
+        switch (codec) {
+#ifdef HAVE_ZSTD
+          case CODEC_ZSTD:
+            {
+              out.resize(ZSTD_compressBound(n));
+              size_t ret = ZSTD_compress(&out[0], out.size(), in, n, ZSTD_LEVEL);
+              return (ZSTD_isError(ret) or (ret >= n)) ? 0 : ret;
+            }
+#endif
+#ifdef HAVE_LZ4
+          case CODEC_LZ4:
+            {
+              out.resize(LZ4_compressBound((int)n));
+              int ret = LZ4_compress_default(in, &out[0], (int)n, (int)out.size());
+              return ((ret <= 0) or ((size_t)ret >= n)) ? 0 : (size_t)ret;
+            }
+#endif
+          default:
+            // parameters are unused in a build without a codec
+            (void)in;
+            (void)n;
+            (void)out;
+            return 0;
+        }
+      }
+
+      void decompress(block_codec_t codec, const char *in, size_t n, char *out, size_t nout)
+      {
+        switch (codec) {
+#ifdef HAVE_ZSTD
+          case CODEC_ZSTD:
+            {
+              size_t ret = ZSTD_decompress(out, nout, in, n);
+              if (ZSTD_isError(ret) or (ret != nout)) {
+                throw std::runtime_error("compressed file: corrupt zstd block");
+              }
+              return;
+            }
+#endif
+#ifdef HAVE_LZ4
+          case CODEC_LZ4:
+            {
+              int ret = LZ4_decompress_safe(in, out, (int)n, (int)nout);
+              if ((ret < 0) or ((size_t)ret != nout)) {
+                throw std::runtime_error("compressed file: corrupt lz4 block");
+              }
+              return;
+            }
+#endif
+          default:
+            (void)in;
+            (void)n;
+            (void)out;
+            (void)nout;
+            throw std::runtime_error("compressed file: codec not available");
+        }
+      }
+    } // namespace
+
+    block_codec_t
+    default_codec()
+    {
+#if defined(HAVE_ZSTD)
+      return CODEC_ZSTD;
+#elif defined(HAVE_LZ4)
+      return CODEC_LZ4;
+#else
+      return CODEC_NONE;
+#endif
+    }
+
+    void
+    encode_block(const char *in, uint32_t nbytes, bool int16, block_codec_t codec,
+                 compressed_block_header_t &hdr, std::vector<char> &out,
+                 std::vector<char> &scratch)
+    {
+      hdr.nbytes = nbytes;
+      hdr.packed_bits = 0;
+      hdr.reserved = 0;
+
+      // bit-pack 16 bit samples if any bits are unused
+      const char *src = in;
+      size_t n = nbytes;
+      if (int16 and ((nbytes % sizeof(int16_t)) == 0)) {
+        const int16_t *samples = reinterpret_cast<const int16_t *>(in);
+        size_t nsamples = nbytes / sizeof(int16_t);
+        int bits = packed_width(samples, nsamples);
+        if (bits < 16) {
+          scratch.resize(packed_size(nsamples, bits));
+          pack(samples, nsamples, bits, &scratch[0]);
+          hdr.packed_bits = (uint8_t)bits;
+          src = &scratch[0];
+          n = scratch.size();
+        }
+      }
+
+      size_t ncompressed = compress(codec, src, n, out);
+      if (ncompressed) {
+        out.resize(ncompressed);
+        hdr.codec = (uint8_t)codec;
+      }
+      else {
+        out.assign(src, src + n);
+        hdr.codec = CODEC_NONE;
+      }
+      hdr.stored_size = (uint32_t)out.size();
+    }
+
+    void
+    decode_block(const compressed_block_header_t &hdr, const char *in, char *out,
+                 std::vector<char> &scratch)
+    {
+      if (hdr.packed_bits > 16) {
+        throw std::runtime_error("compressed file: invalid block header");
+      }
+
+      // size before bit-packing was undone
+      size_t nsamples = hdr.nbytes / sizeof(int16_t);
+      size_t n = hdr.packed_bits ? packed_size(nsamples, hdr.packed_bits) : hdr.nbytes;
+
+      const char *src = in;
+      if (hdr.codec != CODEC_NONE) {
+        char *dest = out;
+        if (hdr.packed_bits) {
+          scratch.resize(n);
+          dest = &scratch[0];
+        }
+        decompress((block_codec_t)hdr.codec, in, hdr.stored_size, dest, n);
+        src = dest;
+      }
+      else if (hdr.stored_size != n) {
+        throw std::runtime_error("compressed file: invalid block size");
+      }
+
+      if (hdr.packed_bits) {
+        unpack(src, nsamples, hdr.packed_bits, reinterpret_cast<int16_t *>(out));
+      }
+      else if (src != out) {
+        memcpy(out, src, n);
+      }
+    }
+
+    codec_pool::codec_pool(size_t nthreads)
+      : d_finished(false)
+    {
+      if (nthreads == 0) {
+        nthreads = std::min((size_t)std::max(boost::thread::hardware_concurrency(), 1u),
+                            (size_t)MAX_CODEC_THREADS);
+      }
+
+      for (size_t i = 0; i < nthreads; i++) {
+        d_threads.push_back(boost::shared_ptr<boost::thread>(
+            new boost::thread(boost::bind(&codec_pool::run, this))));
+      }
+    }
+
+    codec_pool::~codec_pool()
+    {
+      {
+        boost::unique_lock<boost::mutex> lock(d_mutex);
+        d_finished = true;
+        d_cond.notify_all();
+      }
+
+      for (size_t i = 0; i < d_threads.size(); i++) {
+        d_threads[i]->join();
+      }
+    }
+
+    codec_pool::sptr
+    codec_pool::shared()
+    {
+      // one set of worker threads for the process rather than per file
+      static sptr pool(new codec_pool());
+      return pool;
+    }
+
+    void
+    codec_pool::submit(task t)
+    {
+      boost::unique_lock<boost::mutex> lock(d_mutex);
+      d_tasks.push_back(t);
+      d_cond.notify_one();
+    }
+
+    void
+    codec_pool::run()
+    {
+      boost::unique_lock<boost::mutex> lock(d_mutex);
+      while (true) {
+        while (d_tasks.empty() and not d_finished) {
+          d_cond.wait(lock);
+        }
+        if (d_tasks.empty()) {
+          break;
+        }
+
+        task t = d_tasks.front();
+        d_tasks.pop_front();
+        lock.unlock();
+
+        // tasks report their own errors, anything escaping one must not
+        // end the worker and leave later tasks unrun
+        try {
+          t();
+        }
+        catch (...) {
+        }
+
+        lock.lock();
+      }
+    }
+
+  } /* namespace sandia_utils */
+} /* namespace gr */
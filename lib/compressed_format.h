@@ -0,0 +1,173 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_COMPRESSED_FORMAT_H
+#define INCLUDED_SANDIA_UTILS_COMPRESSED_FORMAT_H
+
+#include <deque>
+#include <stdint.h>           /* uint64_t */
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <sandia_utils/api.h>
+
+/*
+ * Block compressed capture format
+ *
+ * The file starts with a file header, followed by independently coded
+ * blocks, each preceded by a block header, a block index and a trailer.
+ * Every block except the last holds the same number of items, so the block
+ * holding any item follows from the index alone.  A file that was never
+ * closed has no index and trailer; its blocks can still be found by walking
+ * the block headers.  All values are in host byte order.
+ *
+ * A block of 16 bit integer samples is first bit-packed to the smallest
+ * width that holds every sample, which is lossless and very effective for
+ * noise floor captures.  It is then compressed with the configured codec if
+ * that makes it smaller.
+ */
+#define COMPRESSED_FILE_MAGIC "SUCF"
+#define COMPRESSED_TRAILER_MAGIC "SUCI"
+#define COMPRESSED_FORMAT_VERSION 1
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    enum block_codec_t {
+      CODEC_NONE = 0,
+      CODEC_LZ4 = 1,
+      CODEC_ZSTD = 2
+    };
+
+    struct compressed_file_header_t {
+      char magic[4];
+      uint32_t version;
+      uint32_t itemsize;
+      // items per block
+      uint32_t block_items;
+      // samples are 16 bit integers
+      uint32_t int16;
+      uint32_t reserved;
+      // frequency, rate and start time, as in the raw header format
+      double metadata[3];
+    };
+
+    struct compressed_block_header_t {
+      // bytes stored in file following this header
+      uint32_t stored_size;
+      // bytes once decoded
+      uint32_t nbytes;
+      // block_codec_t
+      uint8_t codec;
+      // bits per sample if bit-packed, otherwise 0
+      uint8_t packed_bits;
+      uint16_t reserved;
+    };
+
+    struct compressed_trailer_t {
+      // offset of block index, one uint64_t file offset per block header
+      uint64_t index_offset;
+      uint64_t nblocks;
+      uint64_t nitems;
+      char magic[4];
+      uint32_t reserved;
+    };
+
+    /**
+     * Best codec available in this build
+     */
+    SANDIA_UTILS_API block_codec_t default_codec();
+
+    /**
+     * Code a block
+     *
+     * @param in - block data
+     * @param nbytes - size of block data
+     * @param int16 - data is 16 bit integer samples that may be bit-packed
+     * @param codec - codec to use if it reduces the size
+     * @param hdr - block header to fill in
+     * @param out - coded block
+     * @param scratch - working storage, reused between calls
+     */
+    SANDIA_UTILS_API void encode_block( const char *in, uint32_t nbytes, bool int16,
+        block_codec_t codec, compressed_block_header_t &hdr, std::vector<char> &out,
+        std::vector<char> &scratch );
+
+    /**
+     * Decode a block - throws std::runtime_error on corrupt data or a codec
+     * not available in this build
+     *
+     * @param hdr - block header
+     * @param in - coded block of hdr.stored_size bytes
+     * @param out - destination of hdr.nbytes bytes
+     * @param scratch - working storage, reused between calls
+     */
+    SANDIA_UTILS_API void decode_block( const compressed_block_header_t &hdr, const char *in,
+        char *out, std::vector<char> &scratch );
+
+    /**
+     * Worker threads coding blocks
+     */
+    class SANDIA_UTILS_API codec_pool
+    {
+      public:
+        typedef boost::shared_ptr<codec_pool> sptr;
+        typedef boost::function<void()> task;
+
+        /**
+         * Constructor
+         *
+         * @param nthreads - number of worker threads, 0 for one per core
+         *                   up to a limit
+         */
+        codec_pool( size_t nthreads = 0 );
+
+        /**
+         * Deconstructor - completes queued tasks
+         */
+        ~codec_pool();
+
+        /**
+         * Get the pool shared by all compressed file readers and writers,
+         * started on first use
+         */
+        static sptr shared();
+
+        /**
+         * Queue a task - tasks must catch their own errors, exceptions that
+         * escape a task are discarded
+         */
+        void submit( task t );
+
+        /**
+         * Get number of worker threads
+         */
+        size_t get_nthreads()
+        {
+          return d_threads.size();
+        }
+
+      private:
+        void run();
+
+        std::deque<task> d_tasks;
+        bool d_finished;
+        boost::mutex d_mutex;
+        boost::condition_variable d_cond;
+        std::vector<boost::shared_ptr<boost::thread> > d_threads;
+    }; // end class codec_pool
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_COMPRESSED_FORMAT_H */
@@ -11,30 +11,72 @@
 #define INCLUDED_SANDIA_EPOCH_TIME_H
 
 #include <sys/time.h> /* struct timeval, gettimeofday */
-#include <cmath>      /* modf */
+#include <stdint.h>   /* uint64_t */
+#include <cmath>      /* modf, fmod, round */
 #include <iostream>
 
 namespace gr {
 namespace sandia_utils {
 
+/*
+ * Sample accurate time
+ *
+ * Time is kept as integer seconds, a fractional second offset and an
+ * integer number of ticks since that offset.  Each sample advances the tick
+ * count by the denominator of the sample rate expressed as a ratio
+ * (rate = num / den), so advancing by any number of samples is exact and
+ * does not accumulate floating point error.  Integer rates use a
+ * denominator of one.
+ */
 class epoch_time
 {
 private:
+    // whole seconds
     uint64_t d_sec;
+    // fractional second at which tick counting started
     double d_frac;
-    double d_T;
+    // ticks elapsed since d_frac, always less than d_rate_num
+    uint64_t d_ticks;
+    // sample rate as num / den samples per second
+    uint64_t d_rate_num;
+    uint64_t d_rate_den;
+
+    // fold elapsed ticks into the fractional second
+    void fold_ticks()
+    {
+        d_frac += (double)d_ticks / (double)d_rate_num;
+        d_ticks = 0;
+        if (d_frac >= 1.0) {
+            double sec;
+            d_frac = modf(d_frac, &sec);
+            d_sec += static_cast<uint64_t>(sec);
+        }
+    }
+
+    // current time split into whole and fractional seconds
+    void normalize(uint64_t& sec, double& frac) const
+    {
+        sec = d_sec;
+        frac = d_frac + (double)d_ticks / (double)d_rate_num;
+        if (frac >= 1.0) {
+            sec += 1;
+            frac -= 1.0;
+        }
+    }
 
 public:
-    epoch_time() {}
-    epoch_time(double seconds)
+    epoch_time() : d_sec(0), d_frac(0.0), d_ticks(0), d_rate_num(1), d_rate_den(1) {}
+    epoch_time(double seconds) : d_ticks(0), d_rate_num(1), d_rate_den(1)
     {
         double frac, sec;
         frac = modf(seconds, &sec);
         d_sec = static_cast<uint64_t>(sec);
         d_frac = frac;
-        d_T = 1.0;
     }
-    epoch_time(uint64_t second, double frac) : d_sec(second), d_frac(frac), d_T(1.0) {}
+    epoch_time(uint64_t second, double frac)
+        : d_sec(second), d_frac(frac), d_ticks(0), d_rate_num(1), d_rate_den(1)
+    {
+    }
     ~epoch_time() {}
 
     // copy constructor
@@ -42,26 +84,73 @@ public:
     {
         d_sec = t.d_sec;
         d_frac = t.d_frac;
-        d_T = t.d_T;
+        d_ticks = t.d_ticks;
+        d_rate_num = t.d_rate_num;
+        d_rate_den = t.d_rate_den;
     }
 
+    epoch_time& operator=(const epoch_time& t)
+    {
+        d_sec = t.d_sec;
+        d_frac = t.d_frac;
+        d_ticks = t.d_ticks;
+        d_rate_num = t.d_rate_num;
+        d_rate_den = t.d_rate_den;
+        return *this;
+    }
 
-    // set operator
-    void set(uint64_t second, double frac, double T)
+    // set time, keeping the current sample rate
+    void set(uint64_t second, double frac)
     {
         d_sec = second;
         d_frac = frac;
-        d_T = T;
+        d_ticks = 0;
     }
 
-    // set period only
-    void set_T(double T)
+    // set sample rate (Hz) - time elapsed so far is preserved
+    void set_rate(double rate)
     {
-        d_T = T;
-        // std::cout << "setting T to " << d_T << std::endl;
+        fold_ticks();
+        if (rate <= 0.0) {
+            d_rate_num = 1;
+            d_rate_den = 1;
+        } else if (std::fabs(rate - std::round(rate)) < 1e-9 * rate) {
+            d_rate_num = (uint64_t)std::round(rate);
+            d_rate_den = 1;
+        } else {
+            // millisample resolution for non integer rates
+            d_rate_num = (uint64_t)std::round(rate * 1000.0);
+            d_rate_den = 1000;
+        }
     }
 
-    // overload add operator
+    // advance by a number of samples at the current rate
+    void advance(uint64_t nsamples)
+    {
+        d_ticks += nsamples * d_rate_den;
+        if (d_ticks >= d_rate_num) {
+            d_sec += d_ticks / d_rate_num;
+            d_ticks %= d_rate_num;
+        }
+    }
+
+    // move back by a number of samples at the current rate
+    void rewind(uint64_t nsamples)
+    {
+        uint64_t nticks = nsamples * d_rate_den;
+        uint64_t nsec = nticks / d_rate_num;
+        nticks %= d_rate_num;
+
+        // borrow a second from the whole seconds if needed
+        if (nticks > d_ticks) {
+            nsec += 1;
+            d_ticks += d_rate_num;
+        }
+        d_ticks -= nticks;
+        d_sec = (nsec > d_sec) ? 0 : (d_sec - nsec);
+    }
+
+    // overload add operator - advance by seconds
     epoch_time& operator+=(const double& frac)
     {
         d_frac += frac;
@@ -71,19 +160,35 @@ public:
         return *this;
     }
 
+    // advance by samples
     epoch_time& operator+=(const int& N)
     {
-        d_frac += (double)N * d_T;
-        d_sec += uint64_t(d_frac / 1.0);
-        d_frac = fmod(d_frac, 1.0);
-
+        advance((uint64_t)N);
         return *this;
     }
 
     // public getters
-    uint64_t epoch_sec() { return d_sec; }
-    double epoch_frac() { return d_frac; }
-    double dtime() { return ((double)d_sec + d_frac); }
+    uint64_t epoch_sec() const
+    {
+        uint64_t sec;
+        double frac;
+        normalize(sec, frac);
+        return sec;
+    }
+    double epoch_frac() const
+    {
+        uint64_t sec;
+        double frac;
+        normalize(sec, frac);
+        return frac;
+    }
+    double dtime() const
+    {
+        uint64_t sec;
+        double frac;
+        normalize(sec, frac);
+        return ((double)sec + frac);
+    }
 };
 } // namespace sandia_utils
 } // namespace gr
@@ -0,0 +1,133 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "crc32c.h"
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_HW
+#include <nmmintrin.h>
+#endif
+
+// reflected Castagnoli polynomial
+#define CRC32C_POLY 0x82f63b78
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    namespace
+    {
+      // tables for processing 8 bytes at a time
+      struct crc32c_tables
+      {
+        uint32_t t[8][256];
+
+        crc32c_tables()
+        {
+          for( uint32_t n = 0; n < 256; n++ )
+          {
+            uint32_t crc = n;
+            for( int k = 0; k < 8; k++ )
+            {
+              crc = (crc & 1) ? ((crc >> 1) ^ CRC32C_POLY) : (crc >> 1);
+            }
+            t[0][n] = crc;
+          }
+          for( uint32_t n = 0; n < 256; n++ )
+          {
+            for( int k = 1; k < 8; k++ )
+            {
+              t[k][n] = (t[k - 1][n] >> 8) ^ t[0][t[k - 1][n] & 0xff];
+            }
+          }
+        }
+      };
+
+      uint32_t crc32c_sw( uint32_t crc, const unsigned char *p, size_t nbytes )
+      {
+        static const crc32c_tables tables;
+        const uint32_t (*t)[256] = tables.t;
+
+        while( nbytes and ((uintptr_t)p & 7) )
+        {
+          crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+          nbytes--;
+        }
+        while( nbytes >= 8 )
+        {
+          uint32_t lo, hi;
+          memcpy( &lo, p, 4 );
+          memcpy( &hi, p + 4, 4 );
+          lo ^= crc;
+          crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+                t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+          p += 8;
+          nbytes -= 8;
+        }
+        while( nbytes-- )
+        {
+          crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+        }
+        return crc;
+      }
+
+#ifdef CRC32C_HW
+      __attribute__((target("sse4.2")))
+      uint32_t crc32c_hw( uint32_t crc, const unsigned char *p, size_t nbytes )
+      {
+        while( nbytes and ((uintptr_t)p & 7) )
+        {
+          crc = _mm_crc32_u8( crc, *p++ );
+          nbytes--;
+        }
+        uint64_t crc64 = crc;
+        while( nbytes >= 8 )
+        {
+          uint64_t v;
+          memcpy( &v, p, 8 );
+          crc64 = _mm_crc32_u64( crc64, v );
+          p += 8;
+          nbytes -= 8;
+        }
+        crc = (uint32_t)crc64;
+        while( nbytes-- )
+        {
+          crc = _mm_crc32_u8( crc, *p++ );
+        }
+        return crc;
+      }
+#endif
+    }
+
+    uint32_t crc32c( uint32_t crc, const void *data, size_t nbytes )
+    {
+      const unsigned char *p = (const unsigned char *)data;
+      crc = ~crc;
+#ifdef CRC32C_HW
+      static const bool hw = __builtin_cpu_supports( "sse4.2" );
+      if( hw )
+      {
+        return ~crc32c_hw( crc, p, nbytes );
+      }
+#endif
+      return ~crc32c_sw( crc, p, nbytes );
+    }
+
+    uint32_t crc32c_table( uint32_t crc, const void *data, size_t nbytes )
+    {
+      return ~crc32c_sw( ~crc, (const unsigned char *)data, nbytes );
+    }
+
+  } // namespace sandia_utils
+} // namespace gr
@@ -0,0 +1,44 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_CRC32C_H
+#define INCLUDED_SANDIA_UTILS_CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sandia_utils/api.h>
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    /**
+     * Update a CRC32C (Castagnoli) checksum
+     *
+     * Uses the SSE4.2 crc32 instruction when the processor supports it and
+     * a table driven implementation otherwise.  The result matches common
+     * CRC32C tools (iSCSI, ext4, crc32c utilities).
+     *
+     * @param crc - checksum of the preceding data, 0 to start
+     * @param data - data to add
+     * @param nbytes - number of bytes
+     * @return uint32_t - checksum of all data so far
+     */
+    SANDIA_UTILS_API uint32_t crc32c( uint32_t crc, const void *data, size_t nbytes );
+
+    /**
+     * Update a CRC32C checksum with the table driven implementation only,
+     * for comparison with crc32c()
+     */
+    SANDIA_UTILS_API uint32_t crc32c_table( uint32_t crc, const void *data, size_t nbytes );
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_CRC32C_H */
@@ -0,0 +1,81 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "file_io_pool.h"
+#include "file_writer_base.h"
+#include <boost/bind.hpp>
+#include <stdexcept>
+
+namespace gr {
+  namespace sandia_utils {
+
+    file_io_pool::file_io_pool(size_t nthreads)
+      : d_finished(false)
+    {
+      if (nthreads < 1) {
+        throw std::runtime_error("file_sink: I/O pool requires at least one thread");
+      }
+
+      for (size_t i = 0; i < nthreads; i++) {
+        d_threads.push_back(boost::shared_ptr<boost::thread>(
+            new boost::thread(boost::bind(&file_io_pool::run, this))));
+      }
+    }
+
+    file_io_pool::~file_io_pool()
+    {
+      {
+        boost::unique_lock<boost::mutex> lock(d_mutex);
+        d_finished = true;
+        d_cond.notify_all();
+      }
+
+      for (size_t i = 0; i < d_threads.size(); i++) {
+        d_threads[i]->join();
+      }
+    }
+
+    void
+    file_io_pool::schedule(file_writer_base *writer)
+    {
+      boost::unique_lock<boost::mutex> lock(d_mutex);
+      d_ready.push_back(writer);
+      d_cond.notify_one();
+    }
+
+    void
+    file_io_pool::run()
+    {
+      boost::unique_lock<boost::mutex> lock(d_mutex);
+      while (true) {
+        while (d_ready.empty() and not d_finished) {
+          d_cond.wait(lock);
+        }
+        if (d_ready.empty()) {
+          break;
+        }
+
+        file_writer_base *writer = d_ready.front();
+        d_ready.pop_front();
+        lock.unlock();
+
+        // writes a bounded number of buffers and reschedules the writer if
+        // more remain, so one busy writer can not starve the others
+        writer->io_drain();
+
+        lock.lock();
+      }
+    }
+
+  } /* namespace sandia_utils */
+} /* namespace gr */
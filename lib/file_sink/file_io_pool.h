@@ -0,0 +1,83 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_FILE_IO_POOL_H
+#define INCLUDED_SANDIA_UTILS_FILE_IO_POOL_H
+
+#include <deque>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
+#include <sandia_utils/api.h>
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    class file_writer_base;
+
+    /**
+     * Shared background I/O threads.
+     *
+     * Writers with background I/O enabled normally own a dedicated I/O
+     * thread.  When a pool is assigned, a writer instead schedules itself on
+     * the pool whenever it has queued buffers, and any free pool thread
+     * writes them.  A writer is serviced by at most one thread at a time so
+     * its buffers are still written in order.  The number of threads bounds
+     * the number of concurrent disk operations independent of the number of
+     * writers.
+     */
+    class SANDIA_UTILS_API file_io_pool
+    {
+      public:
+        typedef boost::shared_ptr<file_io_pool> sptr;
+
+        /**
+         * Constructor
+         *
+         * @param nthreads - number of I/O threads
+         */
+        file_io_pool( size_t nthreads );
+
+        /**
+         * Deconstructor - all writers must have been drained
+         */
+        ~file_io_pool();
+
+        /**
+         * Queue a writer that has buffers ready to be written
+         *
+         * @param writer - writer to service
+         */
+        void schedule( file_writer_base *writer );
+
+        /**
+         * Get number of I/O threads
+         */
+        size_t get_nthreads()
+        {
+          return d_threads.size();
+        }
+
+      private:
+        void run();
+
+        std::deque<file_writer_base *> d_ready;
+        bool d_finished;
+        boost::mutex d_mutex;
+        boost::condition_variable d_cond;
+        std::vector<boost::shared_ptr<boost::thread> > d_threads;
+    }; // end class file_io_pool
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_FILE_IO_POOL_H */
@@ -0,0 +1,322 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "file_name_spec.h"
+#include <cctype>
+#include <stdexcept>
+#include <string.h>
+#include <time.h>
+
+// largest generated file name, including output directory
+#define MAX_FILE_NAME_SIZE 4096
+
+namespace gr {
+  namespace sandia_utils {
+
+    namespace {
+      // frequency and rate specifiers, resolved when compiled
+      struct param_spec_t {
+        const char *spec;
+        bool freq;
+        uint64_t divisor;
+      };
+
+      const param_spec_t PARAM_SPECS[] = {
+        { "fcM", true, 1000000 },
+        { "fck", true, 1000 },
+        { "fcc", true, 1 },
+        { "fsM", false, 1000000 },
+        { "fsk", false, 1000 },
+        { "fsc", false, 1 }
+      };
+
+      inline bool
+      append(char *&p, char *end, const char *s, size_t len)
+      {
+        if ((size_t)(end - p) < len) {
+          return false;
+        }
+        memcpy(p, s, len);
+        p += len;
+        return true;
+      }
+
+      inline bool
+      append_uint(char *&p, char *end, uint64_t value, int width, char pad)
+      {
+        // format digits in reverse
+        char digits[20];
+        int ndigits = 0;
+        do {
+          digits[ndigits++] = (char)('0' + (value % 10));
+          value /= 10;
+        } while (value);
+
+        int npad = (width > ndigits) ? (width - ndigits) : 0;
+        if ((end - p) < (npad + ndigits)) {
+          return false;
+        }
+        for (int i = 0; i < npad; i++) {
+          *p++ = pad;
+        }
+        while (ndigits) {
+          *p++ = digits[--ndigits];
+        }
+        return true;
+      }
+    } // namespace
+
+    file_name_spec::file_name_spec()
+      : d_uses_time(false)
+    {
+    }
+
+    file_name_spec::~file_name_spec()
+    {
+    }
+
+    void
+    file_name_spec::add_literal(const std::string &text)
+    {
+      if (text.empty()) {
+        return;
+      }
+
+      // merge consecutive literal text
+      if (d_tokens.size() and (d_tokens.back().type == LITERAL)) {
+        d_tokens.back().text += text;
+      }
+      else {
+        add_token(LITERAL, text);
+      }
+    }
+
+    void
+    file_name_spec::add_token(token_type_t type, const std::string &text,
+                              int width, uint64_t modulus, char pad)
+    {
+      token_t token;
+      token.type = type;
+      token.text = text;
+      token.width = width;
+      token.modulus = modulus;
+      token.pad = pad;
+      d_tokens.push_back(token);
+
+      if ((type != LITERAL) and (type != FILE_NUM)) {
+        d_uses_time = true;
+      }
+    }
+
+    void
+    file_name_spec::compile(const std::string &spec, const std::string &prefix,
+                            uint64_t freq, uint64_t rate, int channel)
+    {
+      d_tokens.clear();
+      d_uses_time = false;
+
+      // output directory
+      add_literal(prefix);
+      if (prefix.size() and (prefix[prefix.size() - 1] != '/')) {
+        add_literal("/");
+      }
+
+      size_t i = 0;
+      while (i < spec.size()) {
+        if ((spec[i] != '%') or (i + 1 == spec.size())) {
+          add_literal(std::string(1, spec[i]));
+          i++;
+          continue;
+        }
+
+        // escaped percent
+        if (spec[i + 1] == '%') {
+          add_literal("%");
+          i += 2;
+          continue;
+        }
+
+        // frequency and rate
+        bool found = false;
+        for (size_t k = 0; k < sizeof(PARAM_SPECS) / sizeof(PARAM_SPECS[0]); k++) {
+          if (spec.compare(i + 1, 3, PARAM_SPECS[k].spec) == 0) {
+            uint64_t value = PARAM_SPECS[k].freq ? freq : rate;
+            add_literal(std::to_string(value / PARAM_SPECS[k].divisor));
+            i += 4;
+            found = true;
+            break;
+          }
+        }
+        if (found) {
+          continue;
+        }
+
+        // channel number
+        if (spec.compare(i + 1, 2, "ch") == 0) {
+          add_literal(std::to_string(channel));
+          i += 3;
+          continue;
+        }
+
+        // basic file number
+        if (spec.compare(i + 1, 2, "fd") == 0) {
+          add_token(FILE_NUM, "", 5, 100000, '0');
+          i += 3;
+          continue;
+        }
+
+        // extended file number (%Nfd or %0Nfd)
+        size_t j = i + 1;
+        char pad = ' ';
+        if (spec[j] == '0') {
+          pad = '0';
+          j++;
+        }
+        size_t digits_start = j;
+        while ((j < spec.size()) and isdigit((unsigned char)spec[j])) {
+          j++;
+        }
+        if ((j > digits_start) and (spec.compare(j, 2, "fd") == 0)) {
+          int width = std::stoi(spec.substr(digits_start, j - digits_start));
+
+          // wrap after 10^width files
+          uint64_t modulus = 1;
+          for (int k = 0; (k < width) and (modulus <= UINT64_MAX / 10); k++) {
+            modulus *= 10;
+          }
+          add_token(FILE_NUM, "", width, (width < 20) ? modulus : 0, pad);
+          i = j + 2;
+          continue;
+        }
+
+        // common time conversions
+        token_type_t type = STRFTIME;
+        switch (spec[i + 1]) {
+          case 'Y': type = YEAR; break;
+          case 'y': type = YEAR_SHORT; break;
+          case 'm': type = MONTH; break;
+          case 'd': type = DAY; break;
+          case 'j': type = DAY_OF_YEAR; break;
+          case 'H': type = HOUR; break;
+          case 'M': type = MINUTE; break;
+          case 'S': type = SECOND; break;
+          default: break;
+        }
+        if (type != STRFTIME) {
+          add_token(type);
+          i += 2;
+          continue;
+        }
+
+        // any other conversion, including flags, width and modifiers, is
+        // handled by strftime
+        j = i + 1;
+        while ((j < spec.size()) and strchr("_-0^#", spec[j])) {
+          j++;
+        }
+        while ((j < spec.size()) and isdigit((unsigned char)spec[j])) {
+          j++;
+        }
+        if ((j < spec.size()) and ((spec[j] == 'E') or (spec[j] == 'O'))) {
+          j++;
+        }
+        if (j >= spec.size()) {
+          add_literal(spec.substr(i));
+          break;
+        }
+        add_token(STRFTIME, spec.substr(i, j + 1 - i));
+        i = j + 1;
+      }
+    } /* end compile */
+
+    size_t
+    file_name_spec::render(char *buf, size_t size, uint64_t file_num, uint64_t epoch_sec) const
+    {
+      struct tm t;
+      if (d_uses_time) {
+        time_t sample_second = (time_t)epoch_sec;
+        gmtime_r(&sample_second, &t);
+      }
+
+      char *p = buf;
+      char *end = buf + size;
+      bool ok = true;
+      for (size_t i = 0; ok and (i < d_tokens.size()); i++) {
+        const token_t &token = d_tokens[i];
+        switch (token.type) {
+          case LITERAL:
+            ok = append(p, end, token.text.data(), token.text.size());
+            break;
+          case FILE_NUM:
+            ok = append_uint(p, end, token.modulus ? (file_num % token.modulus) : file_num,
+                             token.width, token.pad);
+            break;
+          case YEAR:
+            ok = append_uint(p, end, t.tm_year + 1900, 4, '0');
+            break;
+          case YEAR_SHORT:
+            ok = append_uint(p, end, t.tm_year % 100, 2, '0');
+            break;
+          case MONTH:
+            ok = append_uint(p, end, t.tm_mon + 1, 2, '0');
+            break;
+          case DAY:
+            ok = append_uint(p, end, t.tm_mday, 2, '0');
+            break;
+          case DAY_OF_YEAR:
+            ok = append_uint(p, end, t.tm_yday + 1, 3, '0');
+            break;
+          case HOUR:
+            ok = append_uint(p, end, t.tm_hour, 2, '0');
+            break;
+          case MINUTE:
+            ok = append_uint(p, end, t.tm_min, 2, '0');
+            break;
+          case SECOND:
+            ok = append_uint(p, end, t.tm_sec, 2, '0');
+            break;
+          case STRFTIME:
+            {
+              // strftime returns 0 both for an empty result and when the
+              // result does not fit, so require some headroom
+              if ((end - p) < 256) {
+                ok = false;
+                break;
+              }
+              p += strftime(p, end - p, token.text.c_str(), &t);
+            }
+            break;
+        }
+      }
+
+      // leave room for terminator
+      if ((not ok) or (p == end)) {
+        return 0;
+      }
+      *p = '\0';
+      return (size_t)(p - buf);
+    } /* end render */
+
+    void
+    file_name_spec::render(std::string &fname, uint64_t file_num, uint64_t epoch_sec) const
+    {
+      char buf[MAX_FILE_NAME_SIZE];
+      size_t len = render(buf, sizeof(buf), file_num, epoch_sec);
+      if (len == 0) {
+        throw std::runtime_error("generated file name is too long");
+      }
+      fname.assign(buf, len);
+    } /* end render */
+
+  } /* namespace sandia_utils */
+} /* namespace gr */
@@ -0,0 +1,111 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_FILE_NAME_SPEC_H
+#define INCLUDED_SANDIA_UTILS_FILE_NAME_SPEC_H
+
+#include <string>
+#include <stdint.h>           /* uint64_t */
+#include <vector>
+#include <sandia_utils/api.h>
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    /**
+     * Compiled file name specifier.
+     *
+     * The name specifier is parsed once into a list of tokens when recording
+     * starts.  Frequency, rate and channel specifiers, which can not change
+     * during a recording, are resolved to literal text at that point.
+     * Generating a file name then only formats the file number and start
+     * time into a caller supplied buffer.  Common strftime conversions are
+     * formatted directly, all others are passed to strftime.
+     *
+     * Rendering does not modify the object, so a compiled specifier can be
+     * shared between threads.
+     */
+    class SANDIA_UTILS_API file_name_spec
+    {
+      public:
+        file_name_spec();
+        ~file_name_spec();
+
+        /**
+         * Parse a name specifier
+         *
+         * @param spec - name specification format string
+         * @param prefix - text prepended to every name (output directory)
+         * @param freq - center frequency (Hz)
+         * @param rate - sample rate (Hz)
+         * @param channel - channel number
+         */
+        void compile( const std::string &spec, const std::string &prefix,
+                      uint64_t freq, uint64_t rate, int channel = 0 );
+
+        /**
+         * Generate a file name
+         *
+         * @param buf - output buffer
+         * @param size - size of output buffer
+         * @param file_num - file number
+         * @param epoch_sec - file start time (seconds since epoch)
+         * @return size_t - length of name, or 0 if it does not fit in the buffer
+         */
+        size_t render( char *buf, size_t size, uint64_t file_num, uint64_t epoch_sec ) const;
+
+        /**
+         * Generate a file name, reusing the storage of \p fname
+         *
+         * @param fname - output file name
+         * @param file_num - file number
+         * @param epoch_sec - file start time (seconds since epoch)
+         */
+        void render( std::string &fname, uint64_t file_num, uint64_t epoch_sec ) const;
+
+      private:
+        enum token_type_t {
+          LITERAL = 0,
+          FILE_NUM,
+          YEAR,
+          YEAR_SHORT,
+          MONTH,
+          DAY,
+          DAY_OF_YEAR,
+          HOUR,
+          MINUTE,
+          SECOND,
+          STRFTIME
+        };
+
+        struct token_t {
+          token_type_t type;
+          // literal text or strftime format
+          std::string text;
+          // file number field width, modulus and padding
+          int width;
+          uint64_t modulus;
+          char pad;
+        };
+
+        void add_literal( const std::string &text );
+        void add_token( token_type_t type, const std::string &text = "",
+                        int width = 0, uint64_t modulus = 0, char pad = '0' );
+
+        std::vector<token_t> d_tokens;
+
+        // broken down time is only needed if a time conversion is used
+        bool d_uses_time;
+    }; // end class file_name_spec
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_FILE_NAME_SPEC_H */
@@ -14,6 +14,13 @@
 #include "file_writer_base.h"
 #include "file_writer_raw.h"
 #include "file_writer_raw_header.h"
+#include "file_writer_raw_direct.h"
+#include "file_writer_sigmf.h"
+#include "file_writer_compressed.h"
+#include "crc32c.h"
+#ifdef HAVE_LIBURING
+#include "file_writer_uring.h"
+#endif
 #ifdef HAVE_BLUEFILE_LIB
 #include "file_writer_bluefile.h"
 #endif
@@ -21,35 +28,19 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/format.hpp>
+#include <boost/bind.hpp>
+#include <errno.h>
+#include <fcntl.h>
 #include <iostream>
 #include <stdio.h>
-#include <math.h>     // pow
-#include <string>     // stoi
+#include <string.h>   // memcpy
+#include <unistd.h>
 
 namespace fs = boost::filesystem;
 
 namespace gr {
   namespace sandia_utils {
 
-    // String substitution
-    std::string
-    strrepl(std::string f, std::string s, int value, int divisor, std::string spec = "%d")
-    {
-      // populate local variables first
-      char buff[20];
-      std::string temp = f;
-
-      // replace all instances of fc (center frequency)
-      std::size_t found = temp.find(s);
-      while (found != std::string::npos){
-        sprintf(buff,spec.c_str(),value / divisor);
-        temp = temp.substr(0,found) + buff + temp.substr(found+s.size());
-        found = temp.find(s);
-      }
-
-      return temp;
-    }
-
     file_writer_base::sptr file_writer_base::make(std::string data_type, std::string file_type,
                          size_t itemsize, uint64_t nsamples, int rate,
                          std::string out_dir, std::string name_spec,
@@ -61,10 +52,28 @@ namespace gr {
       {
         p = sptr( new file_writer_raw( data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, logger ) );
       }
-      else if( file_type == "raw_header" )
+      else if( (file_type == "raw_header") or (file_type == "raw_header_v2") )
       {
         p = sptr( new file_writer_raw_header( data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, logger ) );
       }
+      else if( file_type == "raw_direct" )
+      {
+        p = sptr( new file_writer_raw_direct( data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, logger ) );
+      }
+      else if( file_type == "sigmf" )
+      {
+        p = sptr( new file_writer_sigmf( data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, logger ) );
+      }
+      else if( file_type == "compressed" )
+      {
+        p = sptr( new file_writer_compressed( data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, logger ) );
+      }
+#ifdef HAVE_LIBURING
+      else if( file_type == "uring" )
+      {
+        p = sptr( new file_writer_uring( data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, logger ) );
+      }
+#endif
 #ifdef HAVE_BLUEFILE_LIB
       else if (file_type == "bluefile"){
         p = sptr(new file_writer_bluefile(data_type, file_type, itemsize,
@@ -108,11 +117,12 @@ namespace gr {
         d_file_type = file_type;
         d_itemsize = itemsize;
         d_rate = rate;
+        d_set_rate = rate;
         d_out_dir = out_dir;
-        d_name_spec = name_spec;
         d_name_spec_base = name_spec;
         d_new_folder = false;
         d_freq = 0;
+        d_set_freq = 0;
         d_nwritten = 0;
         d_nwritten_total = 0;
 
@@ -131,6 +141,48 @@ namespace gr {
       // set flag
       d_is_started = false;
 
+      // no file number rollover by default
+      d_file_num_rollover = 0;
+
+      // single channel
+      d_channel = 0;
+
+      // background I/O disabled by default
+      d_async = false;
+      d_drop = false;
+      d_io_block_items = 0;
+      d_io_head = 0;
+      d_io_count = 0;
+      d_io_filling = false;
+      d_io_scheduled = false;
+      d_io_busy = false;
+      d_io_finished = false;
+      d_nstalls = 0;
+      d_ndropped = 0;
+      d_nerrors = 0;
+
+      // next file is opened on rollover by default
+      d_preopen = false;
+      d_prepare_pending = false;
+      d_prepare_finished = false;
+      d_prepare_file_num = 0;
+      d_next_requested = false;
+      d_next_prepared = false;
+      d_next_preallocated = false;
+
+      // files grow as data is written by default
+      d_preallocate = false;
+      d_file_preallocated = false;
+
+      // no checksums by default
+      d_checksum = false;
+      d_file_checksum = false;
+      d_crc = 0;
+
+      // no annotated region
+      d_annotating = false;
+      d_annotation_start = 0;
+
 
       return;
     } //end constructor
@@ -140,21 +192,362 @@ namespace gr {
      */
     file_writer_base::~file_writer_base()
     {
+      // derived classes must shut down helper threads before closing files,
+      // this is only a safety net
+      shutdown();
 
       return;
     }
 
+    void
+    file_writer_base::set_freq(uint64_t freq)
+    {
+      d_set_freq = freq;
+      if (d_async) {
+        io_command(IO_CONFIG, epoch_time(), d_set_freq, d_set_rate);
+      } else {
+        do_config(d_set_freq, d_set_rate);
+      }
+    }
+
+    void
+    file_writer_base::set_rate(int rate)
+    {
+      // only update for valid sampling rate
+      if (rate <= 0) {
+        GR_LOG_DEBUG(d_logger,
+            boost::format("Invalid sampling rate %d.  Rate must be greater than zero") % rate);
+        return;
+      }
+
+      d_set_rate = rate;
+      if (d_async) {
+        io_command(IO_CONFIG, epoch_time(), d_set_freq, d_set_rate);
+      } else {
+        do_config(d_set_freq, d_set_rate);
+      }
+    }
+
     void
     file_writer_base::start(epoch_time start_time)
     {
+      if (d_async) {
+        io_command(IO_START, start_time);
+      } else {
+        do_start(start_time);
+      }
+
+      // set flag
+      d_is_started = true;
+    }
+
+    void
+    file_writer_base::stop()
+    {
+      if (d_async) {
+        io_command(IO_STOP, epoch_time());
+      } else {
+        do_stop();
+      }
+
+      // clear flag
+      d_is_started = false;
+    }
+
+    void
+    file_writer_base::capture(epoch_time time, uint64_t freq, int rate)
+    {
+      if (not supports_captures()) {
+        return;
+      }
+
+      if (d_async) {
+        io_command(IO_CAPTURE, time, freq, rate);
+      } else {
+        do_capture(time, freq, rate);
+      }
+    }
+
+    void
+    file_writer_base::annotate(bool active)
+    {
+      if (not supports_captures()) {
+        return;
+      }
+
+      if (d_async) {
+        io_command(IO_ANNOTATE, epoch_time(), active ? 1 : 0);
+      } else {
+        do_annotate(active);
+      }
+    }
+
+    void
+    file_writer_base::write(const void *in, int nitems)
+    {
+      if (not d_async) {
+        do_write(in, (uint64_t)nitems);
+        return;
+      }
+
+      // copy into ring - data is written to disk by the I/O thread
+      uint64_t nleft = (uint64_t)nitems;
+      const char *p = reinterpret_cast<const char *>(in);
+      boost::unique_lock<boost::mutex> lock(d_io_mutex);
+      while (nleft) {
+        if (not io_reserve(lock, d_drop)) {
+          d_ndropped += nleft;
+          break;
+        }
+
+        // the block being filled is not visible to the I/O thread so the
+        // copy can be done without holding the lock
+        io_block_t &b = d_io_ring[(d_io_head + d_io_count) % d_io_ring.size()];
+        size_t ncopy = std::min((uint64_t)(d_io_block_items - b.nitems), nleft);
+        lock.unlock();
+        memcpy(&b.data[b.nitems * d_itemsize], p, ncopy * d_itemsize);
+        lock.lock();
+
+        b.nitems += ncopy;
+        p += ncopy * d_itemsize;
+        nleft -= ncopy;
+        if (b.nitems == d_io_block_items) {
+          io_publish(lock);
+        }
+      }
+
+      // hand over a partially filled block if the I/O thread is idle, so that
+      // data does not sit in memory when the disk is keeping up
+      if (d_io_filling and (d_io_count == 0) and not d_io_busy) {
+        io_publish(lock);
+      }
+    }
+
+    void
+    file_writer_base::flush()
+    {
+      if (not d_async) {
+        return;
+      }
+
+      boost::unique_lock<boost::mutex> lock(d_io_mutex);
+      if (d_io_filling) {
+        io_publish(lock);
+      }
+      while (d_io_count or d_io_busy or d_io_scheduled) {
+        d_io_space_cond.wait(lock);
+      }
+    }
+
+    void
+    file_writer_base::set_async(bool async, size_t nbuffers, size_t buffer_size, bool drop)
+    {
+      // drain and shut down any existing I/O thread
+      if (d_async) {
+        flush();
+        if (d_io_thread) {
+          {
+            boost::unique_lock<boost::mutex> lock(d_io_mutex);
+            d_io_finished = true;
+            d_io_data_cond.notify_all();
+          }
+          d_io_thread->join();
+          d_io_thread.reset();
+        }
+        d_io_shared.reset();
+        d_io_ring.clear();
+        d_async = false;
+      }
+
+      d_drop = drop;
+      if (async) {
+        if (nbuffers < 2) {
+          throw std::runtime_error("file_sink: background I/O requires at least two buffers");
+        }
+
+        // preallocate all buffers
+        d_io_block_items = std::max(buffer_size / d_itemsize, (size_t)1);
+        d_io_ring.resize(nbuffers);
+        for (size_t i = 0; i < nbuffers; i++) {
+          d_io_ring[i].op = IO_DATA;
+          d_io_ring[i].nitems = 0;
+          d_io_ring[i].data.resize(d_io_block_items * d_itemsize);
+        }
+        d_io_head = 0;
+        d_io_count = 0;
+        d_io_filling = false;
+        d_io_busy = false;
+        d_io_finished = false;
+        d_async = true;
+
+        // shared threads are only involved while data is queued
+        d_io_shared = d_io_pool;
+        if (not d_io_shared) {
+          d_io_thread = boost::shared_ptr<boost::thread>(
+              new boost::thread(boost::bind(&file_writer_base::io_run, this)));
+        }
+      }
+    }
+
+    bool
+    file_writer_base::io_reserve(boost::unique_lock<boost::mutex> &lock, bool can_drop)
+    {
+      if (d_io_filling) {
+        return true;
+      }
+
+      if (d_io_count == d_io_ring.size()) {
+        if (can_drop) {
+          return false;
+        }
+
+        d_nstalls++;
+        while (d_io_count == d_io_ring.size()) {
+          d_io_space_cond.wait(lock);
+        }
+      }
+
+      io_block_t &b = d_io_ring[(d_io_head + d_io_count) % d_io_ring.size()];
+      b.op = IO_DATA;
+      b.nitems = 0;
+      d_io_filling = true;
+      return true;
+    }
+
+    void
+    file_writer_base::io_publish(boost::unique_lock<boost::mutex> &lock)
+    {
+      d_io_filling = false;
+      d_io_count++;
+      if (not d_io_shared) {
+        d_io_data_cond.notify_one();
+      }
+      else if (not d_io_scheduled) {
+        d_io_scheduled = true;
+        d_io_shared->schedule(this);
+      }
+    }
+
+    void
+    file_writer_base::io_command(io_op_t op, epoch_time time, uint64_t value, int rate)
+    {
+      boost::unique_lock<boost::mutex> lock(d_io_mutex);
+
+      // queue any pending data first to preserve ordering
+      if (d_io_filling) {
+        io_publish(lock);
+      }
+
+      // control operations are never dropped
+      io_reserve(lock, false);
+      io_block_t &b = d_io_ring[(d_io_head + d_io_count) % d_io_ring.size()];
+      b.op = op;
+      b.time = time;
+      b.value = value;
+      b.rate = rate;
+      io_publish(lock);
+    }
+
+    void
+    file_writer_base::io_process(boost::unique_lock<boost::mutex> &lock)
+    {
+      io_block_t &b = d_io_ring[d_io_head];
+      d_io_busy = true;
+      lock.unlock();
+
+      bool failed = false;
+      try {
+        boost::recursive_mutex::scoped_lock config_lock(d_mutex);
+        switch (b.op) {
+          case IO_DATA:
+            do_write(&b.data[0], b.nitems);
+            break;
+          case IO_START:
+            do_start(b.time);
+            break;
+          case IO_STOP:
+            do_stop();
+            break;
+          case IO_CAPTURE:
+            do_capture(b.time, b.value, b.rate);
+            break;
+          case IO_ANNOTATE:
+            do_annotate(b.value != 0);
+            break;
+          case IO_CONFIG:
+            do_config(b.value, b.rate);
+            break;
+        }
+      }
+      catch (std::exception &e) {
+        GR_LOG_ERROR(d_logger, boost::format("file_sink: background I/O error: %s") % e.what());
+        failed = true;
+      }
+
+      lock.lock();
+      if (failed) {
+        d_nerrors++;
+      }
+      d_io_busy = false;
+      d_io_head = (d_io_head + 1) % d_io_ring.size();
+      d_io_count--;
+      d_io_space_cond.notify_all();
+    }
+
+    void
+    file_writer_base::io_run()
+    {
+      boost::unique_lock<boost::mutex> lock(d_io_mutex);
+      while (true) {
+        while ((d_io_count == 0) and not d_io_finished) {
+          d_io_data_cond.wait(lock);
+        }
+        if (d_io_count == 0) {
+          break;
+        }
+
+        io_process(lock);
+      }
+    }
+
+    void
+    file_writer_base::io_drain()
+    {
+      boost::unique_lock<boost::mutex> lock(d_io_mutex);
+
+      // at most one ring worth of blocks before yielding to other writers
+      for (size_t n = 0; d_io_count and (n < d_io_ring.size()); n++) {
+        io_process(lock);
+      }
+
+      if (d_io_count) {
+        d_io_shared->schedule(this);
+      }
+      else {
+        d_io_scheduled = false;
+        d_io_space_cond.notify_all();
+      }
+    }
+
+    void
+    file_writer_base::do_start(epoch_time start_time)
+    {
+      // nothing prepared for a previous recording may be used
+      discard_next();
+
+      // file start times are advanced by whole files worth of samples
       d_samp_time = start_time;
+      d_samp_time.set_rate(d_rate);
       d_samp_time_next = d_samp_time;
-      d_samp_time_next += d_T;
+      d_samp_time_next.advance(d_nsamples);
 
       // setup counters
       d_nwritten = 0;
       d_nwritten_total = 0;
       d_nremaining = d_nsamples;
+      d_annotating = false;
+      d_file_checksum = d_checksum;
+      d_crc = 0;
 
       // generate folder if necessary
       gen_folder(start_time);
@@ -163,28 +556,143 @@ namespace gr {
       gen_filename_base();
 
       // open file
-      d_filename = gen_filename();
+      if (d_file_counter) {
+        d_file_num = reserve_file_num();
+      }
+      gen_filename(d_filename, d_file_num, d_samp_time);
       open(d_filename);
+      if (not d_file_preallocated) {
+        d_file_preallocated = preallocate(d_filename);
+      }
 
-      // set flag
-      d_is_started = true;
+      // get next file ready
+      if (d_preopen and d_nsamples) {
+        request_prepare();
+      }
     }
 
     void
-    file_writer_base::stop()
+    file_writer_base::do_stop()
     {
+      // close current file
+      std::string error;
+      try {
+        finish_file();
+      }
+      catch (std::exception &e) {
+        error = e.what();
+      }
+      d_annotating = false;
 
-      // use virtual method to properly close file
-      close();
+      // files closed in the background are complete once stopped
+      try {
+        wait_closed();
+      }
+      catch (std::exception &e) {
+        if (error.empty()) { error = e.what(); }
+      }
+
+      // remove next file if it was already created
+      discard_next();
 
-      // Increment file number
-      d_file_num++;
-      if (d_file_num_rollover > 0) { d_file_num %= (uint64_t)d_file_num_rollover; }
+      if (not error.empty()) {
+        throw std::runtime_error(error);
+      }
+    }
+
+    void
+    file_writer_base::do_capture(epoch_time time, uint64_t freq, int rate)
+    {
+      if (d_filename.empty()) {
+        return;
+      }
+
+      capture_impl(d_nwritten, time, freq, rate);
+
+      // following files start relative to the new time base
+      if (d_nsamples) {
+        d_samp_time_next = time;
+        d_samp_time_next.set_rate(d_rate);
+        d_samp_time_next.advance(d_nremaining);
+
+        // a file prepared in advance may be named for the old time
+        if (d_preopen) {
+          discard_next();
+          request_prepare();
+        }
+      }
+    }
+
+    void
+    file_writer_base::do_annotate(bool active)
+    {
+      if (active) {
+        if ((not d_annotating) and (not d_filename.empty())) {
+          d_annotating = true;
+          d_annotation_start = d_nwritten;
+        }
+      }
+      else if (d_annotating) {
+        d_annotating = false;
+        if (d_nwritten > d_annotation_start) {
+          annotation_impl(d_annotation_start, d_nwritten - d_annotation_start);
+        }
+      }
+    }
+
+    void
+    file_writer_base::do_config(uint64_t freq, int rate)
+    {
+      boost::recursive_mutex::scoped_lock lock(d_mutex);
+      d_freq = freq;
+      d_rate = rate;
+    }
 
-      // signal for update to be sent only if data has been written
+    void
+    file_writer_base::finish_file()
+    {
+      // an annotated region in progress continues in the next file
+      if (d_annotating) {
+        if (d_nwritten > d_annotation_start) {
+          annotation_impl(d_annotation_start, d_nwritten - d_annotation_start);
+        }
+        d_annotation_start = 0;
+      }
+
+      // use virtual method to properly close file, the file is finished
+      // even if that fails
+      std::string error;
+      try {
+        close();
+      }
+      catch (std::exception &e) {
+        error = e.what();
+      }
+
+      // release space reserved beyond the data actually written
+      if (d_file_preallocated) {
+        off_t length = (off_t)header_size() + (off_t)(d_nwritten * d_itemsize);
+        if (::truncate(d_filename.c_str(), length) != 0) {
+          GR_LOG_ERROR(d_logger, boost::format("Unable to truncate file %s") % d_filename);
+        }
+        d_file_preallocated = false;
+      }
+
+      // Increment file number - shared numbers are reserved when a file is
+      // opened
+      if (not d_file_counter) {
+        d_file_num++;
+        if (d_file_num_rollover > 0) { d_file_num %= (uint64_t)d_file_num_rollover; }
+      }
+
+      // signal for update to be sent only if data has been written, once
+      // the file is complete
+      boost::function<void()> done;
       if (d_nwritten) {
-        d_callback(d_filename,d_samp_time,double(d_freq),double(d_rate));
+        done = boost::bind(d_callback,d_filename,d_samp_time,double(d_freq),double(d_rate),
+            d_file_checksum ? (int64_t)d_crc : -1);
       }
+      file_closed(done);
 
       // clear file currently being written
       d_filename = "";
@@ -192,22 +700,50 @@ namespace gr {
       // reset number of samples in file
       d_nwritten = 0;
 
-      // clear flag
-      d_is_started = false;
+      // checksum of the next file
+      d_file_checksum = d_checksum;
+      d_crc = 0;
+
+      if (not error.empty()) {
+        throw std::runtime_error(error);
+      }
+    }
+
+    uint64_t
+    file_writer_base::reserve_file_num()
+    {
+      uint64_t file_num = d_file_counter->next();
+      if (d_file_num_rollover > 0) { file_num %= (uint64_t)d_file_num_rollover; }
+      return file_num;
     }
 
     void
-    file_writer_base::write(const void *in, int nitems)
+    file_writer_base::do_write(const void *in, uint64_t nitems)
     {
-      uint64_t nleft = (uint64_t)nitems;
+      uint64_t nleft = nitems;
       char *p = reinterpret_cast<char *>(const_cast<void *>(in));
       if (d_nsamples){
+        // samples that could not be written still count toward the file so
+        // following files keep their sample times, the first error is
+        // reported once all samples are handled
+        std::string error;
         while(nleft)
         {
           uint64_t ntowrite = std::min(d_nremaining, nleft);
 
           // write samples
-          uint64_t nwritten = (uint64_t )write_impl((void *)p,ntowrite);
+          uint64_t nwritten = ntowrite;
+          try {
+            nwritten = (uint64_t)write_impl((void *)p,ntowrite);
+          }
+          catch (std::exception &e) {
+            if (error.empty()) {
+              error = e.what();
+            }
+          }
+          if (d_file_checksum) {
+            d_crc = crc32c(d_crc, p, nwritten * d_itemsize);
+          }
           d_nwritten += nwritten;
           d_nwritten_total += nwritten;
           p += (ntowrite*d_itemsize);
@@ -219,7 +755,14 @@ namespace gr {
             boost::recursive_mutex::scoped_lock lock(d_lock);
 
             // close file currently being processed
-            stop();
+            try {
+              finish_file();
+            }
+            catch (std::exception &e) {
+              if (error.empty()) {
+                error = e.what();
+              }
+            }
 
             // reset
             d_nremaining = d_nsamples;
@@ -227,27 +770,223 @@ namespace gr {
             // update sample time
             d_samp_time = d_samp_time_next;
 
-            // generate next file and open
-            d_filename = gen_filename();
+            // generate next file and open - if the file has been prepared
+            // this only swaps file handles
+            if (d_preopen) {
+              d_filename = wait_prepared();
+            }
+            if (d_file_counter) {
+              d_file_num = d_filename.empty() ? reserve_file_num() : d_prepare_file_num;
+            }
+            if (d_filename.empty()) {
+              gen_filename(d_filename, d_file_num, d_samp_time);
+            }
             open(d_filename);
-
-            // reset flag
-            d_is_started = true;
+            if (not d_file_preallocated) {
+              d_file_preallocated = preallocate(d_filename);
+            }
 
             // set next sample time
-            d_samp_time_next += d_T;
+            d_samp_time_next.advance(d_nsamples);
+
+            // get the following file ready
+            if (d_preopen) {
+              request_prepare();
+            }
           }
         }
+
+        if (not error.empty()) {
+          throw std::runtime_error(error);
+        }
       }
       else
       {
         // single file - write all samples
         uint64_t nwritten = (uint64_t)write_impl((void *)p,nitems);
+        if (d_file_checksum) {
+          d_crc = crc32c(d_crc, p, nwritten * d_itemsize);
+        }
         d_nwritten += nwritten;
         d_nwritten_total += nwritten;
       }
     }
 
+    void
+    file_writer_base::request_prepare()
+    {
+      boost::unique_lock<boost::mutex> lock(d_prepare_mutex);
+
+      // start helper thread on first use
+      if (not d_prepare_thread) {
+        d_prepare_finished = false;
+        d_prepare_thread = boost::shared_ptr<boost::thread>(
+            new boost::thread(boost::bind(&file_writer_base::prepare_run, this)));
+      }
+
+      // next file number and start time
+      if (d_file_counter) {
+        d_prepare_file_num = reserve_file_num();
+      }
+      else {
+        d_prepare_file_num = d_file_num + 1;
+        if (d_file_num_rollover > 0) { d_prepare_file_num %= (uint64_t)d_file_num_rollover; }
+      }
+      d_prepare_time = d_samp_time_next;
+      d_prepare_current = d_filename;
+      d_prepare_pending = true;
+      d_next_requested = true;
+      d_prepare_cond.notify_all();
+    }
+
+    std::string
+    file_writer_base::wait_prepared()
+    {
+      boost::unique_lock<boost::mutex> lock(d_prepare_mutex);
+      while (d_prepare_pending) {
+        d_prepare_cond.wait(lock);
+      }
+
+      // name is only valid once per request
+      if (not d_next_requested) {
+        return std::string();
+      }
+      d_next_requested = false;
+      return d_next_filename;
+    }
+
+    bool
+    file_writer_base::take_prepared(const std::string &fname)
+    {
+      boost::unique_lock<boost::mutex> lock(d_prepare_mutex);
+      if (d_next_prepared and (d_next_filename == fname)) {
+        d_next_prepared = false;
+        d_file_preallocated = d_next_preallocated;
+        return true;
+      }
+
+      return false;
+    }
+
+    void
+    file_writer_base::discard_next()
+    {
+      wait_prepared();
+
+      boost::unique_lock<boost::mutex> lock(d_prepare_mutex);
+      if (d_next_prepared) {
+        GR_LOG_DEBUG(d_logger, boost::format("Removing unused file %s") % d_next_filename);
+        discard_prepared();
+        ::unlink(d_next_filename.c_str());
+        d_next_prepared = false;
+      }
+    }
+
+    void
+    file_writer_base::prepare_run()
+    {
+      boost::unique_lock<boost::mutex> lock(d_prepare_mutex);
+      while (true) {
+        while ((not d_prepare_pending) and (not d_prepare_finished)) {
+          d_prepare_cond.wait(lock);
+        }
+        if (d_prepare_finished) {
+          break;
+        }
+
+        uint64_t file_num = d_prepare_file_num;
+        epoch_time file_time = d_prepare_time;
+        std::string current = d_prepare_current;
+        lock.unlock();
+
+        // a file with the same name as the current file can not be created
+        // in advance
+        std::string fname;
+        bool prepared = false;
+        try {
+          gen_filename(fname, file_num, file_time);
+          if (fname != current) {
+            prepared = prepare(fname);
+          }
+        }
+        catch (std::exception &e) {
+          GR_LOG_ERROR(d_logger, boost::format("Unable to prepare file %s: %s") % fname % e.what());
+        }
+        bool preallocated = prepared and preallocate(fname);
+
+        lock.lock();
+        d_next_filename = fname;
+        d_next_prepared = prepared;
+        d_next_preallocated = preallocated;
+        d_prepare_pending = false;
+        d_prepare_cond.notify_all();
+      }
+    }
+
+    bool
+    file_writer_base::preallocate(const std::string &fname)
+    {
+      int64_t nheader = header_size();
+      if ((not d_preallocate) or (d_nsamples == 0) or (nheader < 0)) {
+        return false;
+      }
+
+#ifdef __linux__
+      // allocation applies to the file, so a separate descriptor can be used
+      // regardless of how the writer accesses it
+      int fd = ::open(fname.c_str(), O_WRONLY);
+      if (fd < 0) {
+        return false;
+      }
+
+      off_t length = (off_t)nheader + (off_t)(d_nsamples * d_itemsize);
+      int ret = fallocate(fd, 0, 0, length);
+      int err = errno;
+      ::close(fd);
+      if (ret != 0) {
+        GR_LOG_DEBUG(d_logger, boost::format("Unable to preallocate file %s: %s") % fname % strerror(err));
+        return false;
+      }
+
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    bool
+    file_writer_base::create_exclusive(const std::string &fname)
+    {
+      int fd = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+      if (fd < 0) {
+        return false;
+      }
+
+      ::close(fd);
+      return true;
+    }
+
+    void
+    file_writer_base::shutdown()
+    {
+      // drain background I/O
+      if (d_async) {
+        set_async(false);
+      }
+
+      // remove any unused file and stop helper thread
+      if (d_prepare_thread) {
+        discard_next();
+        {
+          boost::unique_lock<boost::mutex> lock(d_prepare_mutex);
+          d_prepare_finished = true;
+          d_prepare_cond.notify_all();
+        }
+        d_prepare_thread->join();
+        d_prepare_thread.reset();
+      }
+    }
+
     void
     file_writer_base::gen_folder(epoch_time& start_time)
     {
@@ -298,81 +1037,21 @@ namespace gr {
     file_writer_base::gen_filename_base()
     {
       /**********************************************************************
-       * Generate base file name
+       * Compile file name specifier
        *
-       * Certain parameters can not change during a recording so we will
-       * generate the basename to avoid having to replace every specifier
-       * for each generated filename
+       * Certain parameters can not change during a recording so the name
+       * specifier is parsed once and only the file number and time are
+       * formatted for each generated filename
        *********************************************************************/
-      // reset name spec
-      d_name_spec = d_name_spec_base;
-
-      d_name_spec = strrepl(d_name_spec,"%fcM",d_freq,1000000);
-      d_name_spec = strrepl(d_name_spec,"%fck",d_freq,1000);
-      d_name_spec = strrepl(d_name_spec,"%fcc",d_freq,1);
-      d_name_spec = strrepl(d_name_spec,"%fsM",d_rate,1000000);
-      d_name_spec = strrepl(d_name_spec,"%fsk",d_rate,1000);
-      d_name_spec = strrepl(d_name_spec,"%fsc",d_rate,1);
+      d_name_format.compile(d_name_spec_base, d_full_out_path.string(), d_freq, (uint64_t)d_rate,
+                            d_channel);
 
     } /* end gen_filename_base */
 
-    std::string
-    file_writer_base::gen_filename()
-    {
-      // TODO: Move all this to run only once and replace the modulo file number
-      // only
-
-      // update basic file number specifier
-      std::string fname = strrepl(d_name_spec,"%fd",d_file_num % 100000,1,"%05d");
-
-      // update extended file number specifier
-      std::string temp = fname;
-      std::size_t found = temp.find('%');
-      while (found != std::string::npos) {
-        std::size_t end_ind = fname.find("fd",found);
-        size_t next_found = fname.find('%',found+1);
-
-        // build modifier based on number of files
-        if ((end_ind != std::string::npos) and (end_ind < next_found)) {
-          // string to replace
-          std::string modifier = fname.substr(found,end_ind+2-found);
-
-          // get number of files to process and generate replacement string
-          std::string repl = "%";
-          if (fname.find("0",found+1,1) != std::string::npos) {
-            repl += "0";
-            found++;
-          }
-
-          try {
-            // catch errors in parsing
-            std::string file_mod = fname.substr(found+1,end_ind-found-1);
-            int nchars = stoi(file_mod);
-            repl += (file_mod + "d");
-            fname = strrepl(fname,modifier,
-              d_file_num % int(pow(10.0,nchars)),1,repl);
-          }
-          catch(...) { /* NOOP */}
-
-          break;
-        }
-
-        // look for next occurence
-        found = next_found;
-      }
-
-      // file time
-      time_t sample_second = (time_t)d_samp_time.epoch_sec();
-      struct tm *gmt_start_time;
-      gmt_start_time = gmtime(&sample_second);
-
-      // populate date/time values
-      char time_temp[100];
-      strftime(time_temp,100,fname.c_str(),gmt_start_time);
-
-      // generate output file
-      fs::path outfile = d_full_out_path / std::string(time_temp);
-      return (outfile.string());
+    void
+    file_writer_base::gen_filename(std::string &fname, uint64_t file_num, epoch_time time)
+    {
+      d_name_format.render(fname, file_num, time.epoch_sec());
 
     } /* end gen_filename */
   } /* namespace sandia_utils */
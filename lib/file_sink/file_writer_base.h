@@ -17,20 +17,51 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
+#include <vector>
 #include <sandia_utils/api.h>
 #include <pmt/pmt.h>
 #include <gnuradio/logger.h>
 #include "../epoch_time.h"
+#include "file_io_pool.h"
+#include "file_name_spec.h"
 
 namespace gr
 {
   namespace sandia_utils
   {
+    /**
+     * File number source shared by writers that record concurrently, so
+     * that every file they create gets a distinct number.
+     */
+    class SANDIA_UTILS_API file_num_counter
+    {
+      public:
+        typedef boost::shared_ptr<file_num_counter> sptr;
+
+        file_num_counter( uint64_t first = 0 ) : d_next(first) {}
+
+        /**
+         * Reserve the next file number
+         */
+        uint64_t next()
+        {
+          boost::unique_lock<boost::mutex> lock( d_mutex );
+          return d_next++;
+        }
+
+      private:
+        boost::mutex d_mutex;
+        uint64_t d_next;
+    }; // end class file_num_counter
+
     class SANDIA_UTILS_API file_writer_base
     {
       public:
         typedef boost::shared_ptr<file_writer_base> sptr;
-        typedef boost::function<void( std::string, epoch_time, double, double )> callback;
+        typedef boost::function<void( std::string, epoch_time, double, double, int64_t )> callback;
 
         /*!
          * \brief Return a shared_ptr to a new instance of sandia_utils::file_writer_base.
@@ -70,7 +101,9 @@ namespace gr
         /*!
          * \brief Register update callback
          *
-         * Register a method to be called upon file completion
+         * Register a method to be called upon file completion with the file
+         * name, time of the first sample, center frequency, sample rate and
+         * checksum of the file's samples, or -1 if checksums are disabled.
          *
          * param callback Callback function
          */
@@ -116,11 +149,10 @@ namespace gr
         /*!
          * \brief Set center frequency
          *
+         * With background I/O the change is queued behind data and start/stop
+         * requests already written, so it applies to the files that follow.
          */
-        void set_freq( uint64_t freq )
-        {
-          d_freq = freq;
-        }
+        void set_freq( uint64_t freq );
 
         /*!
          * \brief GSet center frequency
@@ -128,29 +160,15 @@ namespace gr
          */
         uint64_t get_freq()
         {
-          return d_freq;
+          return d_set_freq;
         }
 
         /*!
          * \brief Set sampling rate
          *
+         * Queued like set_freq() with background I/O.
          */
-        void set_rate( int rate )
-        {
-          boost::recursive_mutex::scoped_lock lock( d_mutex );
-
-          // only update for valid sampling rate
-          if (rate > 0) {
-              d_rate = rate;
-              d_T = (double)d_nsamples / (double)d_rate;
-          } else {
-              GR_LOG_DEBUG(
-                  d_logger,
-                  boost::format(
-                      "Invalid sampling rate %d.  Rate must be greater than zero") %
-                      rate);
-          }
-        }
+        void set_rate( int rate );
 
         /*!
          * \brief Get current sampling rate
@@ -158,7 +176,7 @@ namespace gr
          */
         int get_rate()
         {
-          return d_rate;
+          return d_set_rate;
         }
 
         /*!
@@ -170,14 +188,13 @@ namespace gr
           boost::recursive_mutex::scoped_lock lock( d_mutex );
 
           d_nsamples = nsamples;
-          d_T = (double)d_nsamples / (double)d_rate;
         }
 
         /*!
          * \brief Get number of samples per file
          *
          */
-        int get_nsamples()
+        uint64_t get_nsamples()
         {
           return d_nsamples;
         }
@@ -202,6 +219,207 @@ namespace gr
           return d_file_num_rollover;
         }
 
+        /*!
+         * \brief Set channel number
+         *
+         * Channel number substituted for the %ch name specifier.  Takes
+         * effect on the next start.
+         */
+        void set_channel( int channel )
+        {
+          boost::recursive_mutex::scoped_lock lock( d_mutex );
+
+          d_channel = channel;
+        }
+
+        /*!
+         * \brief Get channel number
+         *
+         */
+        int get_channel()
+        {
+          return d_channel;
+        }
+
+        /*!
+         * \brief Share file numbers with other writers
+         *
+         * Each file started after this call takes its number from the
+         * counter instead of the writer's own sequence.  Numbers reserved for
+         * files opened in advance but never used are skipped.
+         */
+        void set_file_counter( file_num_counter::sptr counter )
+        {
+          boost::recursive_mutex::scoped_lock lock( d_mutex );
+
+          d_file_counter = counter;
+        }
+
+        /*!
+         * \brief Get number of the next file to be started
+         *
+         * Only meaningful while the writer is stopped and not sharing file
+         * numbers.
+         */
+        uint64_t get_file_num()
+        {
+          return d_file_num;
+        }
+
+        /*!
+         * \brief Enable/disable opening of the next file in advance
+         *
+         * When enabled and the number of samples per file is non-zero, the
+         * name of the next file is generated and the file created by a helper
+         * thread while the current file is being written, so that a rollover
+         * only swaps file handles.  A prepared file that is not used (the
+         * writer is stopped first) is removed.  Existing files are never
+         * prepared in advance.
+         */
+        void set_preopen( bool preopen )
+        {
+          boost::recursive_mutex::scoped_lock lock( d_mutex );
+
+          d_preopen = preopen;
+        }
+
+        /*!
+         * \brief Determine if next file is opened in advance
+         *
+         */
+        bool get_preopen()
+        {
+          return d_preopen;
+        }
+
+        /*!
+         * \brief Enable/disable preallocation of fixed-size files
+         *
+         * When enabled and the number of samples per file is non-zero, the
+         * full extent of each file is reserved with fallocate when the file
+         * is opened, avoiding fragmentation and per-write allocation.  A file
+         * that is closed early is truncated to the data actually written.
+         */
+        void set_preallocate( bool preallocate )
+        {
+          boost::recursive_mutex::scoped_lock lock( d_mutex );
+
+          d_preallocate = preallocate;
+        }
+
+        /*!
+         * \brief Determine if files are preallocated
+         *
+         */
+        bool get_preallocate()
+        {
+          return d_preallocate;
+        }
+
+        /*!
+         * \brief Enable/disable per-file checksums
+         *
+         * When enabled, a CRC32C checksum of the samples written to each
+         * file is accumulated as they are written and passed to the
+         * completion callback.  With background I/O it is computed by the
+         * I/O thread.  File headers and metadata are not included, so for
+         * Raw IQ files it is the checksum of the whole file.  Takes effect
+         * on the next file.
+         */
+        void set_checksum( bool checksum )
+        {
+          boost::recursive_mutex::scoped_lock lock( d_mutex );
+
+          d_checksum = checksum;
+        }
+
+        /*!
+         * \brief Determine if per-file checksums are computed
+         *
+         */
+        bool get_checksum()
+        {
+          return d_checksum;
+        }
+
+        /*!
+         * \brief Enable/disable background I/O
+         *
+         * When enabled, write() only copies samples into a bounded ring of
+         * preallocated buffers and returns.  A dedicated thread performs all
+         * file operations, including file open/close at rollover.  When all
+         * buffers are in use, write() either blocks until a buffer is
+         * released (back-pressure) or discards the samples if drop is set.
+         *
+         * Disabling background I/O waits for all queued data to be written.
+         *
+         * @param async - enable background I/O
+         * @param nbuffers - number of buffers in ring
+         * @param buffer_size - size of each buffer (bytes)
+         * @param drop - discard samples instead of blocking when ring is full
+         */
+        void set_async( bool async, size_t nbuffers = 16, size_t buffer_size = 4194304, bool drop = false );
+
+        /*!
+         * \brief Use shared I/O threads for background I/O
+         *
+         * When a pool is set, enabling background I/O does not start a
+         * dedicated thread; buffers are written by the pool threads instead.
+         * Takes effect the next time background I/O is enabled.  A null
+         * pool restores the dedicated thread.
+         *
+         * @param pool - shared I/O threads
+         */
+        void set_io_pool( file_io_pool::sptr pool )
+        {
+          d_io_pool = pool;
+        }
+
+        /*!
+         * \brief Determine if background I/O is enabled
+         *
+         */
+        bool get_async()
+        {
+          return d_async;
+        }
+
+        /*!
+         * \brief Get number of times write() blocked waiting on a free buffer
+         *
+         */
+        uint64_t get_nstalls()
+        {
+          return d_nstalls;
+        }
+
+        /*!
+         * \brief Get number of samples discarded due to a full buffer ring
+         *
+         */
+        uint64_t get_ndropped()
+        {
+          return d_ndropped;
+        }
+
+        /*!
+         * \brief Get number of queued operations that failed in the background
+         *
+         * Errors raised while writing are logged by the I/O thread, the
+         * affected samples or files are lost.
+         */
+        uint64_t get_nerrors()
+        {
+          return d_nerrors;
+        }
+
+        /*!
+         * \brief Wait for all queued data to be written
+         *
+         * Returns immediately if background I/O is disabled.
+         */
+        void flush();
+
         /*!
          * \brief Start file writer
          *
@@ -235,6 +453,52 @@ namespace gr
          */
         void write( const void *in, int nitems );
 
+        /*!
+         * \brief Start a new capture
+         *
+         * Marks a change of center frequency or sample time, and for file
+         * types that allow it sample rate, at the current position in the
+         * stream without starting a new file.  Ignored unless the file type
+         * supports captures and a file is being written.  The center
+         * frequency and sample rate must already be set.
+         *
+         * @param time - time of the next sample
+         * @param freq - center frequency (Hz)
+         * @param rate - sample rate (Hz)
+         */
+        void capture( epoch_time time, uint64_t freq, int rate );
+
+        /*!
+         * \brief Start/end an annotated region
+         *
+         * Marks the start or end of a region of interest, such as a burst, at
+         * the current position in the stream.  A region that spans several
+         * files is annotated in each of them.  Ignored unless the file type
+         * supports captures.
+         */
+        void annotate( bool active );
+
+        /*!
+         * \brief Determine if the file type records captures and annotations
+         *
+         * A file of such a type can hold samples with different center
+         * frequencies and discontinuous time.
+         */
+        virtual bool supports_captures()
+        {
+          return false;
+        }
+
+        /*!
+         * \brief Determine if a capture can change the sample rate
+         *
+         * Otherwise a new sample rate always starts a new file.
+         */
+        virtual bool captures_rate()
+        {
+          return false;
+        }
+
         /*!
          * \brief Open file for processing
          *
@@ -254,7 +518,121 @@ namespace gr
          */
         virtual int write_impl( const void *in, int nitems ) = 0;
 
+        /*!
+         * \brief Prepare the next file
+         *
+         * Called from a helper thread while the current file is being
+         * written.  Implementations that support opening the next file in
+         * advance create the file and keep the handle, which is then used by
+         * the next call to open() with the same file name.  This method must
+         * not touch the handle of the file currently being written.
+         *
+         * @return true if the file was prepared
+         */
+        virtual bool prepare( std::string fname )
+        {
+          return false;
+        }
+
+        /*!
+         * \brief Release the handle of a prepared file
+         *
+         * The file itself is removed by the base class.
+         */
+        virtual void discard_prepared()
+        {
+        }
+
+        /*!
+         * \brief Size of file header
+         *
+         * Number of bytes written to a file in addition to the samples, used
+         * to determine the size of a preallocated file.  A negative value
+         * indicates the file layout is not known in advance and files are
+         * not preallocated.
+         */
+        virtual int64_t header_size()
+        {
+          return 0;
+        }
+
       protected:
+        /*!
+         * \brief Record a capture
+         *
+         * Called in stream order while a file is open.
+         *
+         * @param sample - index of the first sample of the capture in the file
+         * @param time - time of that sample
+         * @param freq - center frequency (Hz)
+         * @param rate - sample rate (Hz)
+         */
+        virtual void capture_impl( uint64_t sample, const epoch_time &time, uint64_t freq, int rate )
+        {
+        }
+
+        /*!
+         * \brief Record an annotation
+         *
+         * Called in stream order while a file is open, when an annotated
+         * region ends or the file is closed.
+         *
+         * @param sample - index of the first annotated sample in the file
+         * @param count - number of annotated samples
+         */
+        virtual void annotation_impl( uint64_t sample, uint64_t count )
+        {
+        }
+
+        /*!
+         * \brief Complete a closed file
+         *
+         * Called after close() with the file's completion callback, if one
+         * is due.  Writers that finish a file in the background keep it and
+         * issue it once the file is complete.
+         *
+         * @param done - issues the completion callback, may be empty
+         */
+        virtual void file_closed( boost::function<void()> done )
+        {
+          if( done ) { done(); }
+        }
+
+        /*!
+         * \brief Wait for files finishing in the background
+         *
+         * Called when the writer is stopped, so every file is complete and
+         * its callback issued.  Errors are raised as exceptions.
+         */
+        virtual void wait_closed()
+        {
+        }
+
+        /*!
+         * \brief Take ownership of a prepared file
+         *
+         * Used by open() to determine if the handle obtained by prepare() can
+         * be used for the file being opened.
+         *
+         * @return true if a prepared handle for fname is available
+         */
+        bool take_prepared( const std::string &fname );
+
+        /*!
+         * \brief Create a new, empty file
+         *
+         * @return false if the file already exists or can not be created
+         */
+        static bool create_exclusive( const std::string &fname );
+
+        /*!
+         * \brief Stop all helper threads
+         *
+         * Must be called by derived class destructors before closing files,
+         * since the threads call back into the derived class.
+         */
+        void shutdown();
+
         // file name_spec
         std::string d_filename;
         // data type string
@@ -273,12 +651,14 @@ namespace gr
         // sample rate
         int d_rate;
 
-        // file sample period (seconds)
-        double d_T;
-
         // center frequency
         uint64_t d_freq;
 
+        // rate and frequency most recently set, with background I/O d_rate
+        // and d_freq only change when the I/O thread reaches the update
+        int d_set_rate;
+        uint64_t d_set_freq;
+
         // base output directory
         std::string d_out_dir;
 
@@ -286,8 +666,8 @@ namespace gr
         boost::filesystem::path d_full_out_path;
 
         // name specification
-        std::string d_name_spec;
         std::string d_name_spec_base;
+        file_name_spec d_name_format;
 
         // generate new folder on start
         bool d_new_folder;
@@ -298,6 +678,7 @@ namespace gr
 
         // file number
         uint64_t d_file_num = 0;
+        file_num_counter::sptr d_file_counter;
 
         // number of samples written and remaining
         uint64_t d_nwritten;
@@ -320,14 +701,125 @@ namespace gr
         // file number rollover - value less than 0 indicates no rollover
         int d_file_num_rollover;
 
+        // channel number for name specifier
+        int d_channel;
+
       private:
         void gen_folder( epoch_time &start_time );
         void gen_filename_base();
-        std::string gen_filename();
+        void gen_filename( std::string &fname, uint64_t file_num, epoch_time time );
+
+        // synchronous implementations of start/stop/write/capture/annotate
+        void do_start( epoch_time start_time );
+        void do_stop();
+        void do_write( const void *in, uint64_t nitems );
+        void do_capture( epoch_time time, uint64_t freq, int rate );
+        void do_annotate( bool active );
+        void do_config( uint64_t freq, int rate );
+
+        // annotated region in progress and its first sample in the file
+        bool d_annotating;
+        uint64_t d_annotation_start;
+
+        // close current file and signal completion
+        void finish_file();
+
+        // reserve the number of a new file from the shared counter
+        uint64_t reserve_file_num();
+
+        // reserve full extent of a file
+        bool preallocate( const std::string &fname );
+
+        bool d_preallocate;
+        bool d_file_preallocated;
+
+        // checksum setting, whether it applies to the current file, and
+        // checksum of the samples written to it
+        bool d_checksum;
+        bool d_file_checksum;
+        uint32_t d_crc;
+
+        /**********************************************************************
+         * Next file preparation
+         *********************************************************************/
+        // request the file following the current one to be prepared
+        void request_prepare();
+        // wait for outstanding request and return the name of the next file,
+        // or an empty string if no file was requested
+        std::string wait_prepared();
+        // remove a prepared file that will not be used
+        void discard_next();
+        // helper thread
+        void prepare_run();
+
+        bool d_preopen;
+        bool d_prepare_pending;
+        bool d_prepare_finished;
+        uint64_t d_prepare_file_num;
+        epoch_time d_prepare_time;
+        std::string d_prepare_current;
+        std::string d_next_filename;
+        bool d_next_requested;
+        bool d_next_prepared;
+        bool d_next_preallocated;
+        boost::mutex d_prepare_mutex;
+        boost::condition_variable d_prepare_cond;
+        boost::shared_ptr<boost::thread> d_prepare_thread;
 
         // thread-safe locking
         boost::recursive_mutex d_lock;
 
+        /**********************************************************************
+         * Background I/O
+         *********************************************************************/
+        enum io_op_t { IO_DATA, IO_START, IO_STOP, IO_CAPTURE, IO_ANNOTATE, IO_CONFIG };
+        struct io_block_t
+        {
+          io_op_t op;
+          epoch_time time;
+          uint64_t value;
+          int rate;
+          size_t nitems;
+          std::vector<char> data;
+        };
+
+        // reserve the next free block in the ring, returns false if the
+        // block could not be obtained without waiting and drop is requested
+        bool io_reserve( boost::unique_lock<boost::mutex> &lock, bool can_drop );
+        // publish the block currently being filled
+        void io_publish( boost::unique_lock<boost::mutex> &lock );
+        // queue a control operation
+        void io_command( io_op_t op, epoch_time time, uint64_t value = 0, int rate = 0 );
+        // write the block at the head of the queue
+        void io_process( boost::unique_lock<boost::mutex> &lock );
+        // dedicated I/O thread
+        void io_run();
+        // service queued blocks from a shared pool thread
+        friend class file_io_pool;
+        void io_drain();
+
+        bool d_async;
+        bool d_drop;
+        std::vector<io_block_t> d_io_ring;
+        size_t d_io_block_items;
+        size_t d_io_head;           // next block to be written to disk
+        size_t d_io_count;          // number of blocks queued for writing
+        bool d_io_filling;          // block following queue is partially filled
+        bool d_io_busy;             // I/O thread is processing a block
+        bool d_io_finished;
+        boost::mutex d_io_mutex;
+        boost::condition_variable d_io_data_cond;
+        boost::condition_variable d_io_space_cond;
+        boost::shared_ptr<boost::thread> d_io_thread;
+        file_io_pool::sptr d_io_pool;       // pool to use when enabled
+        file_io_pool::sptr d_io_shared;     // pool in use, if any
+        bool d_io_scheduled;        // queued on or serviced by the pool
+
+        // statistics
+        uint64_t d_nstalls;
+        uint64_t d_ndropped;
+        uint64_t d_nerrors;
+
     };
 
   } // namespace sandia_utils
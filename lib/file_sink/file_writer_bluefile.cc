@@ -33,7 +33,8 @@ namespace gr {
 
     file_writer_bluefile::~file_writer_bluefile()
     {
-      // ensure file descriptor is closed
+      // ensure queued data is written and file descriptor is closed
+      shutdown();
       close();
     }
 
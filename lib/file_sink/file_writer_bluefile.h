@@ -59,6 +59,12 @@ namespace gr {
        */
       void close();
 
+      /*!
+       * Layout is managed by the bluefile library, so files are never
+       * preallocated
+       */
+      int64_t header_size() { return -1; }
+
       /*!
        * Write data
        */
@@ -0,0 +1,367 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "file_writer_compressed.h"
+
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <errno.h>
+#include <stdexcept>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// uncompressed size of each block
+#define COMPRESSED_BLOCK_SIZE (1024 * 1024)
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    file_writer_compressed::file_writer_compressed( std::string data_type, std::string file_type, size_t itemsize,
+        uint64_t nsamples, int rate, std::string out_dir, std::string name_spec, gr::logger_ptr logger ) :
+        file_writer_base( data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, logger )
+    {
+      d_fd = -1;
+      d_offset = 0;
+      d_nitems = 0;
+      d_failed = false;
+      d_block_items = std::max( COMPRESSED_BLOCK_SIZE / itemsize, (size_t)1 );
+      d_codec = default_codec();
+      d_max_pending = 0;
+
+      // complex and real 16 bit integers can be bit-packed
+      d_int16 = (data_type == "complex_int") or (data_type == "short");
+    }
+
+    file_writer_compressed::~file_writer_compressed()
+    {
+      // ensure queued data is written and file descriptor is closed
+      shutdown();
+      try
+      {
+        close();
+      }
+      catch( std::exception &e )
+      {
+        GR_LOG_ERROR(d_logger, e.what());
+      }
+    }
+
+    void file_writer_compressed::open( std::string fname )
+    {
+      GR_LOG_DEBUG(d_logger,boost::format("Opening file %s") % fname.c_str());
+
+      // worker threads are only started once needed
+      if( not d_pool )
+      {
+        d_pool = codec_pool::shared();
+        d_max_pending = 2 * d_pool->get_nthreads();
+      }
+
+      d_fd = ::open( fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+      if( d_fd < 0 )
+      {
+        perror( fname.c_str() );
+        throw std::runtime_error( "file_sink: can't open file" );
+      }
+
+      // header with the same metadata as the raw header format
+      compressed_file_header_t hdr;
+      memset( &hdr, 0, sizeof(hdr) );
+      memcpy( hdr.magic, COMPRESSED_FILE_MAGIC, sizeof(hdr.magic) );
+      hdr.version = COMPRESSED_FORMAT_VERSION;
+      hdr.itemsize = (uint32_t)d_itemsize;
+      hdr.block_items = (uint32_t)d_block_items;
+      hdr.int16 = d_int16 ? 1 : 0;
+      hdr.metadata[0] = (double)d_freq;
+      hdr.metadata[1] = (double)d_rate;
+      hdr.metadata[2] = d_samp_time.dtime();
+      try
+      {
+        write_fd( (const char *)&hdr, sizeof(hdr) );
+      }
+      catch( std::exception &e )
+      {
+        ::close( d_fd );
+        d_fd = -1;
+        throw;
+      }
+
+      d_offset = sizeof(hdr);
+      d_nitems = 0;
+      d_index.clear();
+      d_failed = false;
+    }
+
+    void file_writer_compressed::close()
+    {
+      if( d_fd < 0 )
+      {
+        return;
+      }
+
+      GR_LOG_DEBUG(d_logger,boost::format("Closing file %s") % d_filename);
+
+      // the file is closed even if the remaining data can not be written
+      std::string error;
+      try
+      {
+        // partial last block
+        if( d_current and d_current->nbytes and (not d_failed) )
+        {
+          submit();
+        }
+      }
+      catch( std::exception &e )
+      {
+        error = e.what();
+      }
+      release_current();
+
+      // every block of this file must be taken off the queue before the
+      // next file is opened
+      try
+      {
+        write_blocks( true );
+      }
+      catch( std::exception &e )
+      {
+        if( error.empty() )
+        {
+          error = e.what();
+        }
+      }
+
+      // block index and trailer, a failed file is left without them so it
+      // can not be mistaken for a complete one
+      if( not d_failed )
+      {
+        compressed_trailer_t trailer;
+        memset( &trailer, 0, sizeof(trailer) );
+        trailer.index_offset = d_offset;
+        trailer.nblocks = d_index.size();
+        trailer.nitems = d_nitems;
+        memcpy( trailer.magic, COMPRESSED_TRAILER_MAGIC, sizeof(trailer.magic) );
+        try
+        {
+          if( d_index.size() )
+          {
+            write_fd( (const char *)&d_index[0], d_index.size() * sizeof(uint64_t) );
+          }
+          write_fd( (const char *)&trailer, sizeof(trailer) );
+        }
+        catch( std::exception &e )
+        {
+          error = e.what();
+        }
+      }
+      else
+      {
+        GR_LOG_ERROR(d_logger,boost::format("Closing incomplete file %s") % d_filename);
+      }
+
+      ::close( d_fd );
+      d_fd = -1;
+      d_failed = false;
+
+      if( not error.empty() )
+      {
+        throw std::runtime_error( error );
+      }
+    }
+
+    int file_writer_compressed::write_impl( const void *in, int nitems )
+    {
+      // data of a failed file is dropped until the next file
+      if( d_failed )
+      {
+        return nitems;
+      }
+
+      const char *p = (const char *)in;
+      size_t nbytes = nitems * d_itemsize;
+      size_t block_bytes = d_block_items * d_itemsize;
+      std::string error;
+
+      while( nbytes )
+      {
+        if( not d_current )
+        {
+          // reuse the buffers of a block already written
+          if( d_free.size() )
+          {
+            d_current = d_free.back();
+            d_free.pop_back();
+          }
+          else
+          {
+            d_current = job_sptr( new job_t );
+            d_current->raw.resize( block_bytes );
+          }
+          d_current->nbytes = 0;
+        }
+
+        size_t ncopy = std::min( nbytes, block_bytes - d_current->nbytes );
+        memcpy( &d_current->raw[d_current->nbytes], p, ncopy );
+        d_current->nbytes += ncopy;
+        p += ncopy;
+        nbytes -= ncopy;
+
+        // all of the data is taken even if the block can not be written
+        if( d_current->nbytes == block_bytes )
+        {
+          try
+          {
+            submit();
+          }
+          catch( std::exception &e )
+          {
+            error = e.what();
+            break;
+          }
+        }
+      }
+
+      d_nitems += nitems;
+      if( not error.empty() )
+      {
+        throw std::runtime_error( error );
+      }
+      return nitems;
+    }
+
+    void file_writer_compressed::submit()
+    {
+      job_sptr job = d_current;
+      d_current.reset();
+      job->done = false;
+      job->error.clear();
+      {
+        boost::unique_lock<boost::mutex> lock( d_job_mutex );
+        d_pending.push_back( job );
+      }
+      d_pool->submit( boost::bind( &file_writer_compressed::encode, this, job ) );
+
+      // write blocks already coded, waiting only if too many are in flight
+      write_blocks( false );
+    }
+
+    void file_writer_compressed::release_current()
+    {
+      if( d_current )
+      {
+        d_free.push_back( d_current );
+        d_current.reset();
+      }
+    }
+
+    void file_writer_compressed::encode( job_sptr job )
+    {
+      // the job is completed even if it fails, the writer waits for it
+      std::string error;
+      try
+      {
+        encode_block( &job->raw[0], (uint32_t)job->nbytes, d_int16, d_codec, job->hdr,
+            job->coded, job->scratch );
+      }
+      catch( std::exception &e )
+      {
+        error = e.what();
+      }
+
+      boost::unique_lock<boost::mutex> lock( d_job_mutex );
+      job->error = error;
+      job->done = true;
+      d_job_cond.notify_all();
+    }
+
+    void file_writer_compressed::write_blocks( bool all )
+    {
+      // every finished block is taken off the queue, the first error is
+      // reported once they have been
+      std::string error;
+      boost::unique_lock<boost::mutex> lock( d_job_mutex );
+      while( d_pending.size() )
+      {
+        job_sptr job = d_pending.front();
+        if( not job->done )
+        {
+          if( (not all) and (d_pending.size() < d_max_pending) )
+          {
+            break;
+          }
+          while( not job->done )
+          {
+            d_job_cond.wait( lock );
+          }
+        }
+        d_pending.pop_front();
+        lock.unlock();
+
+        // the index only holds blocks written in full
+        if( not d_failed )
+        {
+          try
+          {
+            if( not job->error.empty() )
+            {
+              throw std::runtime_error( str( boost::format( "Unable to code block of file %s: %s" ) %
+                  d_filename % job->error ) );
+            }
+            write_fd( (const char *)&job->hdr, sizeof(job->hdr) );
+            write_fd( &job->coded[0], job->coded.size() );
+            d_index.push_back( d_offset );
+            d_offset += sizeof(job->hdr) + job->coded.size();
+          }
+          catch( std::exception &e )
+          {
+            d_failed = true;
+            error = e.what();
+          }
+        }
+
+        lock.lock();
+        d_free.push_back( job );
+      }
+      lock.unlock();
+
+      if( not error.empty() )
+      {
+        throw std::runtime_error( error );
+      }
+    }
+
+    void file_writer_compressed::write_fd( const char *buf, size_t nbytes )
+    {
+      while( nbytes )
+      {
+        ssize_t n = ::write( d_fd, buf, nbytes );
+        if( n < 0 )
+        {
+          if( errno == EINTR )
+          {
+            continue;
+          }
+          throw std::runtime_error( str( boost::format( "Unable to write to file %s: %s" ) %
+              d_filename % strerror( errno ) ) );
+        }
+        buf += n;
+        nbytes -= n;
+      }
+    }
+
+  } /* namespace sandia_utils */
+} /* namespace gr */
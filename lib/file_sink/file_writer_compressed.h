@@ -0,0 +1,108 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_FILE_WRITER_COMPRESSED_H
+#define INCLUDED_SANDIA_UTILS_FILE_WRITER_COMPRESSED_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <sandia_utils/api.h>
+#include "file_writer_base.h"
+#include "../compressed_format.h"
+
+namespace gr {
+  namespace sandia_utils {
+    /*!
+     * Block compressed file writer
+     *
+     * Samples are collected into fixed size blocks that are coded by a pool
+     * of worker threads while later blocks are being collected.  Coded
+     * blocks are written in order, and the block index is written when the
+     * file is closed.  See compressed_format.h for the file layout.
+     */
+    class SANDIA_UTILS_API file_writer_compressed: public file_writer_base
+    {
+    private:
+      struct job_t {
+        std::vector<char> raw;
+        size_t nbytes;
+        std::vector<char> coded;
+        std::vector<char> scratch;
+        compressed_block_header_t hdr;
+        bool done;
+
+        // coding error, empty if the block was coded
+        std::string error;
+      };
+      typedef boost::shared_ptr<job_t> job_sptr;
+
+      int                   d_fd;
+      uint64_t              d_offset;
+      uint64_t              d_nitems;
+      std::vector<uint64_t> d_index;
+
+      // a block of the current file could not be coded or written, the
+      // rest of its data is dropped and it is closed without an index
+      bool                  d_failed;
+
+      // block layout and coding
+      size_t                d_block_items;
+      bool                  d_int16;
+      block_codec_t         d_codec;
+
+      // block being filled, blocks being coded in file order and blocks
+      // available for reuse
+      job_sptr              d_current;
+      std::deque<job_sptr>  d_pending;
+      std::vector<job_sptr> d_free;
+      size_t                d_max_pending;
+      boost::mutex          d_job_mutex;
+      boost::condition_variable d_job_cond;
+      codec_pool::sptr      d_pool;
+
+      void submit();
+      void encode(job_sptr job);
+      void write_blocks(bool all);
+      void release_current();
+      void write_fd(const char *buf, size_t nbytes);
+
+    public:
+      file_writer_compressed(std::string data_type, std::string file_type,
+                    size_t itemsize, uint64_t nsamples, int rate,
+                    std::string out_dir, std::string name_spec, gr::logger_ptr logger);
+      ~file_writer_compressed();
+
+      /*!
+       * Open a new file
+       */
+      void open(std::string fname);
+
+      /*!
+       * Write remaining blocks and index and close the current file -
+       * throws std::runtime_error if the file is incomplete
+       */
+      void close();
+
+      /*!
+       * File size depends on the data
+       */
+      int64_t header_size() { return -1; }
+
+      /*!
+       * Write data - throws std::runtime_error when a block can not be
+       * coded or written
+       */
+      int write_impl(const void *in, int nitems);
+    };
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_FILE_WRITER_COMPRESSED_H */
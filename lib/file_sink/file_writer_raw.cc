@@ -30,14 +30,23 @@ namespace gr
 
     file_writer_raw::~file_writer_raw()
     {
-      // ensure file descriptor is closed
+      // ensure queued data is written and file descriptor is closed
+      shutdown();
       close();
     }
 
     void file_writer_raw::open( std::string fname )
     {
       GR_LOG_DEBUG(d_logger,boost::format("Opening file %s") % fname.c_str());
-      d_outfile.open( fname.c_str(), std::ofstream::binary );
+      if( take_prepared( fname ) )
+      {
+        // file was created in advance
+        d_outfile.swap( d_next_outfile );
+      }
+      else
+      {
+        d_outfile.open( fname.c_str(), std::ofstream::binary );
+      }
     }
 
     void file_writer_raw::close()
@@ -50,6 +59,32 @@ namespace gr
       }
     }
 
+    bool file_writer_raw::prepare( std::string fname )
+    {
+      // never replace an existing file before it is due
+      if( not create_exclusive( fname ) )
+      {
+        return false;
+      }
+
+      d_next_outfile.open( fname.c_str(), std::ofstream::binary );
+      if( not d_next_outfile.is_open() )
+      {
+        ::remove( fname.c_str() );
+        return false;
+      }
+
+      return true;
+    }
+
+    void file_writer_raw::discard_prepared()
+    {
+      if( d_next_outfile.is_open() )
+      {
+        d_next_outfile.close();
+      }
+    }
+
     int file_writer_raw::write_impl( const void *in, int nitems )
     {
       d_outfile.write( (const char*)in, nitems * d_itemsize );
@@ -20,6 +20,7 @@ namespace gr {
     {
     private:
       std::ofstream         d_outfile;
+      std::ofstream         d_next_outfile;
 
     public:
       file_writer_raw(std::string data_type, std::string file_type,
@@ -37,6 +38,16 @@ namespace gr {
        */
       void close();
 
+      /*!
+       * Create and open the next file in advance
+       */
+      bool prepare(std::string fname);
+
+      /*!
+       * Close the next file if it will not be used
+       */
+      void discard_prepared();
+
       /*!
        * Write data
        */
@@ -0,0 +1,213 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "file_writer_raw_direct.h"
+
+#include <boost/format.hpp>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// direct I/O is not available on all platforms
+#ifndef O_DIRECT
+#define O_DIRECT 0
+#endif
+
+// size of staging buffer
+#define RAW_DIRECT_BUFFER_SIZE (4 * 1024 * 1024)
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    file_writer_raw_direct::file_writer_raw_direct( std::string data_type, std::string file_type, size_t itemsize,
+        uint64_t nsamples, int rate, std::string out_dir, std::string name_spec, gr::logger_ptr logger ) :
+        file_writer_base( data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, logger )
+    {
+      d_fd = -1;
+      d_direct = false;
+      d_next_fd = -1;
+      d_next_direct = false;
+      d_buffer_used = 0;
+
+      // staging buffer must be aligned to (and a multiple of) the page size
+      long page_size = sysconf(_SC_PAGESIZE);
+      d_alignment = (page_size > 0) ? (size_t)page_size : 4096;
+      d_buffer_size = RAW_DIRECT_BUFFER_SIZE - (RAW_DIRECT_BUFFER_SIZE % d_alignment);
+      if (posix_memalign((void **)&d_buffer, d_alignment, d_buffer_size) != 0) {
+        throw std::runtime_error("file_sink: unable to allocate aligned buffer");
+      }
+    }
+
+    file_writer_raw_direct::~file_writer_raw_direct()
+    {
+      // ensure queued data is written and file descriptor is closed
+      shutdown();
+      try {
+        close();
+      }
+      catch (std::exception &e) {
+        GR_LOG_ERROR(d_logger, e.what());
+      }
+
+      free(d_buffer);
+    }
+
+    void file_writer_raw_direct::open( std::string fname )
+    {
+      GR_LOG_DEBUG(d_logger,boost::format("Opening file %s") % fname.c_str());
+
+      if (take_prepared(fname)) {
+        // file was created in advance
+        d_fd = d_next_fd;
+        d_direct = d_next_direct;
+        d_next_fd = -1;
+      } else {
+        d_fd = open_fd(fname, O_TRUNC, d_direct);
+      }
+      if (d_fd < 0) {
+        perror(fname.c_str());
+        throw std::runtime_error("file_sink: can't open file");
+      }
+
+      d_buffer_used = 0;
+    }
+
+    int file_writer_raw_direct::open_fd( const std::string &fname, int flags, bool &direct )
+    {
+      // not all file systems support direct I/O (tmpfs for example) so
+      // fall back to regular writes
+      direct = (O_DIRECT != 0);
+      int fd = ::open( fname.c_str(), O_WRONLY | O_CREAT | flags | O_DIRECT, 0644 );
+      if ((fd < 0) and (errno == EINVAL)) {
+        GR_LOG_DEBUG(d_logger,boost::format("Direct I/O not supported for %s") % fname.c_str());
+        direct = false;
+        fd = ::open( fname.c_str(), O_WRONLY | O_CREAT | flags, 0644 );
+      }
+
+      return fd;
+    }
+
+    bool file_writer_raw_direct::prepare( std::string fname )
+    {
+      // never replace an existing file before it is due
+      d_next_fd = open_fd(fname, O_EXCL, d_next_direct);
+      return (d_next_fd >= 0);
+    }
+
+    void file_writer_raw_direct::discard_prepared()
+    {
+      if (d_next_fd >= 0) {
+        ::close(d_next_fd);
+        d_next_fd = -1;
+      }
+    }
+
+    void file_writer_raw_direct::close()
+    {
+      if( d_fd >= 0 )
+      {
+        GR_LOG_DEBUG(d_logger,boost::format("Closing file %s") % d_filename);
+
+        // the file is closed even if the remaining data can not be written
+        std::string error;
+        try {
+          // write all aligned data directly
+          size_t naligned = d_buffer_used - (d_buffer_used % d_alignment);
+          if (naligned) {
+            write_fd(d_buffer, naligned);
+          }
+
+          // the unaligned tail can not be written with O_DIRECT, so disable it
+          // for the final write.  if that is not possible, write a padded block
+          // and truncate the file back to its true length
+          size_t ntail = d_buffer_used - naligned;
+          if (ntail) {
+            int flags = fcntl(d_fd, F_GETFL);
+            if ((not d_direct) or ((flags >= 0) and (fcntl(d_fd, F_SETFL, flags & ~O_DIRECT) == 0))) {
+              write_fd(d_buffer + naligned, ntail);
+            } else {
+              off_t length = lseek(d_fd, 0, SEEK_CUR) + (off_t)ntail;
+              memmove(d_buffer, d_buffer + naligned, ntail);
+              memset(d_buffer + ntail, 0, d_alignment - ntail);
+              write_fd(d_buffer, d_alignment);
+              if (ftruncate(d_fd, length) != 0) {
+                GR_LOG_ERROR(d_logger,boost::format("Unable to truncate file %s") % d_filename);
+              }
+            }
+          }
+        }
+        catch (std::exception &e) {
+          error = e.what();
+        }
+
+        ::close(d_fd);
+        d_fd = -1;
+        d_buffer_used = 0;
+
+        if (not error.empty()) {
+          throw std::runtime_error(error);
+        }
+      }
+    }
+
+    int file_writer_raw_direct::write_impl( const void *in, int nitems )
+    {
+      const char *p = (const char *)in;
+      size_t nbytes = nitems * d_itemsize;
+
+      while (nbytes) {
+        size_t ncopy = std::min(nbytes, d_buffer_size - d_buffer_used);
+        memcpy(d_buffer + d_buffer_used, p, ncopy);
+        d_buffer_used += ncopy;
+        p += ncopy;
+        nbytes -= ncopy;
+
+        if (d_buffer_used == d_buffer_size) {
+          flush_buffer();
+        }
+      }
+
+      return nitems;
+    }
+
+    void file_writer_raw_direct::flush_buffer()
+    {
+      // the buffer is reused even if the write fails
+      size_t nbytes = d_buffer_used;
+      d_buffer_used = 0;
+      write_fd(d_buffer, nbytes);
+    }
+
+    void file_writer_raw_direct::write_fd( const char *buf, size_t nbytes )
+    {
+      while (nbytes) {
+        ssize_t n = ::write(d_fd, buf, nbytes);
+        if (n < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          throw std::runtime_error(str(boost::format("file_sink: unable to write to file %s: %s") %
+              d_filename % strerror(errno)));
+        }
+        buf += n;
+        nbytes -= n;
+      }
+    }
+
+  } /* namespace sandia_utils */
+} /* namespace gr */
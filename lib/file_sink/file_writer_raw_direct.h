@@ -0,0 +1,82 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_FILE_WRITER_RAW_DIRECT_H
+#define INCLUDED_SANDIA_UTILS_FILE_WRITER_RAW_DIRECT_H
+
+#include <sandia_utils/api.h>
+#include "file_writer_base.h"
+
+namespace gr {
+  namespace sandia_utils {
+    /*!
+     * Raw file writer using direct I/O
+     *
+     * Data is written with O_DIRECT through a page-aligned staging buffer so
+     * that long captures bypass the page cache.  Only whole multiples of the
+     * alignment are written directly; the unaligned tail is written through
+     * the page cache when the file is closed.  Write errors are raised as
+     * exceptions.
+     */
+    class SANDIA_UTILS_API file_writer_raw_direct: public file_writer_base
+    {
+    private:
+      int                   d_fd;
+      bool                  d_direct;
+
+      // next file created in advance
+      int                   d_next_fd;
+      bool                  d_next_direct;
+
+      // page-aligned staging buffer
+      char                  *d_buffer;
+      size_t                d_buffer_size;
+      size_t                d_buffer_used;
+      size_t                d_alignment;
+
+      int open_fd(const std::string &fname, int flags, bool &direct);
+      void write_fd(const char *buf, size_t nbytes);
+      void flush_buffer();
+
+    public:
+      file_writer_raw_direct(std::string data_type, std::string file_type,
+                    size_t itemsize, uint64_t nsamples, int rate,
+                    std::string out_dir, std::string name_spec, gr::logger_ptr logger);
+      ~file_writer_raw_direct();
+
+      /*!
+       * Open a new file
+       */
+      void open(std::string fname);
+
+      /*!
+       * Close the current file
+       */
+      void close();
+
+      /*!
+       * Create and open the next file in advance
+       */
+      bool prepare(std::string fname);
+
+      /*!
+       * Close the next file if it will not be used
+       */
+      void discard_prepared();
+
+      /*!
+       * Write data
+       */
+      int write_impl(const void *in, int nitems);
+    };
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_FILE_WRITER_RAW_DIRECT_H */
@@ -15,6 +15,7 @@
 
 #include <iostream>
 #include <stdio.h>
+#include <string.h>
 
 namespace gr
 {
@@ -24,28 +25,43 @@ namespace gr
         uint64_t nsamples, int rate, std::string out_dir, std::string name_spec, gr::logger_ptr logger ) :
             file_writer_base( data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, logger )
     {
-      /* NOOP */
+      d_version = (file_type == "raw_header_v2") ? RAW_HEADER_FORMAT_VERSION : 1;
+      d_data_size = 0;
     }
 
     file_writer_raw_header::~file_writer_raw_header()
     {
-      // ensure file descriptor is closed
+      // ensure queued data is written and file descriptor is closed
+      shutdown();
       close();
     }
 
     void file_writer_raw_header::open( std::string fname )
     {
       GR_LOG_DEBUG(d_logger,boost::format("Opening file %s") % fname.c_str());
-      d_outfile.open( fname.c_str(), std::ofstream::binary );
+      if( take_prepared( fname ) )
+      {
+        // file was created in advance
+        d_outfile.swap( d_next_outfile );
+      }
+      else
+      {
+        d_outfile.open( fname.c_str(), std::ofstream::binary );
+      }
 
       // write header
       // format is: (frequency, rate, sample_time)
-      double freq = (double)d_freq;
-      double rate = (double)d_rate;
-      double start_time = d_samp_time.dtime();
-      d_outfile.write( (const char*)&freq, sizeof(double) );
-      d_outfile.write( (const char*)&rate, sizeof(double) );
-      d_outfile.write( (const char*)&start_time, sizeof(double) );
+      raw_header_segment_t segment;
+      segment.sample = 0;
+      segment.metadata[0] = (double)d_freq;
+      segment.metadata[1] = (double)d_rate;
+      segment.metadata[2] = d_samp_time.dtime();
+      write_header( segment.metadata );
+
+      // the first segment is described by the header
+      d_segments.clear();
+      d_segments.push_back( segment );
+      d_data_size = 0;
     }
 
     void file_writer_raw_header::close()
@@ -53,14 +69,82 @@ namespace gr
       if( d_outfile.is_open() )
       {
         GR_LOG_DEBUG(d_logger,boost::format("Closing file %s") % d_filename);
+        if( d_version >= 2 )
+        {
+          write_index();
+        }
         d_outfile.flush();
         d_outfile.close();
       }
     }
 
+    void file_writer_raw_header::write_header( const double *metadata )
+    {
+      d_outfile.write( (const char*)metadata, 3 * sizeof(double) );
+    }
+
+    void file_writer_raw_header::write_index()
+    {
+      raw_header_trailer_t trailer;
+      memset( &trailer, 0, sizeof(trailer) );
+      trailer.data_size = d_data_size;
+      trailer.nsegments = d_segments.size();
+      trailer.version = RAW_HEADER_FORMAT_VERSION;
+      memcpy( trailer.magic, RAW_HEADER_TRAILER_MAGIC, sizeof(trailer.magic) );
+
+      d_outfile.write( (const char*)&d_segments[0], d_segments.size() * sizeof(raw_header_segment_t) );
+      d_outfile.write( (const char*)&trailer, sizeof(trailer) );
+
+      // a change on the first sample replaced the first segment
+      d_outfile.seekp( 0 );
+      write_header( d_segments[0].metadata );
+    }
+
+    void file_writer_raw_header::capture_impl( uint64_t sample, const epoch_time &time, uint64_t freq, int rate )
+    {
+      // a later change at the same sample replaces the earlier one
+      if( d_segments.empty() or (d_segments.back().sample != sample) )
+      {
+        d_segments.push_back( raw_header_segment_t() );
+      }
+
+      raw_header_segment_t &segment = d_segments.back();
+      segment.sample = sample;
+      segment.metadata[0] = (double)freq;
+      segment.metadata[1] = (double)rate;
+      segment.metadata[2] = time.dtime();
+    }
+
+    bool file_writer_raw_header::prepare( std::string fname )
+    {
+      // never replace an existing file before it is due
+      if( not create_exclusive( fname ) )
+      {
+        return false;
+      }
+
+      d_next_outfile.open( fname.c_str(), std::ofstream::binary );
+      if( not d_next_outfile.is_open() )
+      {
+        ::remove( fname.c_str() );
+        return false;
+      }
+
+      return true;
+    }
+
+    void file_writer_raw_header::discard_prepared()
+    {
+      if( d_next_outfile.is_open() )
+      {
+        d_next_outfile.close();
+      }
+    }
+
     int file_writer_raw_header::write_impl( const void *in, int nitems )
     {
       d_outfile.write( (const char*)in, nitems * d_itemsize );
+      d_data_size += nitems * d_itemsize;
       return nitems;
     }
 
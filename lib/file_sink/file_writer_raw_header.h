@@ -11,15 +11,40 @@
 #define INCLUDED_SANDIA_UTILS_FILE_WRITER_RAW_HEADER_H
 
 #include <fstream>
+#include <vector>
 #include <sandia_utils/api.h>
 #include "file_writer_base.h"
+#include "../raw_header_format.h"
 
 namespace gr {
   namespace sandia_utils {
+    /*!
+     * Raw IQ + Header recording
+     *
+     * The "raw_header" file type writes version 1 files.  The
+     * "raw_header_v2" file type writes version 2 files, which record changes
+     * of frequency, rate and time as segments of the same file.  See
+     * raw_header_format.h for the file layout.
+     */
     class SANDIA_UTILS_API file_writer_raw_header: public file_writer_base
     {
     private:
       std::ofstream         d_outfile;
+      std::ofstream         d_next_outfile;
+
+      // format version and, for version 2, the segments of the current file
+      int                   d_version;
+      std::vector<raw_header_segment_t> d_segments;
+      uint64_t              d_data_size;
+
+      void write_header(const double *metadata);
+      void write_index();
+
+    protected:
+      /*!
+       * Record a new segment
+       */
+      void capture_impl(uint64_t sample, const epoch_time &time, uint64_t freq, int rate);
 
     public:
       file_writer_raw_header(std::string data_type, std::string file_type,
@@ -37,6 +62,28 @@ namespace gr {
        */
       void close();
 
+      /*!
+       * Create and open the next file in advance
+       */
+      bool prepare(std::string fname);
+
+      /*!
+       * Close the next file if it will not be used
+       */
+      void discard_prepared();
+
+      /*!
+       * Header holds frequency, rate and start time.  The index of a version
+       * 2 file follows the samples, so its size is not known in advance
+       */
+      int64_t header_size() { return (d_version < 2) ? 3 * sizeof(double) : -1; }
+
+      /*!
+       * Version 2 files record changes of frequency, rate and time
+       */
+      bool supports_captures() { return d_version >= 2; }
+      bool captures_rate() { return d_version >= 2; }
+
       /*!
        * Write data
        */
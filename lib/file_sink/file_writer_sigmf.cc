@@ -0,0 +1,214 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "file_writer_sigmf.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <stdio.h>
+#include <time.h>
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    namespace {
+      const std::string DATA_EXT = ".sigmf-data";
+      const std::string META_EXT = ".sigmf-meta";
+
+      // ISO 8601 UTC time with nanosecond resolution
+      std::string format_datetime( const epoch_time &time )
+      {
+        uint64_t sec = time.epoch_sec();
+        uint64_t nsec = (uint64_t)(time.epoch_frac() * 1e9 + 0.5);
+        if( nsec >= 1000000000 )
+        {
+          sec += 1;
+          nsec -= 1000000000;
+        }
+
+        time_t t = (time_t)sec;
+        struct tm tm;
+        gmtime_r( &t, &tm );
+
+        char buf[64];
+        size_t len = strftime( buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm );
+        snprintf( buf + len, sizeof(buf) - len, ".%09luZ", (unsigned long)nsec );
+        return std::string( buf );
+      }
+    } // namespace
+
+    file_writer_sigmf::file_writer_sigmf( std::string data_type, std::string file_type, size_t itemsize,
+        uint64_t nsamples, int rate, std::string out_dir, std::string name_spec, gr::logger_ptr logger ) :
+            file_writer_raw( data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, logger ),
+            d_last_capture_sample( 0 ),
+            d_last_capture_pos( 0 )
+    {
+      // reject data types that can not be described
+      size_t nchannels;
+      datatype( data_type, itemsize, nchannels );
+
+      // the metadata file name is derived from the data file name
+      if( (name_spec.size() < DATA_EXT.size()) or
+          (name_spec.compare( name_spec.size() - DATA_EXT.size(), DATA_EXT.size(), DATA_EXT ) != 0) )
+      {
+        throw std::runtime_error( "file_sink: sigmf file names must end with " + DATA_EXT );
+      }
+    }
+
+    file_writer_sigmf::~file_writer_sigmf()
+    {
+      // ensure queued data is written and metadata is complete
+      shutdown();
+      close();
+    }
+
+    std::string file_writer_sigmf::datatype( const std::string &data_type, size_t itemsize,
+        size_t &nchannels )
+    {
+      std::string type;
+      size_t size;
+      if( data_type == "complex" )
+      {
+        type = "cf32_le";
+        size = 8;
+      }
+      else if( data_type == "complex_int" )
+      {
+        type = "ci16_le";
+        size = 4;
+      }
+      else if( data_type == "float" )
+      {
+        type = "rf32_le";
+        size = 4;
+      }
+      else if( data_type == "int" )
+      {
+        type = "ri32_le";
+        size = 4;
+      }
+      else if( data_type == "short" )
+      {
+        type = "ri16_le";
+        size = 2;
+      }
+      else if( data_type == "byte" )
+      {
+        type = "ri8";
+        size = 1;
+      }
+      else
+      {
+        throw std::runtime_error( "file_sink: data type not supported by sigmf file type" );
+      }
+
+      // vectors are recorded as interleaved channels
+      nchannels = std::max( itemsize / size, (size_t)1 );
+      return type;
+    }
+
+    void file_writer_sigmf::open( std::string fname )
+    {
+      file_writer_raw::open( fname );
+
+      // metadata file is named after the data file
+      d_meta_filename = fname.substr( 0, fname.size() - DATA_EXT.size() ) + META_EXT;
+
+      // every file begins with a capture
+      d_captures.clear();
+      d_annotations.clear();
+      append_capture( 0, d_samp_time, d_freq );
+    }
+
+    void file_writer_sigmf::close()
+    {
+      if( not d_meta_filename.empty() )
+      {
+        write_meta();
+        d_meta_filename.clear();
+      }
+
+      file_writer_raw::close();
+    }
+
+    void file_writer_sigmf::capture_impl( uint64_t sample, const epoch_time &time, uint64_t freq, int )
+    {
+      // the sample rate is global, a new rate always starts a new file
+      append_capture( sample, time, freq );
+    }
+
+    void file_writer_sigmf::annotation_impl( uint64_t sample, uint64_t count )
+    {
+      d_annotations.push_back( std::make_pair( sample, count ) );
+    }
+
+    void file_writer_sigmf::append_capture( uint64_t sample, const epoch_time &time, uint64_t freq )
+    {
+      // capture start samples must be unique, a later capture at the same
+      // sample replaces the earlier one
+      if( d_captures.size() and (sample == d_last_capture_sample) )
+      {
+        d_captures.resize( d_last_capture_pos );
+      }
+
+      d_last_capture_sample = sample;
+      d_last_capture_pos = d_captures.size();
+      if( d_captures.size() )
+      {
+        d_captures += ",";
+      }
+      d_captures += str( boost::format( "\n    {\"core:sample_start\": %lu, \"core:frequency\": %lu, "
+                                        "\"core:datetime\": \"%s\"}" )
+          % sample % freq % format_datetime( time ) );
+    }
+
+    void file_writer_sigmf::write_meta()
+    {
+      size_t nchannels;
+      std::string type = datatype( d_data_type, d_itemsize, nchannels );
+
+      std::ofstream meta( d_meta_filename.c_str(), std::ofstream::trunc );
+      if( not meta.is_open() )
+      {
+        GR_LOG_ERROR(d_logger,boost::format("Unable to write metadata file %s") % d_meta_filename);
+        return;
+      }
+
+      meta << "{\n  \"global\": {\n"
+           << "    \"core:datatype\": \"" << type << "\",\n"
+           << "    \"core:sample_rate\": " << d_rate << ",\n";
+      if( nchannels > 1 )
+      {
+        meta << "    \"core:num_channels\": " << nchannels << ",\n";
+      }
+      meta << "    \"core:version\": \"1.0.0\",\n"
+           << "    \"core:recorder\": \"gr-sandia_utils\"\n"
+           << "  },\n"
+           << "  \"captures\": [" << d_captures << "\n  ],\n"
+           << "  \"annotations\": [";
+
+      // annotations must be ordered by their first sample
+      std::stable_sort( d_annotations.begin(), d_annotations.end() );
+      for( size_t i = 0; i < d_annotations.size(); i++ )
+      {
+        meta << (i ? "," : "")
+             << boost::format( "\n    {\"core:sample_start\": %lu, \"core:sample_count\": %lu}" )
+                % d_annotations[i].first % d_annotations[i].second;
+      }
+      meta << (d_annotations.size() ? "\n  " : "") << "]\n}\n";
+    }
+
+  } /* namespace sandia_utils */
+} /* namespace gr */
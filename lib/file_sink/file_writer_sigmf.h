@@ -0,0 +1,93 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_FILE_WRITER_SIGMF_H
+#define INCLUDED_SANDIA_UTILS_FILE_WRITER_SIGMF_H
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <sandia_utils/api.h>
+#include "file_writer_raw.h"
+
+namespace gr {
+  namespace sandia_utils {
+    /*!
+     * SigMF recording
+     *
+     * Samples are written to the data file exactly as by the raw writer.
+     * The name specifier must give data files the .sigmf-data extension.
+     * The metadata file has the same name with the .sigmf-meta extension
+     * and is written once when the data file is closed.  Captures are kept
+     * as JSON text that grows as they are recorded, annotations are sorted
+     * by their first sample when the metadata is written.
+     */
+    class SANDIA_UTILS_API file_writer_sigmf: public file_writer_raw
+    {
+    private:
+      // name of the metadata file for the current data file
+      std::string           d_meta_filename;
+
+      // captures formatted as JSON array elements
+      std::string           d_captures;
+
+      // annotations as first sample and number of samples
+      std::vector<std::pair<uint64_t, uint64_t> > d_annotations;
+
+      // start of the last capture in the file and in d_captures, so a
+      // capture starting at the same sample can replace it
+      uint64_t              d_last_capture_sample;
+      size_t                d_last_capture_pos;
+
+      void append_capture(uint64_t sample, const epoch_time &time, uint64_t freq);
+      void write_meta();
+
+    protected:
+      /*!
+       * Record a capture
+       */
+      void capture_impl(uint64_t sample, const epoch_time &time, uint64_t freq, int rate);
+
+      /*!
+       * Record an annotation
+       */
+      void annotation_impl(uint64_t sample, uint64_t count);
+
+    public:
+      file_writer_sigmf(std::string data_type, std::string file_type,
+                    size_t itemsize, uint64_t nsamples, int rate,
+                    std::string out_dir, std::string name_spec, gr::logger_ptr logger);
+      ~file_writer_sigmf();
+
+      /*!
+       * Open a new file
+       */
+      void open(std::string fname);
+
+      /*!
+       * Write metadata and close the current file
+       */
+      void close();
+
+      /*!
+       * Captures and annotations are recorded
+       */
+      bool supports_captures() { return true; }
+
+      /*!
+       * SigMF data type for a sink data type, such as "cf32_le" for "complex"
+       */
+      static std::string datatype(const std::string &data_type, size_t itemsize,
+                                  size_t &nchannels);
+    };
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_FILE_WRITER_SIGMF_H */
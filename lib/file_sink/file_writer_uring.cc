@@ -0,0 +1,461 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "file_writer_uring.h"
+
+#include <boost/format.hpp>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// direct I/O is not available on all platforms
+#ifndef O_DIRECT
+#define O_DIRECT 0
+#endif
+
+// number of writes kept in flight
+#define URING_QUEUE_DEPTH 8
+
+// size of each registered buffer
+#define URING_BUFFER_SIZE (1024 * 1024)
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    file_writer_uring::file_writer_uring( std::string data_type, std::string file_type, size_t itemsize,
+        uint64_t nsamples, int rate, std::string out_dir, std::string name_spec, gr::logger_ptr logger ) :
+        file_writer_base( data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, logger )
+    {
+      d_fill = -1;
+      d_next_fd = -1;
+      d_next_direct = false;
+      d_current = -1;
+      d_closed = -1;
+      for (int i = 0; i < 2; i++) {
+        d_files[i].fd = -1;
+        d_files[i].inflight = 0;
+        d_files[i].offset = 0;
+        d_files[i].length = 0;
+        d_files[i].direct = false;
+        d_files[i].closing = false;
+      }
+
+      int ret = io_uring_queue_init(URING_QUEUE_DEPTH, &d_ring, 0);
+      if (ret < 0) {
+        throw std::runtime_error(str(boost::format("file_sink: unable to setup io_uring: %s") % strerror(-ret)));
+      }
+
+      // one buffer per queue entry plus one being filled
+      long page_size = sysconf(_SC_PAGESIZE);
+      d_alignment = (page_size > 0) ? (size_t)page_size : 4096;
+      d_buffer_size = URING_BUFFER_SIZE - (URING_BUFFER_SIZE % d_alignment);
+      d_buffers.resize(URING_QUEUE_DEPTH + 1);
+      for (size_t i = 0; i < d_buffers.size(); i++) {
+        d_buffers[i].ptr = NULL;
+        d_buffers[i].used = 0;
+        d_buffers[i].busy = false;
+        d_buffers[i].offset = 0;
+        d_buffers[i].start = 0;
+        d_buffers[i].submitted = 0;
+        d_buffers[i].file = 0;
+      }
+
+      try {
+        std::vector<struct iovec> iov(d_buffers.size());
+        for (size_t i = 0; i < d_buffers.size(); i++) {
+          if (posix_memalign((void **)&d_buffers[i].ptr, d_alignment, d_buffer_size) != 0) {
+            d_buffers[i].ptr = NULL;
+            throw std::runtime_error("file_sink: unable to allocate aligned buffer");
+          }
+          iov[i].iov_base = d_buffers[i].ptr;
+          iov[i].iov_len = d_buffer_size;
+        }
+
+        // register buffers and (empty) file slots
+        ret = io_uring_register_buffers(&d_ring, &iov[0], iov.size());
+        if (ret < 0) {
+          throw std::runtime_error(str(boost::format("file_sink: unable to register io_uring buffers: %s") % strerror(-ret)));
+        }
+        int fds[2] = { -1, -1 };
+        ret = io_uring_register_files(&d_ring, fds, 2);
+        if (ret < 0) {
+          throw std::runtime_error(str(boost::format("file_sink: unable to register io_uring files: %s") % strerror(-ret)));
+        }
+      }
+      catch (...) {
+        release();
+        throw;
+      }
+    }
+
+    file_writer_uring::~file_writer_uring()
+    {
+      // ensure queued data is written and file descriptor is closed
+      shutdown();
+      try {
+        close();
+      }
+      catch (std::exception &e) {
+        GR_LOG_ERROR(d_logger, e.what());
+      }
+      try {
+        wait_closed();
+      }
+      catch (std::exception &e) {
+        GR_LOG_ERROR(d_logger, e.what());
+      }
+
+      release();
+    }
+
+    void file_writer_uring::release()
+    {
+      io_uring_queue_exit(&d_ring);
+      for (size_t i = 0; i < d_buffers.size(); i++) {
+        free(d_buffers[i].ptr);
+      }
+    }
+
+    void file_writer_uring::open( std::string fname )
+    {
+      GR_LOG_DEBUG(d_logger,boost::format("Opening file %s") % fname.c_str());
+
+      // the closed file may still hold the other slot
+      int slot = (d_closed == 0) ? 1 : 0;
+      while (d_files[slot].closing) {
+        reap(true);
+      }
+
+      uring_file_t &f = d_files[slot];
+      if (take_prepared(fname)) {
+        // file was created in advance
+        f.fd = d_next_fd;
+        f.direct = d_next_direct;
+        d_next_fd = -1;
+      } else {
+        f.fd = open_fd(fname, O_TRUNC, f.direct);
+      }
+      if (f.fd < 0) {
+        perror(fname.c_str());
+        throw std::runtime_error("file_sink: can't open file");
+      }
+
+      int ret = io_uring_register_files_update(&d_ring, slot, &f.fd, 1);
+      if (ret < 0) {
+        ::close(f.fd);
+        f.fd = -1;
+        throw std::runtime_error(str(boost::format("file_sink: unable to update io_uring files: %s") % strerror(-ret)));
+      }
+
+      f.inflight = 0;
+      f.offset = 0;
+      f.length = 0;
+      f.closing = false;
+      d_current = slot;
+    }
+
+    int file_writer_uring::open_fd( const std::string &fname, int flags, bool &direct )
+    {
+      // not all file systems support direct I/O so fall back to regular writes
+      direct = (O_DIRECT != 0);
+      int fd = ::open( fname.c_str(), O_WRONLY | O_CREAT | flags | O_DIRECT, 0644 );
+      if ((fd < 0) and (errno == EINVAL)) {
+        direct = false;
+        fd = ::open( fname.c_str(), O_WRONLY | O_CREAT | flags, 0644 );
+      }
+
+      return fd;
+    }
+
+    bool file_writer_uring::prepare( std::string fname )
+    {
+      // never replace an existing file before it is due
+      d_next_fd = open_fd(fname, O_EXCL, d_next_direct);
+      return (d_next_fd >= 0);
+    }
+
+    void file_writer_uring::discard_prepared()
+    {
+      if (d_next_fd >= 0) {
+        ::close(d_next_fd);
+        d_next_fd = -1;
+      }
+    }
+
+    void file_writer_uring::close()
+    {
+      if (d_current < 0) {
+        return;
+      }
+      uring_file_t &f = d_files[d_current];
+
+      GR_LOG_DEBUG(d_logger,boost::format("Closing file %s") % d_filename);
+
+      // queue final (padded) block
+      if (d_fill >= 0) {
+        uring_buffer_t &b = d_buffers[d_fill];
+        size_t nbytes = b.used;
+        if (f.direct and (nbytes % d_alignment)) {
+          size_t npad = d_alignment - (nbytes % d_alignment);
+          memset(b.ptr + nbytes, 0, npad);
+          nbytes += npad;
+        }
+        f.length += b.used;
+        b.offset = f.offset;
+        b.file = d_current;
+        f.offset += nbytes;
+        f.inflight++;
+        submit(d_fill, nbytes);
+        d_fill = -1;
+      }
+
+      // the file is finished on its last completion, while the next file is
+      // written in the other slot
+      f.closing = true;
+      d_closed = d_current;
+      d_current = -1;
+      if (f.inflight) {
+        reap(false);
+      } else {
+        finish_close(d_closed);
+      }
+
+      if (not d_error.empty()) {
+        std::string error = d_error;
+        d_error.clear();
+        throw std::runtime_error(error);
+      }
+    }
+
+    int file_writer_uring::write_impl( const void *in, int nitems )
+    {
+      if (not d_error.empty()) {
+        std::string error = d_error;
+        d_error.clear();
+        throw std::runtime_error(error);
+      }
+
+      const char *p = (const char *)in;
+      size_t nbytes = nitems * d_itemsize;
+
+      while (nbytes) {
+        if (d_fill < 0) {
+          d_fill = get_buffer();
+        }
+
+        uring_buffer_t &b = d_buffers[d_fill];
+        size_t ncopy = std::min(nbytes, d_buffer_size - b.used);
+        memcpy(b.ptr + b.used, p, ncopy);
+        b.used += ncopy;
+        p += ncopy;
+        nbytes -= ncopy;
+
+        if (b.used == d_buffer_size) {
+          queue_write(d_fill);
+          d_fill = -1;
+        }
+      }
+
+      return nitems;
+    }
+
+    int file_writer_uring::get_buffer()
+    {
+      while (true) {
+        for (size_t i = 0; i < d_buffers.size(); i++) {
+          if (not d_buffers[i].busy and ((int)i != d_fill)) {
+            d_buffers[i].used = 0;
+            return i;
+          }
+        }
+
+        // all buffers in flight
+        reap(true);
+      }
+    }
+
+    void file_writer_uring::queue_write(int idx)
+    {
+      uring_buffer_t &b = d_buffers[idx];
+      uring_file_t &f = d_files[d_current];
+      b.offset = f.offset;
+      b.file = d_current;
+      f.offset += b.used;
+      f.length += b.used;
+      f.inflight++;
+      submit(idx, b.used);
+
+      // opportunistically collect completions
+      reap(false);
+    }
+
+    void file_writer_uring::submit(int idx, size_t nbytes)
+    {
+      uring_buffer_t &b = d_buffers[idx];
+      b.busy = true;
+      b.start = 0;
+      b.submitted = nbytes;
+      resubmit(idx);
+    }
+
+    void file_writer_uring::resubmit(int idx)
+    {
+      uring_buffer_t &b = d_buffers[idx];
+
+      // entries are submitted as they are queued, so a full submission queue
+      // only needs to be handed to the kernel.  completions are never waited
+      // for here since this is called while handling them
+      struct io_uring_sqe *sqe = io_uring_get_sqe(&d_ring);
+      while (sqe == NULL) {
+        io_uring_submit(&d_ring);
+        sqe = io_uring_get_sqe(&d_ring);
+      }
+
+      io_uring_prep_write_fixed(sqe, b.file, b.ptr + b.start, b.submitted - b.start,
+                                b.offset + b.start, idx);
+      io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+      io_uring_sqe_set_data(sqe, (void *)(uintptr_t)idx);
+
+      int ret = io_uring_submit(&d_ring);
+      if (ret < 0) {
+        fail(idx, str(boost::format("io_uring submit failed: %s") % strerror(-ret)));
+      }
+    }
+
+    void file_writer_uring::reap(bool wait)
+    {
+      struct io_uring_cqe *cqe;
+      while (true) {
+        int ret = wait ? io_uring_wait_cqe(&d_ring, &cqe) : io_uring_peek_cqe(&d_ring, &cqe);
+        if (ret == -EINTR) {
+          continue;
+        }
+        if (ret < 0) {
+          break;
+        }
+
+        int idx = (int)(uintptr_t)io_uring_cqe_get_data(cqe);
+        int res = cqe->res;
+        io_uring_cqe_seen(&d_ring, cqe);
+        complete(idx, res);
+
+        // only block for the first completion
+        wait = false;
+      }
+    }
+
+    void file_writer_uring::complete(int idx, int res)
+    {
+      uring_buffer_t &b = d_buffers[idx];
+
+      if (res <= 0) {
+        fail(idx, str(boost::format("io_uring write failed: %s") %
+            strerror(res < 0 ? -res : EIO)));
+        return;
+      }
+
+      b.start += res;
+      if (b.start < b.submitted) {
+        // short write - submit the remainder.  direct I/O requires aligned
+        // offsets, so a partial block is written again from its start
+        if (d_files[b.file].direct) {
+          b.start -= b.start % d_alignment;
+        }
+        resubmit(idx);
+        return;
+      }
+
+      release_buffer(idx);
+    }
+
+    void file_writer_uring::fail(int idx, const std::string &error)
+    {
+      GR_LOG_ERROR(d_logger, error);
+      if (d_error.empty()) {
+        d_error = str(boost::format("file_sink: %s") % error);
+      }
+      release_buffer(idx);
+    }
+
+    void file_writer_uring::release_buffer(int idx)
+    {
+      uring_buffer_t &b = d_buffers[idx];
+      uring_file_t &f = d_files[b.file];
+      b.busy = false;
+      b.used = 0;
+      f.inflight--;
+
+      // last write of a closed file
+      if (f.closing and (f.inflight == 0)) {
+        finish_close(b.file);
+      }
+    }
+
+    void file_writer_uring::finish_close(int slot)
+    {
+      uring_file_t &f = d_files[slot];
+
+      // remove padding written to satisfy alignment
+      if (f.offset != f.length) {
+        if (ftruncate(f.fd, f.length) != 0) {
+          GR_LOG_ERROR(d_logger,boost::format("Unable to truncate file: %s") % strerror(errno));
+        }
+      }
+
+      int fd = -1;
+      io_uring_register_files_update(&d_ring, slot, &fd, 1);
+      ::close(f.fd);
+      f.fd = -1;
+      f.closing = false;
+
+      // the file is complete
+      boost::function<void()> done;
+      done.swap(f.done);
+      if (done) {
+        done();
+      }
+    }
+
+    void file_writer_uring::file_closed(boost::function<void()> done)
+    {
+      // issued now if the file was already finished
+      if ((d_closed >= 0) and d_files[d_closed].closing) {
+        d_files[d_closed].done = done;
+      } else if (done) {
+        done();
+      }
+    }
+
+    void file_writer_uring::wait_closed()
+    {
+      for (int i = 0; i < 2; i++) {
+        while (d_files[i].closing) {
+          reap(true);
+        }
+      }
+
+      if (not d_error.empty()) {
+        std::string error = d_error;
+        d_error.clear();
+        throw std::runtime_error(error);
+      }
+    }
+
+  } /* namespace sandia_utils */
+} /* namespace gr */
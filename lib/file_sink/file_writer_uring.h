@@ -0,0 +1,128 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_FILE_WRITER_URING_H
+#define INCLUDED_SANDIA_UTILS_FILE_WRITER_URING_H
+
+#include <sandia_utils/api.h>
+#include "file_writer_base.h"
+#include <liburing.h>
+#include <sys/types.h>
+#include <vector>
+
+namespace gr {
+  namespace sandia_utils {
+    /*!
+     * Raw file writer using io_uring
+     *
+     * Samples are staged in page-aligned buffers that are registered with
+     * the ring, and up to URING_QUEUE_DEPTH writes are kept in flight using
+     * two fixed file slots.  Closing a file only queues its last write, so
+     * the next file is written in the other slot while the closed file's
+     * writes complete.  The closed file is finished and its completion
+     * callback issued on its last completion.
+     *
+     * Files are opened with O_DIRECT when supported.  The final block of a
+     * file is zero padded to the alignment and the file truncated to its
+     * true length after the last write completes.  Write errors are raised
+     * as exceptions by the following write, close or stop.
+     */
+    class SANDIA_UTILS_API file_writer_uring: public file_writer_base
+    {
+    private:
+      struct uring_file_t
+      {
+        int fd;
+        int inflight;
+        off_t offset;          // offset of next write
+        off_t length;          // true length of file (excluding padding)
+        bool direct;
+        bool closing;          // closed with writes still in flight
+        boost::function<void()> done;  // completion callback once finished
+      };
+
+      struct uring_buffer_t
+      {
+        char *ptr;
+        size_t used;
+        bool busy;             // submitted and not yet completed
+        off_t offset;
+        size_t start;          // bytes of the request already written
+        size_t submitted;      // bytes in current request
+        int file;              // file slot written to
+      };
+
+      struct io_uring d_ring;
+      std::vector<uring_buffer_t> d_buffers;
+      uring_file_t d_files[2];
+      int d_current;           // slot of file being written, -1 if none
+      int d_closed;            // slot of file most recently closed
+      int d_fill;              // buffer currently being filled, -1 if none
+      size_t d_buffer_size;
+      size_t d_alignment;
+
+      // first write error not yet raised
+      std::string d_error;
+
+      // next file created in advance
+      int d_next_fd;
+      bool d_next_direct;
+
+      int open_fd(const std::string &fname, int flags, bool &direct);
+      int get_buffer();
+      void submit(int idx, size_t nbytes);
+      void resubmit(int idx);
+      void queue_write(int idx);
+      void reap(bool wait);
+      void complete(int idx, int res);
+      void fail(int idx, const std::string &error);
+      void release_buffer(int idx);
+      void finish_close(int slot);
+      void release();
+
+    protected:
+      void file_closed(boost::function<void()> done);
+      void wait_closed();
+
+    public:
+      file_writer_uring(std::string data_type, std::string file_type,
+                    size_t itemsize, uint64_t nsamples, int rate,
+                    std::string out_dir, std::string name_spec, gr::logger_ptr logger);
+      ~file_writer_uring();
+
+      /*!
+       * Open a new file
+       */
+      void open(std::string fname);
+
+      /*!
+       * Close the current file
+       */
+      void close();
+
+      /*!
+       * Create and open the next file in advance
+       */
+      bool prepare(std::string fname);
+
+      /*!
+       * Close the next file if it will not be used
+       */
+      void discard_prepared();
+
+      /*!
+       * Write data
+       */
+      int write_impl(const void *in, int nitems);
+    };
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_FILE_WRITER_URING_H */
@@ -14,6 +14,7 @@
 #include "file_sink_impl.h"
 #include <gnuradio/io_signature.h>
 #include <boost/filesystem/path.hpp>
+#include <cstring>
 
 namespace fs = boost::filesystem;
 namespace gr {
@@ -27,10 +28,19 @@ file_sink::sptr file_sink::make(std::string type,
                                 int rate,
                                 std::string out_dir,
                                 std::string name_spec,
-                                bool debug)
+                                bool debug,
+                                int nchan)
 {
-    return gnuradio::get_initial_sptr(new file_sink_impl(
-        type, itemsize, file_type, mode, nsamples, rate, out_dir, name_spec, debug));
+    return gnuradio::get_initial_sptr(new file_sink_impl(type,
+                                                         itemsize,
+                                                         file_type,
+                                                         mode,
+                                                         nsamples,
+                                                         rate,
+                                                         out_dir,
+                                                         name_spec,
+                                                         debug,
+                                                         nchan));
 }
 
 /*
@@ -44,48 +54,66 @@ file_sink_impl::file_sink_impl(std::string data_type,
                                int rate,
                                std::string out_dir,
                                std::string name_spec,
-                               bool debug)
+                               bool debug,
+                               int nchan)
     : gr::sync_block("file_sink",
-                     gr::io_signature::make(data_type == "message" ? 0 : 1,
-                                            data_type == "message" ? 0 : 1,
+                     gr::io_signature::make(data_type == "message" ? 0 : nchan,
+                                            data_type == "message" ? 0 : nchan,
                                             data_type == "message" ? 0 : itemsize),
                      gr::io_signature::make(0, 0, 0)),
       d_type(data_type),
+      d_file_type(file_type),
       d_itemsize(itemsize),
       d_mode(mode),
       d_nsamples(nsamples),
       d_out_dir(out_dir),
       d_name_spec(name_spec),
+      d_nchan(nchan),
       d_debug(debug)
 {
     // set initial local values
     d_recording = false;
-    d_check_start = false;
-    d_issue_start = false;
-    d_ndiscard = 0;
-    d_burst_state = 0;
+    d_captures = false;
+    d_rate_captures = false;
+
+    // one I/O thread per channel by default
+    d_io_threads = 0;
 
     // align on second boundary by default
     d_align = true;
 
+    // no pre or post trigger samples by default
+    d_pretrigger = 0;
+    d_posttrigger = 0;
+
+    // one burst at a time by default
+    d_max_bursts = 1;
+
+    // background I/O disabled by default
+    d_async = false;
+    d_io_nbuffers = 0;
+    d_io_buffer_size = 0;
+    d_io_drop = false;
+
     if (d_type == "message") {
         // register message handlers
         message_port_register_in(IN_KEY);
         set_msg_handler(IN_KEY, boost::bind(&file_sink_impl::handle_msg, this, _1));
 
+        // the message_log file type adds an index and message times
+        bool indexed = (file_type == "message_log");
+        d_msg_log = boost::shared_ptr<message_log_writer>(
+            new message_log_writer(indexed, indexed, d_logger));
+
         // Note: file is opened in start()
     } else {
-        // initialize writer
-        d_file_writer = file_writer_base::make(
-            data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, d_logger);
-
-        // register update callback
-        d_file_writer->register_callback(
-            boost::bind(&file_sink_impl::send_update, this, _1, _2, _3, _4));
-
-        // compute sampling period - needed to determine how many samples to
-        // discard when starting recording
-        d_T = 1.0 / d_file_writer->get_rate();
+        if (d_nchan < 1) {
+            throw std::runtime_error("file_sink: at least one channel is required");
+        }
+        if ((d_nchan > 1) and (name_spec.find("%ch") == std::string::npos)) {
+            throw std::runtime_error(
+                "file_sink: name specifier must contain %ch for multiple channels");
+        }
 
         // set time to system time by default
         // initialize time of next incoming sample to be current system time
@@ -96,8 +124,34 @@ file_sink_impl::file_sink_impl(std::string data_type,
         // are discarded
         struct timeval tp;
         gettimeofday(&tp, NULL);
-        d_samp_time.set(
-            (uint64_t)tp.tv_sec, 0.0, 1.0 / (double)d_file_writer->get_rate());
+
+        d_channels.resize(d_nchan);
+        for (int c = 0; c < d_nchan; c++) {
+            channel_t& ch = d_channels[c];
+
+            // initialize writer
+            file_writer_base::sptr writer = file_writer_base::make(
+                data_type, file_type, itemsize, nsamples, rate, out_dir, name_spec, d_logger);
+            writer->set_channel(c);
+
+            // register update callback
+            writer->register_callback(
+                boost::bind(&file_sink_impl::send_update, this, c, _1, _2, _3, _4, _5));
+            ch.writers.push_back(writer);
+            ch.idle.push_back(writer);
+            ch.next_burst_id = 0;
+
+            ch.samp_time.set((uint64_t)tp.tv_sec, 0.0);
+            ch.samp_time.set_rate((double)writer->get_rate());
+
+            ch.check_start = false;
+            ch.issue_start = false;
+            ch.ndiscard = 0;
+            ch.pretrig_head = 0;
+            ch.pretrig_count = 0;
+        }
+        d_captures = d_channels[0].writers[0]->supports_captures();
+        d_rate_captures = d_captures and d_channels[0].writers[0]->captures_rate();
     }
 
     // setup output message portion
@@ -110,8 +164,15 @@ file_sink_impl::file_sink_impl(std::string data_type,
 file_sink_impl::~file_sink_impl()
 {
     if (d_type == "message") {
-        d_msg_file.flush();
-        d_msg_file.close();
+        d_msg_log->close();
+    } else {
+        // shut down background I/O before the shared threads
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                d_channels[c].writers[w]->set_async(false);
+            }
+        }
+        d_io_pool.reset();
     }
 }
 
@@ -216,17 +277,207 @@ void file_sink_impl::setup_rpc()
                                                   "Frequency",
                                                   RPC_PRIVLVL_MIN,
                                                   DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_get<file_sink, bool>(alias(),
+                                                   "async",
+                                                   &file_sink::get_async,
+                                                   pmt::mp(false),
+                                                   pmt::mp(true),
+                                                   pmt::mp(false),
+                                                   "Logical",
+                                                   "Background I/O?",
+                                                   RPC_PRIVLVL_MIN,
+                                                   DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_get<file_sink, bool>(alias(),
+                                                   "preopen",
+                                                   &file_sink::get_preopen,
+                                                   pmt::mp(false),
+                                                   pmt::mp(true),
+                                                   pmt::mp(false),
+                                                   "Logical",
+                                                   "Pre-open Next File?",
+                                                   RPC_PRIVLVL_MIN,
+                                                   DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_set<file_sink, bool>(alias(),
+                                                   "preopen",
+                                                   &file_sink::set_preopen,
+                                                   pmt::mp(false),
+                                                   pmt::mp(true),
+                                                   pmt::mp(false),
+                                                   "Logical",
+                                                   "Pre-open Next File?",
+                                                   RPC_PRIVLVL_MIN,
+                                                   DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_get<file_sink, bool>(alias(),
+                                                   "preallocate",
+                                                   &file_sink::get_preallocate,
+                                                   pmt::mp(false),
+                                                   pmt::mp(true),
+                                                   pmt::mp(false),
+                                                   "Logical",
+                                                   "Preallocate Files?",
+                                                   RPC_PRIVLVL_MIN,
+                                                   DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_set<file_sink, bool>(alias(),
+                                                   "preallocate",
+                                                   &file_sink::set_preallocate,
+                                                   pmt::mp(false),
+                                                   pmt::mp(true),
+                                                   pmt::mp(false),
+                                                   "Logical",
+                                                   "Preallocate Files?",
+                                                   RPC_PRIVLVL_MIN,
+                                                   DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_get<file_sink, bool>(alias(),
+                                                   "checksum",
+                                                   &file_sink::get_checksum,
+                                                   pmt::mp(false),
+                                                   pmt::mp(true),
+                                                   pmt::mp(false),
+                                                   "Logical",
+                                                   "Checksum Files?",
+                                                   RPC_PRIVLVL_MIN,
+                                                   DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_set<file_sink, bool>(alias(),
+                                                   "checksum",
+                                                   &file_sink::set_checksum,
+                                                   pmt::mp(false),
+                                                   pmt::mp(true),
+                                                   pmt::mp(false),
+                                                   "Logical",
+                                                   "Checksum Files?",
+                                                   RPC_PRIVLVL_MIN,
+                                                   DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_get<file_sink, uint64_t>(alias(),
+                                                       "nstalls",
+                                                       &file_sink::get_nstalls,
+                                                       pmt::mp(0),
+                                                       pmt::mp(1000000),
+                                                       pmt::mp(0),
+                                                       "Count",
+                                                       "I/O Stalls",
+                                                       RPC_PRIVLVL_MIN,
+                                                       DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_get<file_sink, uint64_t>(alias(),
+                                                       "ndropped",
+                                                       &file_sink::get_ndropped,
+                                                       pmt::mp(0),
+                                                       pmt::mp(1000000),
+                                                       pmt::mp(0),
+                                                       "Samples",
+                                                       "Dropped Samples",
+                                                       RPC_PRIVLVL_MIN,
+                                                       DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_get<file_sink, uint64_t>(alias(),
+                                                       "nerrors",
+                                                       &file_sink::get_nerrors,
+                                                       pmt::mp(0),
+                                                       pmt::mp(1000000),
+                                                       pmt::mp(0),
+                                                       "Count",
+                                                       "I/O Errors",
+                                                       RPC_PRIVLVL_MIN,
+                                                       DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_get<file_sink, int>(alias(),
+                                                  "max_bursts",
+                                                  &file_sink::get_max_bursts,
+                                                  pmt::mp(1),
+                                                  pmt::mp(1000),
+                                                  pmt::mp(1),
+                                                  "Count",
+                                                  "Max Concurrent Bursts",
+                                                  RPC_PRIVLVL_MIN,
+                                                  DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_set<file_sink, int>(alias(),
+                                                  "max_bursts",
+                                                  &file_sink::set_max_bursts,
+                                                  pmt::mp(1),
+                                                  pmt::mp(1000),
+                                                  pmt::mp(1),
+                                                  "Count",
+                                                  "Max Concurrent Bursts",
+                                                  RPC_PRIVLVL_MIN,
+                                                  DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_get<file_sink, int>(alias(),
+                                                  "pretrigger",
+                                                  &file_sink::get_pretrigger,
+                                                  pmt::mp(0),
+                                                  pmt::mp(100000000),
+                                                  pmt::mp(0),
+                                                  "Samples",
+                                                  "Pre-trigger Samples",
+                                                  RPC_PRIVLVL_MIN,
+                                                  DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_set<file_sink, int>(alias(),
+                                                  "pretrigger",
+                                                  &file_sink::set_pretrigger,
+                                                  pmt::mp(0),
+                                                  pmt::mp(100000000),
+                                                  pmt::mp(0),
+                                                  "Samples",
+                                                  "Pre-trigger Samples",
+                                                  RPC_PRIVLVL_MIN,
+                                                  DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_get<file_sink, int>(alias(),
+                                                  "posttrigger",
+                                                  &file_sink::get_posttrigger,
+                                                  pmt::mp(0),
+                                                  pmt::mp(100000000),
+                                                  pmt::mp(0),
+                                                  "Samples",
+                                                  "Post-trigger Samples",
+                                                  RPC_PRIVLVL_MIN,
+                                                  DISPTIME | DISPOPTSTRIP)));
+
+    d_rpc_vars.push_back(rpcbasic_sptr(
+        new rpcbasic_register_set<file_sink, int>(alias(),
+                                                  "posttrigger",
+                                                  &file_sink::set_posttrigger,
+                                                  pmt::mp(0),
+                                                  pmt::mp(100000000),
+                                                  pmt::mp(0),
+                                                  "Samples",
+                                                  "Post-trigger Samples",
+                                                  RPC_PRIVLVL_MIN,
+                                                  DISPTIME | DISPOPTSTRIP)));
 #endif /* GR_CTRLPORT */
 }
 
 void file_sink_impl::handle_msg(pmt::pmt_t msg)
 {
-    std::string str = pmt::serialize_str(msg);
-    uint32_t len = (uint32_t)str.length();
+    boost::recursive_mutex::scoped_lock lock(d_mutex);
 
-    // write to file
-    d_msg_file.write((char*)&len, sizeof(uint32_t));
-    d_msg_file.write(str.c_str(), str.length());
+    // messages are batched, not written individually
+    d_msg_log->write(msg);
 }
 
 int file_sink_impl::work(int noutput_items,
@@ -240,139 +491,475 @@ int file_sink_impl::work(int noutput_items,
         return 0;
     }
 
-    const void* in = (const void*)input_items[0];
+    // channels are independent, all items are consumed
+    uint64_t start = nitems_read(0);
+    for (int c = 0; c < d_nchan; c++) {
+        do_channel(d_channels[c], c, (const char*)input_items[c], start, noutput_items);
+    }
 
-    // number of items processed
-    int ntoconsume = noutput_items;
+    // Tell runtime system how many output items we produced.
+    return noutput_items;
+}
 
-    // get all tags
-    uint64_t start = nitems_read(0);
-    uint64_t end = start + noutput_items;
-    std::vector<tag_t> tags;
-    get_tags_in_range(tags, 0, start, end);
-    bool do_stop = false; // reset after writing data
-    if (tags.size()) {
-        // how many items can we actually consume?
-        ntoconsume = do_handle_tags(tags, start, do_stop, noutput_items);
+void file_sink_impl::do_channel(
+    channel_t& ch, int channel, const char* in, uint64_t starting_offset, int nitems)
+{
+    // single scan of all tags, split by purpose
+    get_tags_in_range(ch.tags, channel, starting_offset, starting_offset + nitems);
+    ch.config_tags.clear();
+    ch.sob_tags.clear();
+    ch.eob_tags.clear();
+    for (size_t t = 0; t < ch.tags.size(); t++) {
+        const pmt::pmt_t& key = ch.tags[t].key;
+        if (pmt::eq(key, BURST_START_KEY)) {
+            ch.sob_tags.push_back(ch.tags[t]);
+        } else if (pmt::eq(key, BURST_STOP_KEY)) {
+            ch.eob_tags.push_back(ch.tags[t]);
+        } else if (pmt::eq(key, RATE_KEY) or pmt::eq(key, FREQ_KEY) or
+                   pmt::eq(key, RX_TIME_KEY)) {
+            ch.config_tags.push_back(ch.tags[t]);
+        }
     }
 
-    // number of items to process
-    int nprocessed = ntoconsume;
+    // configuration tags split the items into segments that are processed
+    // in turn, so a dense tag stream does not fragment work calls
+    size_t icfg = 0, isob = 0, ieob = 0;
+    int pos = 0;
+    while (pos < nitems) {
+        // configuration tags at the start of the segment
+        size_t first = icfg;
+        while ((icfg < ch.config_tags.size()) and
+               (ch.config_tags[icfg].offset <= starting_offset + pos)) {
+            icfg++;
+        }
+        if (icfg > first) {
+            do_handle_tags(ch, ch.config_tags, first, icfg);
+        }
 
-    // manual recording mode
-    if (d_mode == MANUAL) {
-        // check if start recording command needs to be issued
-        if (d_recording) {
-            if (d_check_start) {
-                // compute number of samples to discard
-                if ((not d_align) or (d_samp_time.epoch_frac() - d_T <= 0.0)) {
-                    // as close as we can get to the second boundary
-                    d_ndiscard = 0;
-                } else {
-                    // TODO: This appears to be one sample off in some cases...figure out
-                    // why!
-                    d_ndiscard = (int)std::ceil((double)d_file_writer->get_rate() *
-                                                (1.0 - d_samp_time.epoch_frac()));
-                    if (d_debug) {
-                        GR_LOG_DEBUG(
-                            d_logger,
-                            boost::format(
-                                "epoch_sec = %ld, epoch_frac = %0.6e, ndiscard = %d") %
-                                d_samp_time.epoch_sec() % d_samp_time.epoch_frac() %
-                                d_ndiscard);
-                    }
-                }
+        // segment ends at the next configuration tag
+        int end = nitems;
+        if (icfg < ch.config_tags.size()) {
+            end = (int)(ch.config_tags[icfg].offset - starting_offset);
+        }
 
-                d_check_start = false;
-                d_issue_start = true;
+        if (d_mode == MANUAL) {
+            if (d_recording and d_captures) {
+                do_annotated(ch, in + pos * d_itemsize, starting_offset + pos, end - pos,
+                             isob, ieob);
+            } else if (d_recording) {
+                do_manual(ch, in + pos * d_itemsize, end - pos);
             }
+        } else {
+            do_triggered(
+                ch, in + pos * d_itemsize, starting_offset + pos, end - pos, isob, ieob);
+        }
 
-            if (d_ndiscard) {
-                // throw away as many samples as possible
-                nprocessed = (int)std::min(d_ndiscard, ntoconsume);
-                d_ndiscard -= nprocessed;
-                // GR_LOG_DEBUG(d_logger, boost::format("discarding %d samples") %
-                // nprocessed);
-            } else {
-                if (d_issue_start) {
-                    // start file writer if it has been closed
-                    if (d_debug) {
-                        GR_LOG_DEBUG(
-                            d_logger,
-                            boost::format("starting writer: sec = %ld, frac = %0.6e") %
-                                d_samp_time.epoch_sec() % d_samp_time.epoch_frac());
-                    }
-                    d_file_writer->start(d_samp_time);
-                    d_issue_start = false;
-                }
+        // Update sample time - exact integer advance
+        ch.samp_time.advance(end - pos);
+        pos = end;
+    }
+}
 
-                // write data
-                if (d_file_writer->is_started()) {
-                    d_file_writer->write(in, ntoconsume);
-                    nprocessed = ntoconsume;
-                }
+void file_sink_impl::do_config_change(channel_t& ch)
+{
+    // buffered pre trigger samples no longer match the time base
+    ch.pretrig_head = 0;
+    ch.pretrig_count = 0;
 
-                // signaled to stop - start will be issued on next tag
-                if (do_stop) {
-                    d_file_writer->stop();
-                    do_stop = false;
-                }
+    // recording continues in a new file using the new configuration
+    if (d_mode == MANUAL) {
+        if (ch.writers[0]->is_started()) {
+            GR_LOG_DEBUG(d_logger, "issuing stop command");
+            ch.writers[0]->stop();
+        }
+
+        // signal to begin recording when ready
+        ch.check_start = true;
+        ch.issue_start = false;
+    } else {
+        for (size_t b = 0; b < ch.bursts.size(); b++) {
+            if (not ch.bursts[b].restart) {
+                ch.bursts[b].writer->stop();
+                ch.bursts[b].restart = true;
             }
-        } /* end if d_recording */
+        }
+    }
+}
+
+void file_sink_impl::do_capture(channel_t& ch)
+{
+    // buffered pre trigger samples no longer match the time base
+    ch.pretrig_head = 0;
+    ch.pretrig_count = 0;
+
+    // recording continues in the same file with a new capture
+    if (d_mode == MANUAL) {
+        if (ch.writers[0]->is_started()) {
+            ch.writers[0]->capture(
+                ch.samp_time, ch.writers[0]->get_freq(), ch.writers[0]->get_rate());
+        } else {
+            // not yet started, start time must be determined again
+            ch.check_start = true;
+            ch.issue_start = false;
+        }
     } else {
-        // search for burst tags
-        std::vector<tag_t> burst_tags;
-        if (d_burst_state == 0) {
-            get_tags_in_range(burst_tags, 0, start, end, BURST_START_KEY);
-            if (burst_tags.size()) {
-                // move to start of burst and increment state
-                nprocessed = burst_tags[0].offset - start;
-                d_burst_state = 1;
-
-                // signal to issue start
-                d_issue_start = true;
+        for (size_t b = 0; b < ch.bursts.size(); b++) {
+            if (not ch.bursts[b].restart) {
+                ch.bursts[b].writer->capture(ch.samp_time,
+                                             ch.bursts[b].writer->get_freq(),
+                                             ch.bursts[b].writer->get_rate());
             }
+        }
+    }
+}
+
+void file_sink_impl::do_manual(channel_t& ch, const char* in, int nitems)
+{
+    if (ch.check_start) {
+        // compute number of samples to discard
+        double rate = (double)ch.writers[0]->get_rate();
+        if ((not d_align) or (ch.samp_time.epoch_frac() - 1.0 / rate <= 0.0)) {
+            // as close as we can get to the second boundary
+            ch.ndiscard = 0;
         } else {
-            // issue start if necessary
-            if (d_issue_start) {
-                if (d_debug) {
-                    GR_LOG_DEBUG(d_logger,
-                                 boost::format(
-                                     "starting burst writer: sec = %ld, frac = %0.6e\n") %
-                                     d_samp_time.epoch_sec() % d_samp_time.epoch_frac());
-                }
-                d_file_writer->start(d_samp_time);
-                d_issue_start = false;
+            // TODO: This appears to be one sample off in some cases...figure out
+            // why!
+            ch.ndiscard = (int)std::ceil(rate * (1.0 - ch.samp_time.epoch_frac()));
+            if (d_debug) {
+                GR_LOG_DEBUG(
+                    d_logger,
+                    boost::format("epoch_sec = %ld, epoch_frac = %0.6e, ndiscard = %d") %
+                        ch.samp_time.epoch_sec() % ch.samp_time.epoch_frac() %
+                        ch.ndiscard);
             }
+        }
 
-            get_tags_in_range(burst_tags, 0, start, end, BURST_STOP_KEY);
-            if (burst_tags.size() or do_stop) {
-                GR_LOG_DEBUG(d_logger,
-                             "Burst stop tag received.  Stopping burst writer...\n");
+        ch.check_start = false;
+        ch.issue_start = true;
+    }
 
-                // process all samples up to and including tag
-                nprocessed = burst_tags[0].offset - start + 1;
+    // throw away as many samples as possible
+    int ndiscard = std::min(ch.ndiscard, nitems);
+    ch.ndiscard -= ndiscard;
+    if (ch.ndiscard) {
+        return;
+    }
 
-                // write data up to end of burst
-                d_file_writer->write(in, nprocessed);
-                this->stop();
-            } else {
-                // consume all available data
-                nprocessed = noutput_items;
+    if (ch.issue_start) {
+        // start file writer if it has been closed - the first sample written
+        // follows any discarded samples
+        epoch_time start_time = ch.samp_time;
+        start_time.advance(ndiscard);
+        if (d_debug) {
+            GR_LOG_DEBUG(d_logger,
+                         boost::format("starting writer: sec = %ld, frac = %0.6e") %
+                             start_time.epoch_sec() % start_time.epoch_frac());
+        }
+        ch.writers[0]->start(start_time);
+        ch.issue_start = false;
+    }
 
-                // write data
-                d_file_writer->write(in, nprocessed);
+    // write data
+    if (ch.writers[0]->is_started() and (nitems > ndiscard)) {
+        ch.writers[0]->write(in + ndiscard * d_itemsize, nitems - ndiscard);
+    }
+}
+
+void file_sink_impl::do_annotated(channel_t& ch,
+                                  const char* in,
+                                  uint64_t starting_offset,
+                                  int nitems,
+                                  size_t& isob,
+                                  size_t& ieob)
+{
+    // burst tags of this segment split the items so each annotation starts
+    // and ends on the tagged item
+    uint64_t end_offset = starting_offset + nitems;
+    int pos = 0;
+    while (true) {
+        bool more_sob =
+            (isob < ch.sob_tags.size()) and (ch.sob_tags[isob].offset < end_offset);
+        bool more_eob =
+            (ieob < ch.eob_tags.size()) and (ch.eob_tags[ieob].offset < end_offset);
+        if (not(more_sob or more_eob)) {
+            break;
+        }
+
+        // the end of burst item is part of the burst
+        bool sob = more_sob and ((not more_eob) or (ch.sob_tags[isob].offset <=
+                                                     ch.eob_tags[ieob].offset));
+        int offset = sob ? (int)(ch.sob_tags[isob++].offset - starting_offset)
+                         : (int)(ch.eob_tags[ieob++].offset - starting_offset) + 1;
+        if (offset > pos) {
+            do_manual(ch, in + pos * d_itemsize, offset - pos);
+            pos = offset;
+        }
+        ch.writers[0]->annotate(sob);
+    }
+
+    if (nitems > pos) {
+        do_manual(ch, in + pos * d_itemsize, nitems - pos);
+    }
+}
+
+void file_sink_impl::do_triggered(channel_t& ch,
+                                  const char* in,
+                                  uint64_t starting_offset,
+                                  int nitems,
+                                  size_t& isob,
+                                  size_t& ieob)
+{
+    // resume bursts interrupted by a configuration change
+    for (size_t b = 0; b < ch.bursts.size(); b++) {
+        ch.bursts[b].begin = 0;
+        if (ch.bursts[b].restart) {
+            ch.bursts[b].writer->start(ch.samp_time);
+            if (ch.bursts[b].annotated) {
+                ch.bursts[b].writer->annotate(true);
             }
+            ch.bursts[b].restart = false;
         }
-    } /* end if d_mode */
+    }
 
-    // Update sample time
-    d_samp_time += nprocessed;
-    // std::cout << boost::format("NProcessed: %d, Updating time: (%ld, %0.6f)") %
-    // nprocessed % (d_samp_time.epoch_sec()) % (d_samp_time.epoch_frac()) << std::endl;
+    // handle burst tags of this segment in order of offset, start of burst
+    // first
+    uint64_t end_offset = starting_offset + nitems;
+    bool more_sob = (isob < ch.sob_tags.size()) and (ch.sob_tags[isob].offset < end_offset);
+    bool more_eob = (ieob < ch.eob_tags.size()) and (ch.eob_tags[ieob].offset < end_offset);
+    while (more_sob or more_eob) {
+        if (more_sob and
+            ((not more_eob) or (ch.sob_tags[isob].offset <= ch.eob_tags[ieob].offset))) {
+            // bursts ending before this one release their writers
+            int offset = (int)(ch.sob_tags[isob].offset - starting_offset);
+            burst_write(ch, in, offset);
+            burst_start(ch, ch.sob_tags[isob], offset, in);
+            isob++;
+        } else {
+            burst_stop(
+                ch, ch.eob_tags[ieob], (int)(ch.eob_tags[ieob].offset - starting_offset));
+            ieob++;
+        }
+        more_sob = (isob < ch.sob_tags.size()) and (ch.sob_tags[isob].offset < end_offset);
+        more_eob = (ieob < ch.eob_tags.size()) and (ch.eob_tags[ieob].offset < end_offset);
+    }
 
-    // Tell runtime system how many output items we produced.
-    return nprocessed;
+    // write remaining items
+    burst_write(ch, in, nitems);
+    for (size_t b = 0; b < ch.bursts.size(); b++) {
+        if (ch.bursts[b].end >= 0) {
+            ch.bursts[b].end -= nitems;
+        }
+    }
+
+    // keep the most recent samples for the pre trigger of later bursts
+    pretrig_push(ch, in, nitems);
+}
+
+void file_sink_impl::burst_write(channel_t& ch, const char* in, int nitems)
+{
+    // items of each burst not yet written, up to nitems
+    std::vector<burst_t>::iterator it = ch.bursts.begin();
+    while (it != ch.bursts.end()) {
+        int end = ((it->end < 0) or (it->end > nitems)) ? nitems : (int)it->end;
+
+        // annotation ends before the post trigger samples
+        if (it->annotated and (it->end >= 0) and (it->end - d_posttrigger <= end)) {
+            int mark = std::max((int)(it->end - d_posttrigger), it->begin);
+            if (mark > it->begin) {
+                it->writer->write(in + it->begin * d_itemsize, mark - it->begin);
+                it->begin = mark;
+            }
+            it->writer->annotate(false);
+            it->annotated = false;
+        }
+
+        if (end > it->begin) {
+            it->writer->write(in + it->begin * d_itemsize, end - it->begin);
+            it->begin = end;
+        }
+
+        if ((it->end >= 0) and (it->end <= nitems)) {
+            // end of burst, including post trigger samples
+            GR_LOG_DEBUG(d_logger, boost::format("Burst %d complete") % it->id);
+            it->writer->stop();
+            ch.idle.push_back(it->writer);
+            it = ch.bursts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void file_sink_impl::burst_start(channel_t& ch,
+                                 const tag_t& tag,
+                                 int offset,
+                                 const char* in)
+{
+    // burst id from the tag if given
+    uint64_t id;
+    if (pmt::is_integer(tag.value)) {
+        id = (uint64_t)pmt::to_long(tag.value);
+    } else if (pmt::is_uint64(tag.value)) {
+        id = pmt::to_uint64(tag.value);
+    } else {
+        id = ch.next_burst_id++;
+    }
+
+    // ignore a repeated start of burst
+    for (size_t b = 0; b < ch.bursts.size(); b++) {
+        if ((ch.bursts[b].id == id) and (ch.bursts[b].end < 0)) {
+            return;
+        }
+    }
+
+    if (ch.idle.empty()) {
+        // continue a burst that is only recording post trigger samples
+        for (size_t b = 0; b < ch.bursts.size(); b++) {
+            if (ch.bursts[b].end >= 0) {
+                ch.bursts[b].id = id;
+                ch.bursts[b].end = -1;
+                ch.bursts[b].annotated = true;
+                ch.bursts[b].writer->annotate(true);
+                return;
+            }
+        }
+
+        GR_LOG_WARN(d_logger,
+                    boost::format("All %d file writers in use, dropping burst %d") %
+                        ch.writers.size() % id);
+        return;
+    }
+
+    burst_t burst;
+    burst.writer = ch.idle.back();
+    burst.id = id;
+    burst.begin = offset;
+    burst.end = -1;
+    burst.restart = false;
+    burst.annotated = true;
+    ch.idle.pop_back();
+
+    // pre trigger samples come from earlier calls, then from this call
+    int npre = std::min(d_pretrigger, ch.pretrig_count + offset);
+    int nin = std::min(npre, offset);
+    epoch_time start_time = ch.samp_time;
+    start_time.advance(offset);
+    start_time.rewind(npre);
+    if (d_debug) {
+        GR_LOG_DEBUG(d_logger,
+                     boost::format("starting burst %d: sec = %ld, frac = %0.6e") % id %
+                         start_time.epoch_sec() % start_time.epoch_frac());
+    }
+    burst.writer->start(start_time);
+    pretrig_write(ch, burst.writer, npre - nin);
+    if (nin) {
+        burst.writer->write(in + (offset - nin) * d_itemsize, nin);
+    }
+    burst.writer->annotate(true);
+
+    ch.bursts.push_back(burst);
+}
+
+void file_sink_impl::burst_stop(channel_t& ch, const tag_t& tag, int offset)
+{
+    // end the matching burst, or the oldest burst if no id is given
+    bool has_id = pmt::is_integer(tag.value) or pmt::is_uint64(tag.value);
+    uint64_t id = 0;
+    if (pmt::is_integer(tag.value)) {
+        id = (uint64_t)pmt::to_long(tag.value);
+    } else if (pmt::is_uint64(tag.value)) {
+        id = pmt::to_uint64(tag.value);
+    }
+
+    for (size_t b = 0; b < ch.bursts.size(); b++) {
+        if ((ch.bursts[b].end < 0) and ((not has_id) or (ch.bursts[b].id == id))) {
+            // record through the end of burst sample and post trigger samples
+            ch.bursts[b].end = (int64_t)offset + 1 + d_posttrigger;
+            return;
+        }
+    }
+}
+
+void file_sink_impl::end_bursts(channel_t& ch)
+{
+    for (size_t b = 0; b < ch.bursts.size(); b++) {
+        ch.bursts[b].writer->stop();
+        ch.idle.push_back(ch.bursts[b].writer);
+    }
+    ch.bursts.clear();
+}
+
+file_writer_base::sptr file_sink_impl::add_writer(int channel)
+{
+    channel_t& ch = d_channels[channel];
+    file_writer_base::sptr first = ch.writers[0];
+
+    file_writer_base::sptr writer = file_writer_base::make(d_type,
+                                                           d_file_type,
+                                                           d_itemsize,
+                                                           first->get_nsamples(),
+                                                           first->get_rate(),
+                                                           d_out_dir,
+                                                           d_name_spec,
+                                                           d_logger);
+    writer->set_channel(channel);
+    writer->register_callback(
+        boost::bind(&file_sink_impl::send_update, this, channel, _1, _2, _3, _4, _5));
+
+    // same configuration as the first writer
+    writer->set_freq(first->get_freq());
+    writer->set_file_num_rollover(first->get_file_num_rollover());
+    writer->set_gen_new_folder(first->get_gen_new_folder());
+    writer->set_preopen(first->get_preopen());
+    writer->set_preallocate(first->get_preallocate());
+    writer->set_checksum(first->get_checksum());
+    writer->set_file_counter(ch.file_counter);
+    if (d_async) {
+        writer->set_io_pool(d_io_pool);
+        writer->set_async(true, d_io_nbuffers, d_io_buffer_size, d_io_drop);
+    }
+
+    return writer;
+}
+
+void file_sink_impl::pretrig_push(channel_t& ch, const char* in, int nitems)
+{
+    if (d_pretrigger <= 0) {
+        return;
+    }
+
+    // only the most recent samples can be kept
+    if (nitems >= d_pretrigger) {
+        in += (nitems - d_pretrigger) * d_itemsize;
+        nitems = d_pretrigger;
+        ch.pretrig_head = 0;
+    }
+
+    // copy with wrap around
+    int nfirst = std::min(nitems, d_pretrigger - ch.pretrig_head);
+    memcpy(&ch.pretrig[ch.pretrig_head * d_itemsize], in, nfirst * d_itemsize);
+    memcpy(&ch.pretrig[0], in + nfirst * d_itemsize, (nitems - nfirst) * d_itemsize);
+
+    ch.pretrig_head = (ch.pretrig_head + nitems) % d_pretrigger;
+    ch.pretrig_count = std::min(ch.pretrig_count + nitems, d_pretrigger);
+}
+
+void file_sink_impl::pretrig_write(channel_t& ch,
+                                   file_writer_base::sptr writer,
+                                   int nitems)
+{
+    // most recent samples, oldest first
+    nitems = std::min(nitems, ch.pretrig_count);
+    if (nitems <= 0) {
+        return;
+    }
+
+    int tail = (ch.pretrig_head - nitems + d_pretrigger) % d_pretrigger;
+    int nfirst = std::min(nitems, d_pretrigger - tail);
+    writer->write(&ch.pretrig[tail * d_itemsize], nfirst);
+    if (nitems > nfirst) {
+        writer->write(&ch.pretrig[0], nitems - nfirst);
+    }
 }
 
 /**
@@ -387,7 +974,8 @@ bool file_sink_impl::start()
             throw std::runtime_error("Invalid output path");
         }
         fs::path outfile = temp_dir / d_name_spec;
-        d_msg_file.open(outfile.string().c_str(), std::ifstream::binary);
+        boost::recursive_mutex::scoped_lock lock(d_mutex);
+        d_msg_log->open(outfile.string());
     }
 
     return true;
@@ -400,128 +988,114 @@ bool file_sink_impl::start()
 bool file_sink_impl::stop()
 {
     if (d_type != "message") {
-        // ensure file writer stops
-        d_file_writer->stop();
-    } else {
-        if (d_msg_file.bad()) {
-            GR_LOG_DEBUG(d_logger, "d_msg_file had badbit set");
+        // ensure file writers stop and all queued data is on disk
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            end_bursts(d_channels[c]);
+            d_channels[c].writers[0]->stop();
+        }
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                d_channels[c].writers[w]->flush();
+            }
         }
-        d_msg_file.flush();
-        d_msg_file.close();
+    } else {
+        boost::recursive_mutex::scoped_lock lock(d_mutex);
+        d_msg_log->close();
     }
 
     return true;
 } // end stop
 
-int file_sink_impl::do_handle_tags(std::vector<tag_t>& tags,
-                                   uint64_t starting_offset,
-                                   bool& do_stop,
-                                   int noutput_items)
+bool file_sink_impl::do_handle_tags(channel_t& ch,
+                                    const std::vector<tag_t>& tags,
+                                    size_t first,
+                                    size_t last)
 {
-    int ntoconsume = noutput_items;
-
-    if (not tags.size()) {
-        return ntoconsume;
-    }
-
-    // process all tags, and use the last offset observed to determine
-    // how many samples to consume
-    uint64_t change_offset = starting_offset + noutput_items;
+    // tags that repeat the current configuration, such as a time tag on
+    // every packet of a continuous stream, are not a change. Files in
+    // progress are closed before the first real change is applied so their
+    // metadata describes the samples they hold. File types that record
+    // captures only need a new file for a new sample rate, if at all.
     bool config_changed = false;
-
-    if (d_debug) {
-        GR_LOG_DEBUG(d_logger,
-                     boost::format("Starting tag offset: %ld") % (starting_offset));
-    }
-    for (size_t tag_num = 0; tag_num < tags.size(); ++tag_num) {
+    bool new_capture = false;
+    for (size_t tag_num = first; tag_num < last; ++tag_num) {
         if (d_debug) {
             GR_LOG_DEBUG(d_logger,
                          boost::format("File Sink Tag %ld: key %s, offset %ld") %
                              tag_num % tags[tag_num].key % tags[tag_num].offset);
         }
 
-        // ensure tags that don't affect stream are processed first
-        if (pmt::equal(tags[tag_num].key, RATE_KEY)) {
-            d_file_writer->set_rate((int)pmt::to_double(tags[tag_num].value));
-
-            // update delta
-            d_T = 1.0 / (double)d_file_writer->get_rate();
-            d_samp_time.set_T(d_T);
-            GR_LOG_DEBUG(d_logger,
-                         boost::format("Sample rate set to %d Hz") %
-                             d_file_writer->get_rate());
-
-            config_changed = true;
-            change_offset = tags[tag_num].offset;
-        } else if (pmt::equal(tags[tag_num].key, FREQ_KEY)) {
-            d_file_writer->set_freq((uint64_t)pmt::to_double(tags[tag_num].value));
-            GR_LOG_DEBUG(d_logger,
-                         boost::format("Frequency set to %d Hz") %
-                             d_file_writer->get_freq());
+        if (pmt::eq(tags[tag_num].key, RATE_KEY)) {
+            int rate = (int)pmt::to_double(tags[tag_num].value);
+            if (rate != ch.writers[0]->get_rate()) {
+                if (d_rate_captures) {
+                    new_capture = true;
+                } else if (not config_changed) {
+                    do_config_change(ch);
+                    config_changed = true;
+                }
+                for (size_t w = 0; w < ch.writers.size(); w++) {
+                    ch.writers[w]->set_rate(rate);
+                }
 
-            config_changed = true;
-            change_offset = tags[tag_num].offset;
-        } else if (pmt::equal(tags[tag_num].key, RX_TIME_KEY)) {
+                // update delta
+                ch.samp_time.set_rate((double)ch.writers[0]->get_rate());
+                GR_LOG_DEBUG(d_logger,
+                             boost::format("Sample rate set to %d Hz") %
+                                 ch.writers[0]->get_rate());
+            }
+        } else if (pmt::eq(tags[tag_num].key, FREQ_KEY)) {
+            uint64_t freq = (uint64_t)pmt::to_double(tags[tag_num].value);
+            if (freq != ch.writers[0]->get_freq()) {
+                if (d_captures) {
+                    new_capture = true;
+                } else if (not config_changed) {
+                    do_config_change(ch);
+                    config_changed = true;
+                }
+                for (size_t w = 0; w < ch.writers.size(); w++) {
+                    ch.writers[w]->set_freq(freq);
+                }
+                GR_LOG_DEBUG(d_logger,
+                             boost::format("Frequency set to %d Hz") %
+                                 ch.writers[0]->get_freq());
+            }
+        } else if (pmt::eq(tags[tag_num].key, RX_TIME_KEY)) {
             pmt::pmt_t time_tuple = tags[tag_num].value;
             if (pmt::is_tuple(time_tuple)) {
-                d_samp_time.set(pmt::to_uint64(pmt::tuple_ref(time_tuple, 0)),
-                                pmt::to_double(pmt::tuple_ref(time_tuple, 1)),
-                                1.0 / (double)d_file_writer->get_rate());
-                GR_LOG_DEBUG(d_logger,
-                             boost::format("Updating time: (%ld, %0.6f)") %
-                                 (d_samp_time.epoch_sec()) % (d_samp_time.epoch_frac()));
-
-                config_changed = true;
-                change_offset = tags[tag_num].offset;
+                uint64_t sec = pmt::to_uint64(pmt::tuple_ref(time_tuple, 0));
+                double frac = pmt::to_double(pmt::tuple_ref(time_tuple, 1));
+
+                // within half a sample of the expected time
+                double delta = ((double)sec - (double)ch.samp_time.epoch_sec()) +
+                               (frac - ch.samp_time.epoch_frac());
+                if (std::fabs(delta) * ch.writers[0]->get_rate() >= 0.5) {
+                    if (d_captures) {
+                        new_capture = true;
+                    } else if (not config_changed) {
+                        do_config_change(ch);
+                        config_changed = true;
+                    }
+                    ch.samp_time.set(sec, frac);
+                    GR_LOG_DEBUG(d_logger,
+                                 boost::format("Updating time: (%ld, %0.6f)") %
+                                     (ch.samp_time.epoch_sec()) %
+                                     (ch.samp_time.epoch_frac()));
+                }
             }
         } else { /* NOOP */
         }
     } /* end for tags */
 
-
-    // The command to start the writer is only issue when the observed tags
-    // indicate a configuration change, and the last observed offset for a
-    // configuration change is the same as the starting offset
-    if (d_debug) {
-        GR_LOG_DEBUG(
-            d_logger,
-            boost::format("config changed %d, change offset %ld, writer started %d") %
-                config_changed % change_offset % d_file_writer->is_started());
-    }
-    if (config_changed) {
-        if ((change_offset == starting_offset) and not d_file_writer->is_started()) {
-            GR_LOG_DEBUG(d_logger, "issuing start command");
-
-            // signal to begin recording when ready
-            d_check_start = true;
-            d_issue_start = false;
-
-            ntoconsume = noutput_items;
-        } else {
-            if (d_file_writer->is_started()) {
-                // The command to stop the writer is issued when any tags that require
-                // reconfiguration are observed while the writer is started
-                GR_LOG_DEBUG(d_logger, "issuing stop command");
-                do_stop = true;
-            }
-
-            // setting to not issue start!
-            d_issue_start = false;
-            d_check_start = false;
-
-            // move to the last configuration change tag
-            ntoconsume = change_offset - starting_offset;
-        }
+    // files closed for a new rate start with the new frequency and time
+    if (new_capture and not config_changed) {
+        do_capture(ch);
     }
 
-    // the number of items that can be consumed is equal to the offset of the
-    // last configuration change tag, which defaults to the last sample so that
-    // all are consumed if no configuration changes are observed
     if (d_debug) {
-        GR_LOG_DEBUG(d_logger,
-                     boost::format("Number of samples to consume: %ld") % (ntoconsume));
+        GR_LOG_DEBUG(d_logger, boost::format("config changed %d") % config_changed);
     }
-    return ntoconsume;
+    return config_changed or new_capture;
 }
 
 /***************************************************************************
@@ -540,9 +1114,11 @@ void file_sink_impl::do_set_recording(bool state)
         d_recording = false;
     } else if (not d_recording && state) {
         // start recording
-        d_issue_start = false;
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            d_channels[c].issue_start = false;
+            d_channels[c].check_start = true;
+        }
         d_recording = true;
-        d_check_start = true;
     }
 }
 
@@ -566,7 +1142,11 @@ void file_sink_impl::do_set_mode(trigger_type_t mode)
         d_mode = mode;
 
         // reset burst state
-        d_burst_state = 0;
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            end_bursts(d_channels[c]);
+            d_channels[c].pretrig_head = 0;
+            d_channels[c].pretrig_count = 0;
+        }
     }
 }
 
@@ -574,8 +1154,90 @@ trigger_type_t file_sink_impl::get_mode() { return d_mode; }
 
 void file_sink_impl::set_gen_new_folder(bool value)
 {
-    if (d_type != "message") {
-        d_file_writer->set_gen_new_folder(value);
+    boost::recursive_mutex::scoped_lock lock(d_mutex);
+    for (size_t c = 0; c < d_channels.size(); c++) {
+        for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+            d_channels[c].writers[w]->set_gen_new_folder(value);
+        }
+    }
+}
+
+void file_sink_impl::set_max_bursts(int nbursts)
+{
+    boost::recursive_mutex::scoped_lock lock(d_mutex);
+
+    d_max_bursts = std::max(nbursts, 1);
+    for (size_t c = 0; c < d_channels.size(); c++) {
+        channel_t& ch = d_channels[c];
+
+        // bursts in progress are ended
+        end_bursts(ch);
+
+        // concurrent writers share file numbers, continuing from the first
+        if ((d_max_bursts > 1) and not ch.file_counter) {
+            ch.writers[0]->flush();
+            ch.file_counter.reset(
+                new file_num_counter(ch.writers[0]->get_file_num()));
+            ch.writers[0]->set_file_counter(ch.file_counter);
+        }
+
+        while ((int)ch.writers.size() < d_max_bursts) {
+            ch.writers.push_back(add_writer(c));
+        }
+        while ((int)ch.writers.size() > d_max_bursts) {
+            ch.writers.back()->set_async(false);
+            ch.writers.pop_back();
+        }
+        ch.idle = ch.writers;
+    }
+}
+
+void file_sink_impl::set_pretrigger(int nsamples)
+{
+    boost::recursive_mutex::scoped_lock lock(d_mutex);
+
+    // preallocate ring of most recent samples
+    d_pretrigger = std::max(nsamples, 0);
+    for (size_t c = 0; c < d_channels.size(); c++) {
+        d_channels[c].pretrig.resize(d_pretrigger * d_itemsize);
+        d_channels[c].pretrig_head = 0;
+        d_channels[c].pretrig_count = 0;
+    }
+}
+
+void file_sink_impl::set_posttrigger(int nsamples)
+{
+    boost::recursive_mutex::scoped_lock lock(d_mutex);
+    d_posttrigger = std::max(nsamples, 0);
+}
+
+void file_sink_impl::set_async(bool enable, int nbuffers, int buffer_size, bool drop)
+{
+    boost::recursive_mutex::scoped_lock lock(d_mutex);
+
+    // writers must release the shared threads before they are replaced
+    for (size_t c = 0; c < d_channels.size(); c++) {
+        for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+            d_channels[c].writers[w]->set_async(false);
+        }
+    }
+    d_io_pool.reset();
+
+    // applied to writers added later
+    d_async = enable and d_channels.size();
+    d_io_nbuffers = nbuffers;
+    d_io_buffer_size = buffer_size;
+    d_io_drop = drop;
+
+    if (d_async) {
+        int nthreads = (d_io_threads > 0) ? d_io_threads : d_nchan;
+        d_io_pool.reset(new file_io_pool(nthreads));
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                d_channels[c].writers[w]->set_io_pool(d_io_pool);
+                d_channels[c].writers[w]->set_async(enable, nbuffers, buffer_size, drop);
+            }
+        }
     }
 }
 
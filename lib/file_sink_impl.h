@@ -12,6 +12,7 @@
 
 #include "epoch_time.h"
 #include "file_sink/file_writer_base.h"
+#include "message_log.h"
 #include <sandia_utils/constants.h>
 #include <sandia_utils/file_sink.h>
 
@@ -22,43 +23,105 @@ class file_sink_impl : public file_sink
 {
 private:
     std::string d_type;
+    std::string d_file_type;
+    // file type records frequency and time changes and bursts in the file
+    bool d_captures;
+    // file type also records sample rate changes
+    bool d_rate_captures;
     size_t d_itemsize;
     trigger_type_t d_mode;
     int d_freq;
     uint64_t d_nsamples;
     std::string d_out_dir;
     std::string d_name_spec;
+    int d_nchan;
 
-    // sampling period
-    double d_T;
+    // burst being recorded
+    struct burst_t {
+        file_writer_base::sptr writer;
 
-    // base class
-    file_writer_base::sptr d_file_writer;
+        // burst id from the start of burst tag, or assigned in sequence
+        uint64_t id;
 
-    // state of recording
-    bool d_recording;
-    bool d_check_start;
-    bool d_issue_start;
+        // first item of the current call in the burst
+        int begin;
+
+        // item at which recording ends, relative to the current call, or -1
+        // while waiting for end of burst
+        int64_t end;
+
+        // continue in a new file after a configuration change
+        bool restart;
+
+        // annotation of the burst is open
+        bool annotated;
+    };
+
+    // per channel recording state
+    struct channel_t {
+        // file writers - the first is used for manual recording, all are
+        // available to record bursts
+        std::vector<file_writer_base::sptr> writers;
+
+        // sample timestamp (epoch integer and fractional second)
+        epoch_time samp_time;
+
+        // start handling
+        bool check_start;
+        bool issue_start;
+
+        // number of samples to discard
+        int ndiscard;
+
+        // bursts being recorded, in order of start, and unused writers
+        std::vector<burst_t> bursts;
+        std::vector<file_writer_base::sptr> idle;
+        uint64_t next_burst_id;
 
-    // mode state
-    // 0 - waiting for start of burst
-    // 1 - waiting for end of burst
-    int d_burst_state;
+        // file numbers shared by concurrent burst writers
+        file_num_counter::sptr file_counter;
 
-    // number of samples to discard
-    int d_ndiscard;
+        // tags of the current work call
+        std::vector<tag_t> tags;
+        std::vector<tag_t> config_tags;
+        std::vector<tag_t> sob_tags;
+        std::vector<tag_t> eob_tags;
+
+        // ring of most recent samples for burst pre trigger
+        std::vector<char> pretrig;
+        int pretrig_head;
+        int pretrig_count;
+    };
+    std::vector<channel_t> d_channels;
+
+    // state of recording
+    bool d_recording;
 
     // align to secondary boundary
     bool d_align;
 
-    // sample timestamp (epoch integer and fractional second)
-    epoch_time d_samp_time;
+    // samples recorded before start of burst and after end of burst
+    int d_pretrigger;
+    int d_posttrigger;
+
+    // maximum number of concurrent bursts per channel
+    int d_max_bursts;
+
+    // shared background I/O threads
+    file_io_pool::sptr d_io_pool;
+    int d_io_threads;
+
+    // background I/O configuration, applied to writers added later
+    bool d_async;
+    int d_io_nbuffers;
+    int d_io_buffer_size;
+    bool d_io_drop;
 
     // protection
     boost::recursive_mutex d_mutex;
 
-    // message stream file object
-    std::ofstream d_msg_file;
+    // message log writer
+    boost::shared_ptr<message_log_writer> d_msg_log;
 
     bool d_debug;
 
@@ -75,6 +138,7 @@ public:
      * @param out_dir - Base output directory
      * @param name_spec - Name specification format string
      * @param debug - turn on debug functionality
+     * @param nchan - Number of input channels
      */
     file_sink_impl(std::string type,
                    size_t itemsize,
@@ -84,7 +148,8 @@ public:
                    int rate,
                    std::string out_dir,
                    std::string name_spec,
-                   bool debug = false);
+                   bool debug = false,
+                   int nchan = 1);
 
     /**
      * Deconstructor
@@ -110,7 +175,12 @@ public:
     bool stop();
 
     // publish updates
-    void send_update(std::string fname, epoch_time file_time, double freq, double rate)
+    void send_update(int channel,
+                     std::string fname,
+                     epoch_time file_time,
+                     double freq,
+                     double rate,
+                     int64_t checksum)
     {
         // publish update
         pmt::pmt_t dict = pmt::dict_add(pmt::make_dict(), FNAME_KEY, pmt::intern(fname));
@@ -120,6 +190,12 @@ public:
                                              pmt::from_double(file_time.epoch_frac())));
         dict = pmt::dict_add(dict, FREQ_KEY, pmt::from_double(freq));
         dict = pmt::dict_add(dict, RATE_KEY, pmt::from_double(rate));
+        if (d_nchan > 1) {
+            dict = pmt::dict_add(dict, CHANNEL_KEY, pmt::from_long(channel));
+        }
+        if (checksum >= 0) {
+            dict = pmt::dict_add(dict, CRC32C_KEY, pmt::from_long(checksum));
+        }
         message_port_pub(PDU_KEY, pmt::cons(dict, pmt::PMT_NIL));
     }
 
@@ -131,7 +207,11 @@ public:
     bool get_recording();
 
     // set second  alignment
-    void set_second_align(bool align) { d_align = align; }
+    void set_second_align(bool align)
+    {
+        boost::recursive_mutex::scoped_lock lock(d_mutex);
+        d_align = align;
+    }
     bool get_second_align() { return d_align; }
 
     // set/get mode
@@ -141,8 +221,11 @@ public:
     // set/get number of samples per file
     void set_nsamples(uint64_t nsamples)
     {
-        if (d_type != "message") {
-            d_file_writer->set_nsamples(nsamples);
+        boost::recursive_mutex::scoped_lock lock(d_mutex);
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                d_channels[c].writers[w]->set_nsamples(nsamples);
+            }
         }
     }
     uint64_t get_nsamples()
@@ -150,15 +233,18 @@ public:
         if (d_type == "message") {
             return 0;
         } else {
-            return d_file_writer->get_nsamples();
+            return d_channels[0].writers[0]->get_nsamples();
         }
     }
 
     // set/get file number rollover value
     void set_file_num_rollover(int rollover)
     {
-        if (d_type != "message") {
-            d_file_writer->set_file_num_rollover(rollover);
+        boost::recursive_mutex::scoped_lock lock(d_mutex);
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                d_channels[c].writers[w]->set_file_num_rollover(rollover);
+            }
         }
     }
     int get_file_num_rollover()
@@ -166,26 +252,146 @@ public:
         if (d_type == "message") {
             return 0;
         } else {
-            return d_file_writer->get_file_num_rollover();
+            return d_channels[0].writers[0]->get_file_num_rollover();
+        }
+    }
+
+    // set/get background I/O
+    void set_async(bool enable, int nbuffers, int buffer_size, bool drop);
+    bool get_async()
+    {
+        if (d_type == "message") {
+            return false;
+        } else {
+            return d_channels[0].writers[0]->get_async();
         }
     }
 
+    // set/get number of shared background I/O threads
+    void set_io_threads(int nthreads) { d_io_threads = nthreads; }
+    int get_io_threads() { return d_io_threads; }
+
+    // number of input channels
+    int get_nchan() { return d_nchan; }
+
+    // set/get maximum number of concurrent bursts
+    void set_max_bursts(int nbursts);
+    int get_max_bursts() { return d_max_bursts; }
+
+    // set/get burst pre and post trigger samples
+    void set_pretrigger(int nsamples);
+    int get_pretrigger() { return d_pretrigger; }
+    void set_posttrigger(int nsamples);
+    int get_posttrigger() { return d_posttrigger; }
+
+    // set/get opening of next file in advance
+    void set_preopen(bool preopen)
+    {
+        boost::recursive_mutex::scoped_lock lock(d_mutex);
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                d_channels[c].writers[w]->set_preopen(preopen);
+            }
+        }
+    }
+    bool get_preopen()
+    {
+        if (d_type == "message") {
+            return false;
+        } else {
+            return d_channels[0].writers[0]->get_preopen();
+        }
+    }
+
+    // set/get preallocation of output files
+    void set_preallocate(bool preallocate)
+    {
+        boost::recursive_mutex::scoped_lock lock(d_mutex);
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                d_channels[c].writers[w]->set_preallocate(preallocate);
+            }
+        }
+    }
+    bool get_preallocate()
+    {
+        if (d_type == "message") {
+            return false;
+        } else {
+            return d_channels[0].writers[0]->get_preallocate();
+        }
+    }
+
+    // set/get per-file checksums
+    void set_checksum(bool checksum)
+    {
+        boost::recursive_mutex::scoped_lock lock(d_mutex);
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                d_channels[c].writers[w]->set_checksum(checksum);
+            }
+        }
+    }
+    bool get_checksum()
+    {
+        if (d_type == "message") {
+            return false;
+        } else {
+            return d_channels[0].writers[0]->get_checksum();
+        }
+    }
+
+    // background I/O statistics - totals over all channels
+    uint64_t get_nstalls()
+    {
+        uint64_t nstalls = 0;
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                nstalls += d_channels[c].writers[w]->get_nstalls();
+            }
+        }
+        return nstalls;
+    }
+    uint64_t get_ndropped()
+    {
+        uint64_t ndropped = 0;
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                ndropped += d_channels[c].writers[w]->get_ndropped();
+            }
+        }
+        return ndropped;
+    }
+    uint64_t get_nerrors()
+    {
+        uint64_t nerrors = 0;
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                nerrors += d_channels[c].writers[w]->get_nerrors();
+            }
+        }
+        return nerrors;
+    }
+
     // set/get new folder
     void set_gen_new_folder(bool mode);
     bool get_gen_new_folder()
     {
-        if (d_type != "messsage") {
+        if (d_type == "message") {
             return false;
         } else {
-            return d_file_writer->get_gen_new_folder();
+            return d_channels[0].writers[0]->get_gen_new_folder();
         }
     }
 
     // set center freq
     void set_freq(int freq)
     {
-        if (d_type != "message") {
-            d_file_writer->set_freq(freq);
+        boost::recursive_mutex::scoped_lock lock(d_mutex);
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                d_channels[c].writers[w]->set_freq(freq);
+            }
         }
     }
     int get_freq()
@@ -193,15 +399,18 @@ public:
         if (d_type == "message") {
             return 0;
         } else {
-            return d_file_writer->get_freq();
+            return d_channels[0].writers[0]->get_freq();
         }
     }
 
     // set sample rate
     void set_rate(int rate)
     {
-        if (d_type != "message") {
-            d_file_writer->set_rate(rate);
+        boost::recursive_mutex::scoped_lock lock(d_mutex);
+        for (size_t c = 0; c < d_channels.size(); c++) {
+            for (size_t w = 0; w < d_channels[c].writers.size(); w++) {
+                d_channels[c].writers[w]->set_rate(rate);
+            }
         }
     }
     int get_rate()
@@ -209,17 +418,44 @@ public:
         if (d_type == "message") {
             return 0;
         } else {
-            return d_file_writer->get_rate();
+            return d_channels[0].writers[0]->get_rate();
         }
     }
 
 private:
     void do_set_recording(bool state);
     void do_set_mode(trigger_type_t mode);
-    int do_handle_tags(std::vector<tag_t>& tags,
-                       uint64_t starting_offset,
-                       bool& do_stop,
-                       int noutput_items);
+    void do_channel(channel_t& ch,
+                    int channel,
+                    const char* in,
+                    uint64_t starting_offset,
+                    int nitems);
+    bool do_handle_tags(channel_t& ch,
+                        const std::vector<tag_t>& tags,
+                        size_t first,
+                        size_t last);
+    void do_config_change(channel_t& ch);
+    void do_capture(channel_t& ch);
+    void do_manual(channel_t& ch, const char* in, int nitems);
+    void do_annotated(channel_t& ch,
+                      const char* in,
+                      uint64_t starting_offset,
+                      int nitems,
+                      size_t& isob,
+                      size_t& ieob);
+    void do_triggered(channel_t& ch,
+                      const char* in,
+                      uint64_t starting_offset,
+                      int nitems,
+                      size_t& isob,
+                      size_t& ieob);
+    void burst_write(channel_t& ch, const char* in, int nitems);
+    void burst_start(channel_t& ch, const tag_t& tag, int offset, const char* in);
+    void burst_stop(channel_t& ch, const tag_t& tag, int offset);
+    void end_bursts(channel_t& ch);
+    file_writer_base::sptr add_writer(int channel);
+    void pretrig_push(channel_t& ch, const char* in, int nitems);
+    void pretrig_write(channel_t& ch, file_writer_base::sptr writer, int nitems);
 
 }; // end class file_sink_impl
 
@@ -14,8 +14,18 @@
 #include <gnuradio/io_signature.h>
 #include "file_reader_base.h"
 // #include "../file_source_impl.h"
+#include <sandia_utils/constants.h>
 #include <sys/stat.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+
+// amount of data requested when a file is opened ahead of playback
+#define PREFETCH_SIZE (16 * 1024 * 1024)
+
+// amount of data staged for conversion at a time
+#define CONVERT_BLOCK_SIZE (64 * 1024)
 
 
 namespace gr {
@@ -26,8 +36,14 @@ namespace gr {
      */
     file_reader_base::file_reader_base(size_t itemsize, gr::logger_ptr logger)
       : d_itemsize(itemsize),
-        d_logger(logger),
-        d_is_open(false)
+        d_is_open(false),
+        d_fd(-1),
+        d_file_size(0),
+        d_data_offset(0),
+        d_data_end(0),
+        d_pos(0),
+        d_time_indexed(false),
+        d_logger(logger)
     {
       d_tags.resize(0);
     }
@@ -45,50 +61,198 @@ namespace gr {
       if (d_is_open) { this->close(); }
 
       GR_LOG_DEBUG(d_logger,boost::format("File Reader: Opening file %s") % filename);
+      d_filename = std::string(filename);
 
       // clear all tags
       d_tags.clear();
+      d_time_indexed = false;
 
       // we use "open" to use to the O_LARGEFILE flag
-      int fd;
-      if((fd = ::open(filename, O_RDONLY | OUR_O_LARGEFILE | OUR_O_BINARY)) < 0) {
+      if((d_fd = ::open(filename, O_RDONLY | OUR_O_LARGEFILE | OUR_O_BINARY)) < 0) {
         perror(filename);
         throw std::runtime_error("can't open file");
       }
 
-      if((d_fp = fdopen (fd, "rb")) == NULL) {
+      // file size is kept as 64 bits regardless of platform
+      struct stat st;
+      if (fstat(d_fd, &st) != 0) {
         perror(filename);
-        ::close(fd);	// don't leak file descriptor if fdopen fails
+        ::close(d_fd);	// don't leak file descriptor if fstat fails
+        d_fd = -1;
         throw std::runtime_error("can't open file");
       }
-
-      //Check to ensure the file will be consumed according to item size
-      fseek(d_fp, 0, SEEK_END);
-      d_file_size = ftell(d_fp);
-      rewind (d_fp);
+      d_file_size = (uint64_t)st.st_size;
+      d_data_offset = 0;
+      d_data_end = d_file_size;
+      d_pos = 0;
 
       d_is_open = true;
     }
 
     void
     file_reader_base::close() {
-      if ((d_is_open) and (d_fp != NULL)) {
-        fclose(d_fp);
+      if ((d_is_open) and (d_fd >= 0)) {
+        ::close(d_fd);
         d_is_open = false;
-        d_fp = NULL;
+        d_fd = -1;
       }
     }
 
+    void file_reader_base::prefetch()
+    {
+      if ((d_fd < 0) or (d_data_end <= d_data_offset)) { return; }
+
+      // file is read once from start to end
+      uint64_t length = std::min(d_data_end - d_data_offset, (uint64_t)PREFETCH_SIZE);
+      posix_fadvise(d_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      posix_fadvise(d_fd, (off_t)d_data_offset, (off_t)length, POSIX_FADV_WILLNEED);
+    }
+
     /**
      * Seek in the file source
      *
-     * @param seek_point - offset position to seek to
+     * @param seek_point - item offset position to seek to, relative to
+     *                     the first sample for SEEK_SET
      * @param whence - refrence point for seek, see fseek
-     * @return bool - 0 or false on success
+     * @return bool - true on success
+     */
+    bool file_reader_base::seek(int64_t seek_point, int whence)
+    {
+      if (not d_is_open) { return false; }
+
+      int64_t base;
+      switch (whence) {
+        case SEEK_SET: base = (int64_t)d_data_offset; break;
+        case SEEK_CUR: base = (int64_t)d_pos; break;
+        case SEEK_END: base = (int64_t)d_data_end; break;
+        default: return false;
+      }
+
+      // positions before the first sample are not valid
+      int64_t pos = base + seek_point * (int64_t)d_itemsize;
+      if (pos < (int64_t)d_data_offset) {
+        return false;
+      }
+
+      d_pos = (uint64_t)pos;
+      return true;
+    }
+
+    void file_reader_base::build_time_index()
+    {
+      d_time_index.clear();
+      d_time_indexed = true;
+
+      // tags are in order of offset, the rate in effect applies to each time
+      double rate = 0.0;
+      for (size_t i = 0; i < d_tags.size(); i++) {
+        const gr::tag_t &tag = d_tags[i];
+        if (pmt::eq(tag.key, RATE_KEY)) {
+          rate = pmt::to_double(tag.value);
+          if (d_time_index.size() and (d_time_index.back().item == tag.offset)) {
+            d_time_index.back().rate = rate;
+            d_time_index.back().time.set_rate(rate);
+          }
+        }
+        else if (pmt::eq(tag.key, RX_TIME_KEY)) {
+          time_point_t point;
+          point.item = tag.offset;
+          point.time = epoch_time(pmt::to_uint64(pmt::tuple_ref(tag.value, 0)),
+              pmt::to_double(pmt::tuple_ref(tag.value, 1)));
+          point.rate = rate;
+          point.time.set_rate(rate);
+          d_time_index.push_back(point);
+        }
+      }
+    }
+
+    bool file_reader_base::seek_time(const epoch_time &time)
+    {
+      if (not d_is_open) { return false; }
+      if (not d_time_indexed) { build_time_index(); }
+
+      // last segment starting at or before the time
+      size_t lo = 0, hi = d_time_index.size();
+      while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        const epoch_time &t = d_time_index[mid].time;
+        if ((t.epoch_sec() < time.epoch_sec()) or
+            ((t.epoch_sec() == time.epoch_sec()) and (t.epoch_frac() <= time.epoch_frac()))) {
+          lo = mid + 1;
+        }
+        else {
+          hi = mid;
+        }
+      }
+      if ((lo == 0) or (d_time_index[lo - 1].rate <= 0.0)) { return false; }
+      const time_point_t &point = d_time_index[lo - 1];
+
+      // first sample at or after the time, the start of the next segment
+      // for a time after the end of this one
+      double offset = ((double)time.epoch_sec() - (double)point.time.epoch_sec()) +
+                      (time.epoch_frac() - point.time.epoch_frac());
+      uint64_t item = point.item + (uint64_t)std::ceil(offset * point.rate - 1e-6);
+      if (lo < d_time_index.size()) {
+        item = std::min(item, d_time_index[lo].item);
+      }
+      if (item >= nitems()) { return false; }
+
+      return seek((int64_t)item, SEEK_SET);
+    }
+
+    void file_reader_base::position_tags(uint64_t item, std::vector<gr::tag_t> &tags)
+    {
+      if (not d_time_indexed) { build_time_index(); }
+
+      // latest tag of each key
+      std::vector<gr::tag_t> latest;
+      for (size_t i = 0; (i < d_tags.size()) and (d_tags[i].offset <= item); i++) {
+        size_t k = 0;
+        while ((k < latest.size()) and (not pmt::eq(latest[k].key, d_tags[i].key))) { k++; }
+        if (k == latest.size()) { latest.push_back(d_tags[i]); }
+        else { latest[k] = d_tags[i]; }
+      }
+
+      for (size_t k = 0; k < latest.size(); k++) {
+        latest[k].offset = item;
+        if (pmt::eq(latest[k].key, RX_TIME_KEY)) {
+          // time advanced from the start of the segment
+          for (size_t i = d_time_index.size(); i > 0; i--) {
+            if ((d_time_index[i - 1].item <= item) and (d_time_index[i - 1].rate > 0.0)) {
+              epoch_time t = d_time_index[i - 1].time;
+              t.advance(item - d_time_index[i - 1].item);
+              latest[k].value = pmt::make_tuple(pmt::from_uint64(t.epoch_sec()),
+                  pmt::from_double(t.epoch_frac()));
+              break;
+            }
+          }
+        }
+        tags.push_back(latest[k]);
+      }
+    }
+
+    /**
+     * Read bytes at an absolute file offset without moving the position
+     *
+     * @param dest - destination storage
+     * @param nbytes - number of bytes to read
+     * @param offset - byte offset in file
+     * @return int64_t - number of bytes read, -1 on error
      */
-    bool file_reader_base::seek(long seek_point, int whence)
+    int64_t file_reader_base::read_at(char *dest, uint64_t nbytes, uint64_t offset)
     {
-      return fseek((FILE*)d_fp, seek_point *d_itemsize, whence) == 0;
+      uint64_t nread = 0;
+      while (nread < nbytes) {
+        ssize_t ret = pread(d_fd, dest + nread, nbytes - nread, (off_t)(offset + nread));
+        if (ret < 0) {
+          if (errno == EINTR) { continue; }
+          return -1;
+        }
+        if (ret == 0) { break; }
+        nread += (uint64_t)ret;
+      }
+
+      return (int64_t)nread;
     }
 
     /**
@@ -101,10 +265,39 @@ namespace gr {
      */
     int file_reader_base::read(char *dest, int nitems)
     {
-      if (d_is_open) {
-        return fread(dest, d_itemsize,nitems,(FILE *)d_fp);
+      if ((not d_is_open) or (d_pos >= d_data_end)) { return 0; }
+
+      uint64_t nwanted = std::min((uint64_t)nitems * d_itemsize, d_data_end - d_pos);
+      int64_t nbytes = read_at(dest, nwanted, d_pos);
+      if (nbytes <= 0) { return 0; }
+
+      // a trailing partial item is consumed but not returned
+      d_pos += (uint64_t)nbytes;
+      return (int)((uint64_t)nbytes / d_itemsize);
+    }
+
+    int file_reader_base::read_converted(float *dest, int nitems, sample_converter &conv)
+    {
+      int block = std::max(1, (int)(CONVERT_BLOCK_SIZE / d_itemsize));
+      if (d_convert_buf.size() < block * d_itemsize) {
+        d_convert_buf.resize(block * d_itemsize);
+      }
+
+      size_t ncomponents = d_itemsize / conv.input_size();
+      int nread = 0;
+      while (nread < nitems) {
+        int nwanted = std::min(block, nitems - nread);
+        int n = this->read(&d_convert_buf[0], nwanted);
+        if (n <= 0) { break; }
+
+        conv.convert(&d_convert_buf[0], dest + nread * ncomponents, n * ncomponents);
+        nread += n;
+
+        // short read, let the caller handle the end of the file
+        if (n < nwanted) { break; }
       }
-      else { return 0; }
+
+      return nread;
     }
 
   } /* namespace sandia_utils */
@@ -22,6 +22,7 @@
 #include <gnuradio/logger.h>
 #include <gnuradio/tags.h>
 #include "../epoch_time.h"
+#include "sample_converter.h"
 
 // win32 (mingw/msvc) specific
 #ifdef HAVE_IO_H
@@ -57,12 +58,34 @@ namespace gr
         // file status
         bool d_is_open;
         std::string d_filename;
-        FILE *d_fp;
-        int d_file_size;
+        int d_fd;
+
+        // file size, start and end of samples and current position in bytes.
+        // samples end at the file size unless metadata follows them
+        uint64_t d_file_size;
+        uint64_t d_data_offset;
+        uint64_t d_data_end;
+        uint64_t d_pos;
 
         // metadata tags
         std::vector<gr::tag_t> d_tags;
 
+        // sparse time index built from the time and rate tags, one entry
+        // for the first sample of each segment with known timing
+        struct time_point_t
+        {
+          uint64_t item;
+          epoch_time time;
+          double rate;
+        };
+        std::vector<time_point_t> d_time_index;
+        bool d_time_indexed;
+
+        void build_time_index();
+
+        // file samples staged for conversion
+        std::vector<char> d_convert_buf;
+
         // logger
         gr::logger_ptr d_logger;
 
@@ -99,6 +122,14 @@ namespace gr
           return d_is_open;
         }
 
+        /**
+         * Name of the open file
+         */
+        std::string filename()
+        {
+          return d_filename;
+        }
+
         /**
          * Closes the open file
          */
@@ -114,6 +145,34 @@ namespace gr
          */
         virtual int read( char *dest, int nitems );
 
+        /**
+         * Read items from file, converting them to float.
+         * Items are staged in blocks small enough to stay in cache, readers
+         * with samples in memory convert them in place
+         *
+         * @param dest - destination storage for converted samples
+         * @param nitems - number of items to read
+         * @param conv - sample conversion
+         * @return int - number of items read. 0 on EOF or error
+         */
+        virtual int read_converted( float *dest, int nitems, sample_converter &conv );
+
+        /**
+         * Read bytes at an absolute file offset without moving the position
+         *
+         * @param dest - destination storage
+         * @param nbytes - number of bytes to read
+         * @param offset - byte offset in file
+         * @return int64_t - number of bytes read, -1 on error
+         */
+        int64_t read_at( char *dest, uint64_t nbytes, uint64_t offset );
+
+        /**
+         * Warm the page cache for upcoming reads.
+         * Called on files that are opened ahead of playback
+         */
+        virtual void prefetch();
+
         /**
          * Returns tags vector
          *
@@ -127,20 +186,63 @@ namespace gr
         /**
          * Seek in the file source
          *
-         * @param seek_point - offset position to seek to
+         * @param seek_point - item offset position to seek to, relative to
+         *                     the first sample for SEEK_SET
          * @param whence - refrence point for seek, see fseek
-         * @return bool - 0 or false on success
+         * @return bool - true on success
          */
-        virtual bool seek( long seek_point, int whence );
+        virtual bool seek( int64_t seek_point, int whence );
+
+        /**
+         * Seek to the first sample at or after a time
+         *
+         * The item offset is computed from the time and rate of the segment
+         * holding the time, found in a sparse index of segment start times.
+         * Segment start times must increase through the file.
+         *
+         * @param time - time to seek to
+         * @return bool - false if the file has no timing information or the
+         *                time is outside the file
+         */
+        virtual bool seek_time( const epoch_time &time );
+
+        /**
+         * Metadata tags in effect at an item
+         *
+         * Appends the latest tag of each key at or before the item, with
+         * the offset set to the item and the time advanced to it.
+         *
+         * @param item - item offset from the first sample
+         * @param tags - vector tags are appended to
+         */
+        void position_tags( uint64_t item, std::vector<gr::tag_t> &tags );
+
+        /**
+         * Number of items in the file
+         */
+        virtual uint64_t nitems()
+        {
+          return (d_data_end - d_data_offset) / d_itemsize;
+        }
+
+        /**
+         * Current position in the file source
+         *
+         * @return uint64_t - item offset from the first sample
+         */
+        virtual uint64_t tell()
+        {
+          return (d_pos - d_data_offset) / d_itemsize;
+        }
 
         /**
          * Returns End Of File( EOF ) status
          *
-         * @return bool - true if EOF
+         * @return bool - true if no complete item remains
          */
         virtual bool eof()
         {
-          return (ftell( d_fp ) == d_file_size);
+          return ((d_pos >= d_data_end) or ((d_data_end - d_pos) < d_itemsize));
         }
     }; //end class file_reader_base
 
@@ -8,11 +8,49 @@
  */
 #include<sandia_utils/constants.h>
 #include "file_reader_bluefile.h"
+#include <algorithm>
+#include <string.h>
+#include <volk/volk.h>
 
 namespace gr
 {
   namespace sandia_utils
   {
+    namespace
+    {
+      bool host_big_endian()
+      {
+        const uint16_t one = 1;
+        return (*(const char *)&one == 0);
+      }
+
+      // header value stored in the given byte order
+      template <typename T>
+      T header_value( const char *buf, size_t offset, bool big_endian )
+      {
+        char bytes[sizeof(T)];
+        memcpy( bytes, buf + offset, sizeof(T) );
+        if( big_endian != host_big_endian() )
+        {
+          std::reverse( bytes, bytes + sizeof(T) );
+        }
+
+        T value;
+        memcpy( &value, bytes, sizeof(T) );
+        return value;
+      }
+    } // namespace
+
+    file_reader_bluefile::file_reader_bluefile( size_t itemsize, gr::logger_ptr logger )
+      : file_reader_base( itemsize, logger ),
+        d_swap( false ),
+        d_element_size( 1 )
+    {
+    }
+
+    file_reader_bluefile::~file_reader_bluefile()
+    {
+    }
 
     void file_reader_bluefile::open( const char *filename )
     {
@@ -21,114 +59,226 @@ namespace gr
         this->close();
       }
 
-      GR_LOG_DEBUG( d_logger, boost::format("File Reader: Opening file %s") % filename );
-      d_filename = std::string( filename );
+      // open and determine size
+      file_reader_base::open( filename );
 
-      d_blue_reader = new bluefile::BlueFile();
+      // header control block
+      char hcb[BLUE_HEADER_SIZE];
+      if( (read_at( hcb, sizeof(hcb), 0 ) != BLUE_HEADER_SIZE) or
+          (memcmp( hcb + BLUE_VERSION, "BLUE", 4 ) != 0) )
+      {
+        this->close();
+        throw std::runtime_error( "Unable to read bluefile header" );
+      }
+      bool head_be = (memcmp( hcb + BLUE_HEAD_REP, "IEEE", 4 ) == 0);
+      bool data_be = (memcmp( hcb + BLUE_DATA_REP, "IEEE", 4 ) == 0);
 
-      // open file
-      d_file_size = int( d_blue_reader->open( filename, bluefile::BlueFile::READ ) );
-      d_type = d_blue_reader->get_format();
-      d_bpe = d_blue_reader->get_bpe();
-      d_bps = d_blue_reader->get_bps();
+      if( header_value<int32_t>( hcb, BLUE_DETACHED, head_be ) != 0 )
+      {
+        this->close();
+        throw std::runtime_error( "Detached bluefile data is not supported" );
+      }
 
-      // read header information and populate tags - no frequency information right now
-      double rate = 1.0 / d_blue_reader->get_xdelta();
-      epoch_time file_time( d_blue_reader->get_xstart() );
+      // only type 1000 files and their subtypes, a single sampled
+      // dimension, have the adjunct header read below
+      int32_t type = header_value<int32_t>( hcb, BLUE_TYPE, head_be );
+      if( type / 1000 != 1 )
+      {
+        this->close();
+        throw std::runtime_error( str( boost::format( "Unsupported bluefile type %d" ) % type ) );
+      }
 
-      gr::tag_t tag;
-      d_tags.clear();
-      // tag.key = FREQ_KEY; tag.value = pmt::from_double(metadata[0]); d_tags.push_back(tag);
-      tag.key = RATE_KEY;
-      tag.value = pmt::from_double( rate );
-      d_tags.push_back( tag );
-      tag.key = RX_TIME_KEY;
-      tag.value = pmt::make_tuple( pmt::from_uint64( file_time.epoch_sec() ),
-          pmt::from_double( file_time.epoch_frac() ) );
-      d_tags.push_back( tag );
+      // samples are made of components of the element type
+      d_format = std::string( hcb + BLUE_FORMAT, 2 );
+      size_t ncomponents = 0;
+      switch( d_format[0] )
+      {
+        case 'S': ncomponents = 1; break;
+        case 'C': ncomponents = 2; break;
+        case 'V': ncomponents = 3; break;
+        case 'Q': ncomponents = 4; break;
+      }
+      d_element_size = 0;
+      switch( d_format[1] )
+      {
+        case 'A': case 'B': d_element_size = 1; break;
+        case 'I': d_element_size = 2; break;
+        case 'L': case 'F': d_element_size = 4; break;
+        case 'X': case 'D': d_element_size = 8; break;
+      }
+      if( (ncomponents == 0) or (d_element_size == 0) )
+      {
+        this->close();
+        throw std::runtime_error( str( boost::format( "Unsupported bluefile format %s" ) % d_format ) );
+      }
+      if( d_itemsize % (ncomponents * d_element_size) )
+      {
+        this->close();
+        throw std::runtime_error( str( boost::format( "Bluefile format %s does not fit item size %d" ) %
+            d_format % d_itemsize ) );
+      }
+      d_swap = (data_be != host_big_endian()) and (d_element_size > 1);
 
-      // check for frequency tag
-      try
+      // data section, a file still being written may not hold its size
+      double data_start = header_value<double>( hcb, BLUE_DATA_START, head_be );
+      double data_size = header_value<double>( hcb, BLUE_DATA_SIZE, head_be );
+      d_data_offset = std::min( (uint64_t)std::max( data_start, 0.0 ), d_file_size );
+      d_data_end = d_file_size;
+      if( data_size > 0.0 )
       {
-        char frequency[50];
-        double freq = 0.0;
-        d_blue_reader->get_keyword( "RFFREQ", frequency, 50 );
-        try
-        {
-          freq = std::stod( frequency, NULL );
-          tag.key = FREQ_KEY;
-          tag.value = pmt::from_double( freq );
-          d_tags.push_back( tag );
-        }
-        catch ( ... )
+        d_data_end = std::min( d_data_offset + (uint64_t)data_size, d_file_size );
+      }
+      d_pos = d_data_offset;
+
+      // keywords from the main and extended headers
+      d_keywords.clear();
+      parse_keywords( hcb, head_be );
+      int32_t ext_start = header_value<int32_t>( hcb, BLUE_EXT_START, head_be );
+      int32_t ext_size = header_value<int32_t>( hcb, BLUE_EXT_SIZE, head_be );
+      if( (ext_start > 0) and (ext_size > 0) )
+      {
+        std::vector<char> ext( ext_size );
+        if( read_at( &ext[0], ext.size(), (uint64_t)ext_start * BLUE_BLOCK_SIZE ) == ext_size )
         {
+          parse_ext_keywords( ext, head_be );
         }
       }
-      catch ( ... )
+
+      // populate tags from the type 1000 adjunct header
+      double xstart = header_value<double>( hcb, BLUE_XSTART, head_be );
+      double xdelta = header_value<double>( hcb, BLUE_XDELTA, head_be );
+      epoch_time file_time( xstart );
+
+      gr::tag_t tag;
+      if( xdelta > 0.0 )
       {
+        tag.key = RATE_KEY;
+        tag.value = pmt::from_double( 1.0 / xdelta );
+        d_tags.push_back( tag );
       }
+      tag.key = RX_TIME_KEY;
+      tag.value = pmt::make_tuple( pmt::from_uint64( file_time.epoch_sec() ),
+          pmt::from_double( file_time.epoch_frac() ) );
+      d_tags.push_back( tag );
 
-      // ensure beginning of file
-      d_blue_reader->seek( 0, bluefile::BlueFile::SET );
+      double freq;
+      if( keyword( "RFFREQ", freq ) )
+      {
+        tag.key = FREQ_KEY;
+        tag.value = pmt::from_double( freq );
+        d_tags.push_back( tag );
+      }
 
-      // all done
-      d_is_open = true;
+      GR_LOG_DEBUG( d_logger, boost::format( "Bluefile %s: format %s, %d items" ) % filename %
+          d_format % nitems() );
     }
 
-    int file_reader_bluefile::read( char *dest, int nitems )
+    void file_reader_bluefile::parse_keywords( const char *hcb, bool big_endian )
     {
-      if( d_blue_reader->is_open() )
+      // NAME=VALUE entries separated by nulls
+      int32_t length = header_value<int32_t>( hcb, BLUE_KEYLENGTH, big_endian );
+      length = std::max( 0, std::min( length, (int32_t)BLUE_KEYWORDS_SIZE ) );
+      std::string keywords( hcb + BLUE_KEYWORDS, length );
+
+      size_t start = 0;
+      while( start < keywords.size() )
       {
-        // return d_blue_reader->read(dest,d_bpe,nitems);
-        return d_blue_reader->read( dest, d_bps, nitems );
+        size_t end = keywords.find( '\0', start );
+        if( end == std::string::npos )
+        {
+          end = keywords.size();
+        }
+        std::string entry = keywords.substr( start, end - start );
+        size_t eq = entry.find( '=' );
+        if( eq != std::string::npos )
+        {
+          try
+          {
+            d_keywords[entry.substr( 0, eq )] = std::stod( entry.substr( eq + 1 ) );
+          }
+          catch( ... )
+          {
+          }
+        }
+        start = end + 1;
       }
-
-      return 0;
     }
 
-    bool file_reader_bluefile::seek( long seek_point, int whence )
+    void file_reader_bluefile::parse_ext_keywords( const std::vector<char> &ext, bool big_endian )
     {
-      if( d_is_open and d_blue_reader->is_open() )
+      // records of lkey (int32), lext (int16), ltag (int8) and type (char),
+      // followed by the value, the tag and padding
+      size_t offset = 0;
+      while( offset + 8 <= ext.size() )
       {
-        GR_LOG_DEBUG( d_logger, boost::format("Seeking in bluefile reader: %ld, %d") % seek_point % whence );
-        d_blue_reader->seek( double( seek_point ), bluefile::BlueFile::BlueFileSeekEnum( whence ) );
+        const char *rec = &ext[offset];
+        int32_t lkey = header_value<int32_t>( rec, 0, big_endian );
+        int16_t lext = header_value<int16_t>( rec, 4, big_endian );
+        uint8_t ltag = (uint8_t)rec[6];
+        char type = rec[7];
+        if( (lkey < lext) or (lext < 8 + ltag) or (offset + lkey > ext.size()) )
+        {
+          break;
+        }
+
+        size_t ldata = lkey - lext;
+        const char *data = rec + 8;
+        std::string name( data + ldata, ltag );
+        try
+        {
+          double value;
+          bool valid = true;
+          if( (type == 'A') and ldata ) { value = std::stod( std::string( data, ldata ) ); }
+          else if( (type == 'D') and (ldata >= 8) ) { value = header_value<double>( data, 0, big_endian ); }
+          else if( (type == 'F') and (ldata >= 4) ) { value = header_value<float>( data, 0, big_endian ); }
+          else if( (type == 'X') and (ldata >= 8) ) { value = header_value<int64_t>( data, 0, big_endian ); }
+          else if( (type == 'L') and (ldata >= 4) ) { value = header_value<int32_t>( data, 0, big_endian ); }
+          else if( (type == 'I') and (ldata >= 2) ) { value = header_value<int16_t>( data, 0, big_endian ); }
+          else if( (type == 'B') and (ldata >= 1) ) { value = (int8_t)data[0]; }
+          else { valid = false; }
+
+          if( valid )
+          {
+            d_keywords[name] = value;
+          }
+        }
+        catch( ... )
+        {
+        }
+
+        offset += lkey;
       }
-      return true;
     }
 
-    void file_reader_bluefile::close()
+    bool file_reader_bluefile::keyword( const std::string &name, double &value )
     {
-      // protect against calling close before open
-      if( not d_is_open )
+      std::map<std::string, double>::const_iterator it = d_keywords.find( name );
+      if( it == d_keywords.end() )
       {
-        return;
+        return false;
       }
 
-      if( d_blue_reader->is_open() )
-      {
-        GR_LOG_DEBUG( d_logger, boost::format("File Reader: Closing file %s") % d_filename );
-        d_blue_reader->close();
-
-        // set flag
-        d_is_open = false;
-
-        // clean up
-        delete d_blue_reader;
-        d_blue_reader = NULL;
-      }
+      value = it->second;
+      return true;
     }
 
-    bool file_reader_bluefile::eof()
+    int file_reader_bluefile::read( char *dest, int nitems )
     {
-      if( not d_blue_reader->is_open() )
+      int nread = file_reader_base::read( dest, nitems );
+      if( d_swap and (nread > 0) )
       {
-        return true;
+        unsigned int nelements = nread * (d_itemsize / d_element_size);
+        switch( d_element_size )
+        {
+          case 2: volk_16u_byteswap( (uint16_t *)dest, nelements ); break;
+          case 4: volk_32u_byteswap( (uint32_t *)dest, nelements ); break;
+          case 8: volk_64u_byteswap( (uint64_t *)dest, nelements ); break;
+        }
       }
 
-      return (int( d_blue_reader->tell() ) == d_file_size);
+      return nread;
     }
 
   }
 // namespace sandia_utils
 }// namespace gr
-
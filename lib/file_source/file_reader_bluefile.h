@@ -12,50 +12,85 @@
 
 #include "file_reader_base.h"
 #include "../epoch_time.h"
+#include <map>
 
-#include "bluefile.hh"
+/*
+ * Bluefile header control block layout (byte offsets)
+ *
+ * Header values are in the byte order named by the head_rep field and
+ * samples in the order named by data_rep, "EEEI" for little endian and
+ * "IEEE" for big endian.  Type 1000 files hold xstart and xdelta in the
+ * adjunct header; files of other types are not read.
+ */
+#define BLUE_HEADER_SIZE 512
+#define BLUE_VERSION 0
+#define BLUE_HEAD_REP 4
+#define BLUE_DATA_REP 8
+#define BLUE_DETACHED 12
+#define BLUE_EXT_START 24
+#define BLUE_EXT_SIZE 28
+#define BLUE_DATA_START 32
+#define BLUE_DATA_SIZE 40
+#define BLUE_TYPE 48
+#define BLUE_FORMAT 52
+#define BLUE_KEYLENGTH 160
+#define BLUE_KEYWORDS 164
+#define BLUE_KEYWORDS_SIZE 92
+#define BLUE_XSTART 256
+#define BLUE_XDELTA 264
+
+// extended header offsets are in blocks of this size
+#define BLUE_BLOCK_SIZE 512
 
 namespace gr
 {
   namespace sandia_utils
   {
     /**
-     * Implements a File Reater for the bluefile format
+     * Implements a File Reader for the bluefile format
+     *
+     * The header is parsed once when the file is opened, after which the
+     * data section is read in large blocks like a raw file.  Samples in the
+     * byte order of another host are swapped as they are read.
      */
     class SANDIA_UTILS_API file_reader_bluefile : public file_reader_base
     {
       private:
-        bluefile::BlueFile *d_blue_reader;
-        std::string d_type;
-        int d_bpe;
-        int d_bps;
+        // format of the data, such as CI or SF
+        std::string d_format;
 
-      public:
-        // typedef boost::shared_ptr<file_reader_base> sptr;
+        // samples are swapped in units of the format's element size
+        bool d_swap;
+        size_t d_element_size;
+
+        // header keywords with numeric values
+        std::map<std::string, double> d_keywords;
+
+        void parse_keywords( const char *hcb, bool big_endian );
+        void parse_ext_keywords( const std::vector<char> &ext, bool big_endian );
 
+      public:
         /**
          * Consructor
          *
          * @param itemsize - per item size in bytes
          * @param logger - parent file source logger instance
          */
-        file_reader_bluefile( size_t itemsize, gr::logger_ptr logger ) : file_reader_base( itemsize, logger )
-        {
-        }
-        ~file_reader_bluefile()
-        {
-        }
+        file_reader_bluefile( size_t itemsize, gr::logger_ptr logger );
+        ~file_reader_bluefile();
 
         virtual void open( const char *filename );
 
         virtual int read( char *dest, int nitems );
 
-        virtual bool seek( long seek_point, int whence );
-
-        virtual void close();
-
-        virtual bool eof();
-
+        /**
+         * Numeric value of a header keyword
+         *
+         * @param name - keyword name
+         * @param value - keyword value
+         * @return bool - true if the file holds the keyword
+         */
+        bool keyword( const std::string &name, double &value );
     };
 
   } // namespace sandia_utils
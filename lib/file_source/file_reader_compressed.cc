@@ -0,0 +1,326 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "file_reader_compressed.h"
+#include "file_reader_raw_header.h"
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    file_reader_compressed::file_reader_compressed( size_t itemsize, gr::logger_ptr logger )
+      : file_reader_base( itemsize, logger ),
+        d_block_items( 0 ),
+        d_nitems( 0 ),
+        d_item( 0 ),
+        d_max_window( 0 ),
+        d_inflight( 0 )
+    {
+    }
+
+    file_reader_compressed::~file_reader_compressed()
+    {
+      if( d_is_open ) { close(); }
+    }
+
+    void file_reader_compressed::open( const char *filename )
+    {
+      file_reader_base::open( filename );
+
+      compressed_file_header_t hdr;
+      if( read_at( (char *)&hdr, sizeof(hdr), 0 ) != (int64_t)sizeof(hdr) )
+      {
+        throw std::runtime_error( "Unable to read header from file" );
+      }
+      if( memcmp( hdr.magic, COMPRESSED_FILE_MAGIC, sizeof(hdr.magic) ) != 0 )
+      {
+        throw std::runtime_error( "File is not a compressed capture" );
+      }
+      if( hdr.version != COMPRESSED_FORMAT_VERSION )
+      {
+        throw std::runtime_error( "Unsupported compressed capture version" );
+      }
+      if( (hdr.itemsize != d_itemsize) or (hdr.block_items == 0) )
+      {
+        throw std::runtime_error( "Compressed capture item size does not match" );
+      }
+
+      d_block_items = hdr.block_items;
+      d_data_offset = sizeof(hdr);
+      d_pos = d_data_offset;
+      d_item = 0;
+
+      // an unfinished file has no index
+      if( not load_index() )
+      {
+        scan_blocks();
+      }
+
+      file_reader_raw_header::metadata_tags( hdr.metadata, d_tags );
+
+      // worker threads are only started once needed
+      if( not d_pool )
+      {
+        d_pool = codec_pool::shared();
+        d_max_window = 2 * d_pool->get_nthreads();
+      }
+    } //end open
+
+    void file_reader_compressed::close()
+    {
+      clear_window();
+      file_reader_base::close();
+    }
+
+    bool file_reader_compressed::load_index()
+    {
+      compressed_trailer_t trailer;
+      if( d_file_size < sizeof(compressed_file_header_t) + sizeof(trailer) )
+      {
+        return false;
+      }
+      uint64_t trailer_offset = d_file_size - sizeof(trailer);
+      if( (read_at( (char *)&trailer, sizeof(trailer), trailer_offset ) != (int64_t)sizeof(trailer)) or
+          (memcmp( trailer.magic, COMPRESSED_TRAILER_MAGIC, sizeof(trailer.magic) ) != 0) )
+      {
+        return false;
+      }
+
+      // index must fill the space before the trailer and cover all items
+      uint64_t nblocks = (trailer.nitems + d_block_items - 1) / d_block_items;
+      if( (trailer.nblocks != nblocks) or (trailer.index_offset > trailer_offset) or
+          ((trailer_offset - trailer.index_offset) != nblocks * sizeof(uint64_t)) )
+      {
+        return false;
+      }
+
+      d_index.resize( nblocks );
+      if( nblocks and (read_at( (char *)&d_index[0], nblocks * sizeof(uint64_t), trailer.index_offset )
+                       != (int64_t)(nblocks * sizeof(uint64_t))) )
+      {
+        return false;
+      }
+      d_nitems = trailer.nitems;
+      return true;
+    }
+
+    void file_reader_compressed::scan_blocks()
+    {
+      d_index.clear();
+      d_nitems = 0;
+
+      // walk complete blocks, every block but the last must be full
+      uint64_t block_bytes = d_block_items * d_itemsize;
+      uint64_t offset = d_data_offset;
+      compressed_block_header_t hdr;
+      while( read_at( (char *)&hdr, sizeof(hdr), offset ) == (int64_t)sizeof(hdr) )
+      {
+        uint64_t end = offset + sizeof(hdr) + hdr.stored_size;
+        if( (end > d_file_size) or (hdr.nbytes == 0) or (hdr.nbytes > block_bytes) or
+            (hdr.nbytes % d_itemsize) or (hdr.codec > CODEC_ZSTD) or (hdr.packed_bits > 16) )
+        {
+          break;
+        }
+
+        d_index.push_back( offset );
+        d_nitems += hdr.nbytes / d_itemsize;
+        offset = end;
+        if( hdr.nbytes < block_bytes )
+        {
+          break;
+        }
+      }
+
+      GR_LOG_DEBUG(d_logger,boost::format("File Reader: no block index, found %d blocks") % d_index.size());
+    }
+
+    void file_reader_compressed::fill_window( uint64_t block )
+    {
+      // drop blocks before the current one, or all after a seek elsewhere
+      while( d_window.size() and (d_window.front()->index < block) )
+      {
+        d_window.pop_front();
+      }
+      if( d_window.size() and (d_window.front()->index != block) )
+      {
+        d_window.clear();
+      }
+
+      uint64_t next = d_window.size() ? (d_window.back()->index + 1) : block;
+      while( (d_window.size() < d_max_window) and (next < d_index.size()) )
+      {
+        block_sptr b( new block_t );
+        b->index = next++;
+        b->nbytes = 0;
+        b->done = false;
+        b->failed = false;
+        {
+          boost::unique_lock<boost::mutex> lock( d_mutex );
+          d_inflight++;
+        }
+        d_window.push_back( b );
+        d_pool->submit( boost::bind( &file_reader_compressed::decode, this, b ) );
+      }
+    }
+
+    void file_reader_compressed::clear_window()
+    {
+      // blocks dropped from the window may still be decoding
+      boost::unique_lock<boost::mutex> lock( d_mutex );
+      while( d_inflight )
+      {
+        d_cond.wait( lock );
+      }
+      d_window.clear();
+    }
+
+    void file_reader_compressed::decode( block_sptr block )
+    {
+      bool failed = false;
+      try {
+        compressed_block_header_t hdr;
+        uint64_t offset = d_index[block->index];
+        if( read_at( (char *)&hdr, sizeof(hdr), offset ) != (int64_t)sizeof(hdr) )
+        {
+          throw std::runtime_error( "unable to read block header" );
+        }
+        if( (hdr.nbytes > d_block_items * d_itemsize) or (hdr.nbytes % d_itemsize) )
+        {
+          throw std::runtime_error( "invalid block header" );
+        }
+
+        block->coded.resize( hdr.stored_size );
+        if( read_at( &block->coded[0], hdr.stored_size, offset + sizeof(hdr) ) != (int64_t)hdr.stored_size )
+        {
+          throw std::runtime_error( "unable to read block" );
+        }
+
+        block->data.resize( hdr.nbytes );
+        decode_block( hdr, &block->coded[0], &block->data[0], block->scratch );
+        block->nbytes = hdr.nbytes;
+      }
+      catch( std::exception &e )
+      {
+        GR_LOG_ERROR(d_logger,boost::format("File Reader: block %d of %s: %s") % block->index %
+            d_filename % e.what());
+        failed = true;
+      }
+
+      boost::unique_lock<boost::mutex> lock( d_mutex );
+      block->failed = failed;
+      block->done = true;
+      d_inflight--;
+      d_cond.notify_all();
+    }
+
+    int file_reader_compressed::read( char *dest, int nitems )
+    {
+      return copy_items( dest, d_itemsize, nitems, NULL );
+    }
+
+    int file_reader_compressed::read_converted( float *dest, int nitems, sample_converter &conv )
+    {
+      // converted straight out of the decoded blocks
+      size_t ncomponents = d_itemsize / conv.input_size();
+      return copy_items( (char *)dest, ncomponents * sizeof(float), nitems, &conv );
+    }
+
+    int file_reader_compressed::copy_items( char *dest, size_t dest_itemsize, int nitems,
+        sample_converter *conv )
+    {
+      if( not d_is_open ) { return 0; }
+
+      int nread = 0;
+      while( (nread < nitems) and (d_item < d_nitems) )
+      {
+        uint64_t block = d_item / d_block_items;
+        fill_window( block );
+
+        block_sptr b = d_window.front();
+        {
+          boost::unique_lock<boost::mutex> lock( d_mutex );
+          while( not b->done )
+          {
+            d_cond.wait( lock );
+          }
+        }
+
+        // nothing past a corrupt block can be trusted
+        uint64_t offset = d_item - block * d_block_items;
+        uint64_t navail = b->nbytes / d_itemsize;
+        if( b->failed or (offset >= navail) )
+        {
+          d_item = d_nitems;
+          break;
+        }
+
+        uint64_t n = std::min( navail - offset, (uint64_t)(nitems - nread) );
+        if( conv )
+        {
+          conv->convert( &b->data[offset * d_itemsize], (float *)(dest + nread * dest_itemsize),
+              n * (d_itemsize / conv->input_size()) );
+        }
+        else
+        {
+          memcpy( dest + nread * dest_itemsize, &b->data[offset * d_itemsize], n * d_itemsize );
+        }
+        nread += (int)n;
+        d_item += n;
+      }
+
+      return nread;
+    }
+
+    void file_reader_compressed::prefetch()
+    {
+      file_reader_base::prefetch();
+
+      // start decoding the first blocks
+      if( d_is_open and (d_item < d_nitems) )
+      {
+        fill_window( d_item / d_block_items );
+      }
+    }
+
+    bool file_reader_compressed::seek( int64_t seek_point, int whence )
+    {
+      if( not d_is_open ) { return false; }
+
+      int64_t base;
+      switch( whence )
+      {
+        case SEEK_SET: base = 0; break;
+        case SEEK_CUR: base = (int64_t)d_item; break;
+        case SEEK_END: base = (int64_t)d_nitems; break;
+        default: return false;
+      }
+
+      int64_t item = base + seek_point;
+      if( item < 0 )
+      {
+        return false;
+      }
+
+      // blocks are decoded from the new position on the next read
+      d_item = (uint64_t)item;
+      return true;
+    }
+
+  }
+// namespace sandia_utils
+}// namespace gr
@@ -0,0 +1,101 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_FILE_READER_COMPRESSED_H
+#define INCLUDED_SANDIA_UTILS_FILE_READER_COMPRESSED_H
+
+#include <deque>
+#include "file_reader_base.h"
+#include "../compressed_format.h"
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    /**
+     * Block compressed file reader
+     *
+     * Blocks following the current position are decoded ahead by a pool of
+     * worker threads.  Seeking uses the block index to locate the block
+     * holding the requested item.  A file without an index, such as one
+     * still being written, is read up to its last complete block.
+     */
+    class SANDIA_UTILS_API file_reader_compressed : public file_reader_base
+    {
+      private:
+        struct block_t {
+          uint64_t index;
+          std::vector<char> data;
+          std::vector<char> coded;
+          std::vector<char> scratch;
+          size_t nbytes;
+          bool done;
+          bool failed;
+        };
+        typedef boost::shared_ptr<block_t> block_sptr;
+
+        // block layout
+        uint64_t d_block_items;
+        uint64_t d_nitems;
+        std::vector<uint64_t> d_index;
+
+        // current position in items
+        uint64_t d_item;
+
+        // blocks being decoded, consecutive from the block holding the
+        // current position
+        std::deque<block_sptr> d_window;
+        size_t d_max_window;
+        size_t d_inflight;
+        boost::mutex d_mutex;
+        boost::condition_variable d_cond;
+        codec_pool::sptr d_pool;
+
+        bool load_index();
+        void scan_blocks();
+        void fill_window( uint64_t block );
+        void clear_window();
+        void decode( block_sptr block );
+        int copy_items( char *dest, size_t dest_itemsize, int nitems, sample_converter *conv );
+
+      public:
+        file_reader_compressed( size_t itemsize, gr::logger_ptr logger );
+        ~file_reader_compressed();
+
+        virtual void open( const char *filename );
+        virtual void close();
+        virtual int read( char *dest, int nitems );
+        virtual int read_converted( float *dest, int nitems, sample_converter &conv );
+        virtual void prefetch();
+        virtual bool seek( int64_t seek_point, int whence );
+
+        virtual uint64_t tell()
+        {
+          return d_item;
+        }
+
+        virtual bool eof()
+        {
+          return (d_item >= d_nitems);
+        }
+
+        /**
+         * Number of items in the file
+         */
+        virtual uint64_t nitems()
+        {
+          return d_nitems;
+        }
+
+    }; //end class file_reader_compressed
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_FILE_READER_COMPRESSED_H */
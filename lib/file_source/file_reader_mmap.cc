@@ -0,0 +1,159 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "file_reader_mmap.h"
+#include "file_reader_raw_header.h"
+#include <algorithm>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// amount of data requested ahead of the current position
+#define MMAP_READAHEAD_SIZE (16 * 1024 * 1024)
+
+namespace gr {
+  namespace sandia_utils {
+
+    file_reader_mmap::file_reader_mmap(size_t itemsize, bool header, gr::logger_ptr logger)
+      : file_reader_base(itemsize, logger),
+        d_header(header),
+        d_map(NULL),
+        d_advised(0)
+    {
+    }
+
+    file_reader_mmap::~file_reader_mmap()
+    {
+      // base destructor can not reach the overridden close
+      if (d_is_open) { this->close(); }
+    }
+
+    void
+    file_reader_mmap::open(const char *filename) {
+      if (d_is_open) { this->close(); }
+
+      // open and determine size
+      file_reader_base::open(filename);
+
+      // an empty file can not be mapped
+      d_map = NULL;
+      if (d_file_size) {
+        void *ptr = mmap(NULL, d_file_size, PROT_READ, MAP_SHARED, d_fd, 0);
+        if (ptr == MAP_FAILED) {
+          perror(filename);
+          this->close();
+          throw std::runtime_error("can't map file");
+        }
+        d_map = (char *)ptr;
+
+        // pages are used once in order
+        madvise(d_map, d_file_size, MADV_SEQUENTIAL);
+      }
+
+      // read metadata information and populate tags
+      d_data_offset = 0;
+      if (d_header) {
+        double metadata[3];
+        if (d_file_size < sizeof(metadata)) {
+          this->close();
+          throw std::runtime_error( "Unable to read metadata from file" );
+        }
+        memcpy(metadata, d_map, sizeof(metadata));
+        file_reader_raw_header::metadata_tags(metadata, d_tags);
+        d_data_offset = sizeof(metadata);
+        d_data_end = file_reader_raw_header::segment_tags(*this, d_file_size, d_itemsize, d_tags);
+      }
+
+      d_pos = d_data_offset;
+      d_advised = d_pos;
+      advise();
+    }
+
+    void
+    file_reader_mmap::close() {
+      if (d_map != NULL) {
+        munmap(d_map, d_file_size);
+        d_map = NULL;
+      }
+      file_reader_base::close();
+      d_file_size = 0;
+      d_data_end = 0;
+      d_pos = 0;
+    }
+
+    void
+    file_reader_mmap::advise()
+    {
+      // keep a full window requested ahead of the current position, which
+      // may have moved past the window
+      if ((d_advised >= d_data_end) or
+          ((d_advised > d_pos) and (d_advised - d_pos > MMAP_READAHEAD_SIZE / 2))) {
+        return;
+      }
+
+      long page_size = sysconf(_SC_PAGESIZE);
+      uint64_t page = (page_size > 0) ? (uint64_t)page_size : 4096;
+      uint64_t start = std::max(d_advised, d_pos);
+      start -= (start % page);
+      uint64_t length = std::min((uint64_t)MMAP_READAHEAD_SIZE, d_data_end - start);
+      madvise(d_map + start, length, MADV_WILLNEED);
+      d_advised = start + length;
+    }
+
+    bool
+    file_reader_mmap::seek(int64_t seek_point, int whence)
+    {
+      // samples end before the end of the mapping
+      if (not file_reader_base::seek(seek_point, whence)) { return false; }
+      if (d_pos > d_data_end) { d_pos = d_data_end; }
+
+      // restart readahead from the new position
+      d_advised = d_pos;
+      advise();
+      return true;
+    }
+
+    int
+    file_reader_mmap::read(char *dest, int nitems)
+    {
+      if ((not d_is_open) or eof()) { return 0; }
+
+      uint64_t navail = (d_data_end - d_pos) / d_itemsize;
+      uint64_t n = std::min((uint64_t)nitems, navail);
+      if (n) {
+        memcpy(dest, d_map + d_pos, n * d_itemsize);
+        d_pos += n * d_itemsize;
+      }
+
+      advise();
+      return (int)n;
+    }
+
+    int
+    file_reader_mmap::read_converted(float *dest, int nitems, sample_converter &conv)
+    {
+      if ((not d_is_open) or eof()) { return 0; }
+
+      uint64_t navail = (d_data_end - d_pos) / d_itemsize;
+      uint64_t n = std::min((uint64_t)nitems, navail);
+      if (n) {
+        conv.convert(d_map + d_pos, dest, n * (d_itemsize / conv.input_size()));
+        d_pos += n * d_itemsize;
+      }
+
+      advise();
+      return (int)n;
+    }
+
+  } /* namespace sandia_utils */
+} /* namespace gr */
@@ -0,0 +1,102 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_FILE_READER_MMAP_H
+#define INCLUDED_SANDIA_UTILS_FILE_READER_MMAP_H
+
+#include "file_reader_base.h"
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    /**
+     * Memory mapped file reader.
+     *
+     * Maps the entire file and copies samples directly from the mapping,
+     * bypassing stdio buffering.  The kernel is advised of sequential access
+     * and a window ahead of the current position is requested in advance.
+     * Supports Raw IQ files, optionally preceded by the Raw IQ + Header
+     * metadata.  Seek positions are relative to the first sample.
+     */
+    class SANDIA_UTILS_API file_reader_mmap : public file_reader_base
+    {
+      private:
+        // file layout
+        bool d_header;
+
+        // mapping
+        char *d_map;
+
+        // end of requested readahead
+        uint64_t d_advised;
+
+        void advise();
+
+      public:
+        /**
+         * Consructor
+         *
+         * @param itemsize - per item size in bytes
+         * @param header - file starts with Raw IQ + Header metadata
+         * @param logger - parent file source logger instance
+         */
+        file_reader_mmap( size_t itemsize, bool header, gr::logger_ptr logger );
+
+        /**
+         * Deconstructor
+         */
+        ~file_reader_mmap();
+
+        /**
+         * Opens and maps a new file. Closes current file if open
+         *
+         * @param filename - filename of file to open
+         */
+        virtual void open( const char *filename );
+
+        /**
+         * Unmaps and closes the open file
+         */
+        virtual void close();
+
+        /**
+         * Copy items from the mapping
+         *
+         * @param dest - destination storage for sample
+         * @param nitems - number of items to ready
+         * @return int - number of items read. 0 on EOF or error
+         */
+        virtual int read( char *dest, int nitems );
+
+        /**
+         * Convert items directly from the mapping
+         *
+         * @param dest - destination storage for converted samples
+         * @param nitems - number of items to read
+         * @param conv - sample conversion
+         * @return int - number of items read. 0 on EOF or error
+         */
+        virtual int read_converted( float *dest, int nitems, sample_converter &conv );
+
+        /**
+         * Seek in the file source
+         *
+         * @param seek_point - item offset position to seek to, relative to
+         *                     the first sample for SEEK_SET
+         * @param whence - refrence point for seek, see fseek
+         * @return bool - true on success
+         */
+        virtual bool seek( int64_t seek_point, int whence );
+    }; //end class file_reader_mmap
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_FILE_READER_MMAP_H */
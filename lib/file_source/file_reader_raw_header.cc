@@ -9,6 +9,8 @@
 #include <sandia_utils/constants.h>
 
 #include "file_reader_raw_header.h"
+#include "../raw_header_format.h"
+#include <string.h>
 
 namespace gr
 {
@@ -28,29 +30,88 @@ namespace gr
       if( d_is_open )
       {
         double metadata[3];
-        if( fread( &metadata[0], sizeof(double), 3, d_fp ) != 3 )
+        if( read_at( (char *)&metadata[0], sizeof(metadata), 0 ) != (int64_t)sizeof(metadata) )
         {
           throw std::runtime_error( "Unable to read metadata from file" );
         }
 
-        // set timed
-        epoch_time file_time( metadata[2] );
-
-        gr::tag_t tag;
-        tag.key = FREQ_KEY;
-        tag.value = pmt::from_double( metadata[0] );
-        d_tags.push_back( tag );
-        tag.key = RATE_KEY;
-        tag.value = pmt::from_double( metadata[1] );
-        d_tags.push_back( tag );
-        tag.key = RX_TIME_KEY;
-        tag.value = pmt::make_tuple( pmt::from_uint64( file_time.epoch_sec() ),
-            pmt::from_double( file_time.epoch_frac() ) );
-        d_tags.push_back( tag );
+        // samples start after the header
+        d_data_offset = sizeof(metadata);
+        d_pos = d_data_offset;
+
+        metadata_tags( metadata, d_tags );
+        d_data_end = segment_tags( *this, d_file_size, d_itemsize, d_tags );
       }
 
     } //end open
 
+    void file_reader_raw_header::metadata_tags( const double *metadata, std::vector<gr::tag_t> &tags )
+    {
+      // set timed
+      epoch_time file_time( metadata[2] );
+
+      gr::tag_t tag;
+      tag.key = FREQ_KEY;
+      tag.value = pmt::from_double( metadata[0] );
+      tags.push_back( tag );
+      tag.key = RATE_KEY;
+      tag.value = pmt::from_double( metadata[1] );
+      tags.push_back( tag );
+      tag.key = RX_TIME_KEY;
+      tag.value = pmt::make_tuple( pmt::from_uint64( file_time.epoch_sec() ),
+          pmt::from_double( file_time.epoch_frac() ) );
+      tags.push_back( tag );
+    } //end metadata_tags
+
+    uint64_t file_reader_raw_header::segment_tags( file_reader_base &reader, uint64_t file_size, size_t itemsize,
+        std::vector<gr::tag_t> &tags )
+    {
+      const uint64_t header_size = 3 * sizeof(double);
+      raw_header_trailer_t trailer;
+      if( (file_size < header_size + sizeof(trailer)) or
+          (reader.read_at( (char *)&trailer, sizeof(trailer), file_size - sizeof(trailer) ) != (int64_t)sizeof(trailer)) or
+          (memcmp( trailer.magic, RAW_HEADER_TRAILER_MAGIC, sizeof(trailer.magic) ) != 0) or
+          (trailer.version != RAW_HEADER_FORMAT_VERSION) )
+      {
+        return file_size;
+      }
+
+      // index must exactly fill the space between samples and trailer
+      uint64_t index_end = file_size - sizeof(trailer);
+      if( (trailer.data_size > index_end - header_size) or
+          (trailer.nsegments > index_end / sizeof(raw_header_segment_t)) or
+          ((index_end - header_size - trailer.data_size) != trailer.nsegments * sizeof(raw_header_segment_t)) )
+      {
+        return file_size;
+      }
+
+      std::vector<raw_header_segment_t> segments( trailer.nsegments );
+      uint64_t index_size = segments.size() * sizeof(raw_header_segment_t);
+      if( segments.size() and
+          (reader.read_at( (char *)&segments[0], index_size, header_size + trailer.data_size ) != (int64_t)index_size) )
+      {
+        return file_size;
+      }
+
+      uint64_t nitems = trailer.data_size / itemsize;
+      for( size_t i = 1; i < segments.size(); i++ )
+      {
+        if( segments[i].sample >= nitems )
+        {
+          break;
+        }
+
+        size_t first = tags.size();
+        metadata_tags( segments[i].metadata, tags );
+        for( size_t t = first; t < tags.size(); t++ )
+        {
+          tags[t].offset = segments[i].sample;
+        }
+      }
+
+      return header_size + trailer.data_size;
+    } //end segment_tags
+
   }
 // namespace sandia_utils
 }// namespace gr
@@ -33,6 +33,30 @@ namespace gr
 
         virtual void open( const char *filename );
 
+        /**
+         * Convert header metadata to stream tags
+         *
+         * @param metadata - frequency, rate and start time from header
+         * @param tags - vector tags are appended to
+         */
+        static void metadata_tags( const double *metadata, std::vector<gr::tag_t> &tags );
+
+        /**
+         * Convert the segment index of a version 2 file to stream tags
+         *
+         * Tags for every segment after the first are appended, with offsets
+         * relative to the first sample.  Nothing is appended for a version 1
+         * file.
+         *
+         * @param reader - reader the file is open in
+         * @param file_size - size of the file in bytes
+         * @param itemsize - size of each item in bytes
+         * @param tags - vector tags are appended to
+         * @return uint64_t - end of samples in bytes
+         */
+        static uint64_t segment_tags( file_reader_base &reader, uint64_t file_size, size_t itemsize,
+            std::vector<gr::tag_t> &tags );
+
     }; //end class file_reader_raw_header
 
   } // namespace sandia_utils
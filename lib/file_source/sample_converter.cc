@@ -0,0 +1,101 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sample_converter.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+#include <boost/format.hpp>
+#include <volk/volk.h>
+
+// components byte swapped at a time, small enough to stay in cache
+#define SWAP_BLOCK_SIZE 8192
+
+namespace gr {
+  namespace sandia_utils {
+
+    sample_converter::sample_converter(const std::string &input_type, float scale, bool swap)
+      : d_scale(scale),
+        d_swap(swap)
+    {
+      if (input_type == "sc16") {
+        d_input = SC16;
+      } else if (input_type == "sc8") {
+        d_input = SC8;
+      } else if (input_type == "fc32") {
+        d_input = FC32;
+      } else {
+        throw std::runtime_error(str(boost::format("Invalid conversion input type %s") % input_type));
+      }
+
+      if (d_scale == 0.0) {
+        throw std::runtime_error("Conversion scale must be non-zero");
+      }
+
+      if (d_swap) {
+        d_swapped.resize(SWAP_BLOCK_SIZE * input_size());
+      }
+    }
+
+    sample_converter::~sample_converter()
+    {
+    }
+
+    size_t
+    sample_converter::input_size() const
+    {
+      switch (d_input) {
+        case SC16: return sizeof(int16_t);
+        case SC8: return sizeof(int8_t);
+        default: return sizeof(float);
+      }
+    }
+
+    void
+    sample_converter::convert(const char *in, float *out, size_t ncomponents)
+    {
+      while (ncomponents) {
+        // swap a block into the scratch buffer, otherwise convert in place
+        size_t n = ncomponents;
+        const char *src = in;
+        if (d_swap and (d_input != SC8)) {
+          n = std::min(n, (size_t)SWAP_BLOCK_SIZE);
+          memcpy(&d_swapped[0], in, n * input_size());
+          if (d_input == SC16) {
+            volk_16u_byteswap((uint16_t *)&d_swapped[0], n);
+          } else {
+            volk_32u_byteswap((uint32_t *)&d_swapped[0], n);
+          }
+          src = &d_swapped[0];
+        }
+
+        switch (d_input) {
+          case SC16:
+            volk_16i_s32f_convert_32f(out, (const int16_t *)src, d_scale, n);
+            break;
+          case SC8:
+            volk_8i_s32f_convert_32f(out, (const int8_t *)src, d_scale, n);
+            break;
+          default:
+            volk_32f_s32f_multiply_32f(out, (const float *)src, 1.0f / d_scale, n);
+            break;
+        }
+
+        in += n * input_size();
+        out += n;
+        ncomponents -= n;
+      }
+    }
+
+  } /* namespace sandia_utils */
+} /* namespace gr */
@@ -0,0 +1,70 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_SAMPLE_CONVERTER_H
+#define INCLUDED_SANDIA_UTILS_SAMPLE_CONVERTER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <sandia_utils/api.h>
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    /**
+     * Converts file samples to float as they are read.
+     *
+     * Each component of the file (sc16 or sc8 integers, or fc32 floats) is
+     * converted to a float and divided by the scale, optionally swapping the
+     * byte order of the file first.  Complex samples are converted component
+     * by component.
+     */
+    class SANDIA_UTILS_API sample_converter
+    {
+      private:
+        enum input_t { SC16, SC8, FC32 };
+        input_t d_input;
+        float d_scale;
+        bool d_swap;
+
+        // byte swapped components
+        std::vector<char> d_swapped;
+
+      public:
+        /**
+         * Constructor
+         *
+         * @param input_type - file sample type, sc16, sc8 or fc32
+         * @param scale - file values are divided by the scale
+         * @param swap - swap the byte order of file values
+         */
+        sample_converter( const std::string &input_type, float scale, bool swap );
+        ~sample_converter();
+
+        /**
+         * Bytes per component in the file
+         */
+        size_t input_size() const;
+
+        /**
+         * Convert components
+         *
+         * @param in - file components
+         * @param out - float components
+         * @param ncomponents - number of components
+         */
+        void convert( const char *in, float *out, size_t ncomponents );
+    }; // end class sample_converter
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_SAMPLE_CONVERTER_H */
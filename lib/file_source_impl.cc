@@ -14,7 +14,8 @@
 #include "file_source_impl.h"
 #include <gnuradio/io_signature.h>
 #include <boost/filesystem.hpp>
-#include <fstream>
+#include <algorithm>
+#include <cmath>
 
 namespace gr {
 namespace sandia_utils {
@@ -32,7 +33,8 @@ namespace sandia_utils {
  *
  * \param itemsize  the size of each item in the file, in bytes
  * \param filename  name of the file to source from
- * \param type file type, Example Values = message, raw, raw_header, bluefile
+ * \param type file type, Example Values = message, raw, raw_header, raw_mmap,
+ * raw_header_mmap, bluefile
  * \param repeat  repeat file from start
  * \param force_new Force open new file upon command, regardless of current status
  */
@@ -62,14 +64,28 @@ file_source_impl::file_source_impl(
       d_itemsize(itemsize),
       d_repeat(repeat),
       d_force_new(force_new),
-      d_tag_on_open(false),
       d_repeat_cnt(0),
-      d_add_begin_tag(pmt::PMT_NIL),
-      d_tag_now(false),
       d_first_pass(true),
+      d_add_begin_tag(pmt::PMT_NIL),
+      d_file_ended(false),
+      d_files_expected(filename[0] == '\0'),
+      d_file_itemsize(itemsize),
       d_file_queue_depth(DEFAULT_FILE_QUEUE_DEPTH),
+      d_prefetch_depth(0),
+      d_prefetch_finished(true),
+      d_tag_now(false),
+      d_tag_position(false),
+      d_realtime(false),
+      d_realtime_rate(0.0),
+      d_pace_rate(0.0),
+      d_pace_started(false),
+      d_pace_item(0),
+      d_pace_has_time(false),
+      d_tag_on_open(false),
       d_method_count(0),
-      d_msg_hop_period(0)
+      d_msg_hop_period(0),
+      d_msg_recorded_timing(false),
+      d_msg_reset(false)
 {
     d_output_type = std::string(type);
     d_filename = std::string(filename);
@@ -78,23 +94,10 @@ file_source_impl::file_source_impl(
     if (strcmp(type, "message") == 0) {
         // register output port
         message_port_register_out(OUT_KEY);
+        d_msg_log =
+            boost::shared_ptr<message_log_reader>(new message_log_reader(d_logger));
     } else {
-        if (strcmp(type, "raw") == 0) {
-            d_reader = file_reader_base::sptr(new file_reader_base(itemsize, d_logger));
-        } else if (strcmp(type, "raw_header") == 0) {
-            d_reader =
-                file_reader_base::sptr(new file_reader_raw_header(itemsize, d_logger));
-        }
-#ifdef HAVE_BLUEFILE_LIB
-        else if (strcmp(type, "bluefile") == 0) {
-            d_reader =
-                file_reader_base::sptr(new file_reader_bluefile(itemsize, d_logger));
-        }
-#endif
-        else {
-            throw std::runtime_error(
-                str(boost::format("Invalid file source format %s") % type));
-        }
+        d_reader = make_reader();
 
         // empty list of tags for now
         d_tags.resize(0);
@@ -107,11 +110,31 @@ file_source_impl::file_source_impl(
     }
 
     // register message ports
-    message_port_register_in(pmt::intern("pdu"));
-    set_msg_handler(pmt::intern("pdu"),
+    message_port_register_in(d_pdu_port);
+    set_msg_handler(d_pdu_port,
                     boost::bind(&file_source_impl::handle_msg, this, _1));
 }
 
+file_reader_base::sptr file_source_impl::make_reader()
+{
+    const char* type = d_output_type.c_str();
+    if (strcmp(type, "raw") == 0) {
+        return file_reader_base::sptr(new file_reader_base(d_file_itemsize, d_logger));
+    } else if (strcmp(type, "raw_header") == 0) {
+        return file_reader_base::sptr(new file_reader_raw_header(d_file_itemsize, d_logger));
+    } else if (strcmp(type, "raw_mmap") == 0) {
+        return file_reader_base::sptr(new file_reader_mmap(d_file_itemsize, false, d_logger));
+    } else if (strcmp(type, "raw_header_mmap") == 0) {
+        return file_reader_base::sptr(new file_reader_mmap(d_file_itemsize, true, d_logger));
+    } else if (strcmp(type, "compressed") == 0) {
+        return file_reader_base::sptr(new file_reader_compressed(d_file_itemsize, d_logger));
+    } else if (strcmp(type, "bluefile") == 0) {
+        return file_reader_base::sptr(new file_reader_bluefile(d_file_itemsize, d_logger));
+    }
+
+    throw std::runtime_error(str(boost::format("Invalid file source format %s") % type));
+}
+
 /*
  * Our virtual destructor.
  */
@@ -128,6 +151,11 @@ bool file_source_impl::start()
         d_finished = false;
         d_thread = boost::shared_ptr<gr::thread::thread>(
             new gr::thread::thread(boost::bind(&file_source_impl::run, this)));
+    } else {
+        // start file prefetch thread
+        d_prefetch_finished = false;
+        d_prefetch_thread = boost::shared_ptr<gr::thread::thread>(
+            new gr::thread::thread(boost::bind(&file_source_impl::prefetch_run, this)));
     }
 
     return block::start();
@@ -140,6 +168,14 @@ bool file_source_impl::stop()
         d_finished = true;
         d_thread->interrupt();
         d_thread->join();
+    } else if (d_prefetch_thread) {
+        {
+            gr::thread::scoped_lock lock(fp_mutex);
+            d_prefetch_finished = true;
+            d_prefetch_cond.notify_all();
+        }
+        d_prefetch_thread->join();
+        d_prefetch_thread.reset();
     }
 
     return block::stop();
@@ -147,81 +183,335 @@ bool file_source_impl::stop()
 
 void file_source_impl::run()
 {
-    // open file
-    std::string current_file = d_filename;
-    std::ifstream file;
-    GR_LOG_DEBUG(d_logger, str(boost::format("Opening message file: %s") % current_file));
-    file.open(current_file, std::ios::in | std::ios::binary);
-    if (not file.is_open()) {
-        throw std::runtime_error(
-            str(boost::format("Unable to open file %s") % current_file));
+    // open file, either message log format is detected
+    {
+        gr::thread::scoped_lock lock(d_msg_mutex);
+        d_msg_log->open(d_filename);
+        d_msg_reset = true;
     }
 
+    // system and recorded time of the message timing is paced from
+    boost::posix_time::ptime base_time;
+    uint64_t base_msg_time = 0;
+
     while (!d_finished) {
-        boost::this_thread::sleep(
-            boost::posix_time::milliseconds(static_cast<long>(d_msg_hop_period)));
-        if (d_finished) {
-            // close file
-            file.close();
+        pmt::pmt_t msg;
+        uint64_t msg_time;
+        bool reset;
+        bool recorded;
+        {
+            gr::thread::scoped_lock lock(d_msg_mutex);
+            bool ok = d_msg_log->next(msg, msg_time);
+
+            // check whether to start again, unless nothing could be read
+            if ((not ok) and d_repeat and (d_msg_log->tell() > 0)) {
+                d_msg_log->seek(0);
+                d_msg_reset = true;
+                ok = d_msg_log->next(msg, msg_time);
+            }
+            if (not ok) {
+                break;
+            }
 
-            return;
+            reset = d_msg_reset;
+            d_msg_reset = false;
+            recorded = d_msg_recorded_timing and d_msg_log->has_timestamps();
         }
 
-        // read in message length
-        uint32_t len;
-        file.read((char*)&len, sizeof(uint32_t));
-        if (file.fail()) {
-            GR_LOG_ERROR(d_logger, str(boost::format("Unable to read message length")));
+        if (recorded) {
+            // first message after opening, repeating or seeking is emitted now
+            if (reset or (msg_time < base_msg_time)) {
+                base_time = boost::posix_time::microsec_clock::universal_time();
+                base_msg_time = msg_time;
+            } else {
+                boost::this_thread::sleep(
+                    base_time + boost::posix_time::microseconds(
+                                    static_cast<long>((msg_time - base_msg_time) / 1000)));
+            }
+        } else if (d_msg_hop_period > 0) {
+            boost::this_thread::sleep(
+                boost::posix_time::milliseconds(static_cast<long>(d_msg_hop_period)));
+        }
+        if (d_finished) {
             break;
         }
-        GR_LOG_DEBUG(d_logger, str(boost::format("Message length: %u") % len));
 
-        // read in message
-        if (len != 0) {
-            std::string st((size_t)len, 0);
-            file.read((char*)st.c_str(), len);
-            if (file.fail()) {
-                GR_LOG_ERROR(d_logger, str(boost::format("Unable to read message")));
-                break;
-            }
+        message_port_pub(OUT_KEY, msg);
+    } // end while (!d_finished)
 
-            // deserialize str
-            pmt::pmt_t msg;
-            try {
-                msg = pmt::deserialize_str(st);
-            } catch (...) {
-                GR_LOG_ERROR(d_logger,
-                             str(boost::format("Unable to deserialize message")));
-                break;
-            }
-            message_port_pub(OUT_KEY, msg);
-
-            // check if end of file and whether to reopen
-            if (file.peek() == EOF) {
-                if (d_repeat) {
-                    file.seekg(0, file.beg);
-                } else {
-                    break;
-                }
-            }
-        } // end len != 0;
-    }     // end while (!d_finished)
+    // close file
+    gr::thread::scoped_lock lock(d_msg_mutex);
+    d_msg_log->close();
 } // end run()
 
 // set message hop period
 void file_source_impl::set_msg_hop_period(int period_ms)
 {
     gr::thread::scoped_lock lock(fp_mutex);
-    if (period_ms > 0) {
+    if (period_ms >= 0) {
         d_msg_hop_period = period_ms;
     }
 }
 
-bool file_source_impl::seek(long seek_point, int whence)
+void file_source_impl::set_realtime(bool realtime, double rate)
+{
+    gr::thread::scoped_lock lock(d_setlock);
+    d_realtime = realtime;
+    d_realtime_rate = (rate > 0.0) ? rate : 0.0;
+
+    // restart the schedule, the rate of the file is known again at the next
+    // rate tag
+    d_pace_rate = d_realtime_rate;
+    d_pace_started = false;
+    d_pace_has_time = false;
+}
+
+void file_source_impl::set_conversion(const std::string& input_type,
+                                      double scale,
+                                      bool byte_swap)
+{
+    gr::thread::scoped_lock lock(d_setlock);
+    if (d_output_type == "message") {
+        return;
+    }
+
+    boost::shared_ptr<sample_converter> converter;
+    size_t file_itemsize = d_itemsize;
+    if ((not input_type.empty()) and (input_type != "none")) {
+        if (d_itemsize % sizeof(float)) {
+            throw std::runtime_error(
+                str(boost::format("Item size %d can not hold converted samples") %
+                    d_itemsize));
+        }
+        converter.reset(new sample_converter(input_type, scale, byte_swap));
+        file_itemsize = d_itemsize / sizeof(float) * converter->input_size();
+    }
+    d_converter = converter;
+
+    // files already opened with the previous item size are reopened
+    std::deque<prefetch_entry_sptr> entries;
+    {
+        gr::thread::scoped_lock fp_lock(fp_mutex);
+        if (file_itemsize == d_file_itemsize) {
+            return;
+        }
+        d_file_itemsize = file_itemsize;
+        entries = d_prefetch_queue;
+    }
+
+    if (d_reader->is_open()) {
+        std::string fname = d_reader->filename();
+        GR_LOG_DEBUG(d_logger,
+                     boost::format("Reopening %s for %s samples") % fname % input_type);
+        d_reader = make_reader();
+        d_reader->open(fname.c_str());
+
+        // the reopened file starts over and its metadata is tagged again
+        d_tags.clear();
+        d_tag_now = true;
+    } else {
+        d_reader = make_reader();
+    }
+
+    gr::thread::scoped_lock fp_lock(fp_mutex);
+    for (auto entry : entries) {
+        while (not entry->done) {
+            d_prefetch_cond.wait(fp_lock);
+        }
+        if (entry->reader) {
+            file_reader_base::sptr reader = make_reader();
+            reader->open(entry->fname.c_str());
+            entry->reader = reader;
+        }
+    }
+}
+
+int file_source_impl::pace_items(gr::thread::scoped_lock& lock,
+                                 uint64_t item,
+                                 int noutput_items,
+                                 bool wait)
+{
+    // nothing to pace by without a rate
+    if (d_pace_rate <= 0.0) {
+        return noutput_items;
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (not d_pace_started) {
+        d_pace_started = true;
+        d_pace_clock = now;
+        d_pace_item = item;
+    }
+
+    // wait for a full quantum rather than releasing samples one at a time
+    int64_t quantum = std::max(
+        (int64_t)1, (int64_t)std::llround(d_pace_rate * PACE_QUANTUM_US * 1e-6));
+    quantum = std::min(quantum, (int64_t)noutput_items);
+    std::chrono::steady_clock::time_point release =
+        d_pace_clock + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                           std::chrono::duration<double>(
+                               (item + quantum - 1 - d_pace_item) / d_pace_rate));
+    if (now < release) {
+        if (not wait) {
+            return 0;
+        }
+
+        // bounded so messages and stop requests are not held off
+        int64_t wait_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(release - now).count();
+        wait_us = std::min(wait_us, (int64_t)IDLE_WAIT_PERIOD_MS * 1000);
+        d_file_cond.timed_wait(lock, boost::posix_time::microseconds(wait_us));
+        now = std::chrono::steady_clock::now();
+        if (now < release) {
+            return 0;
+        }
+    }
+
+    // samples whose release time has passed
+    double elapsed = std::chrono::duration<double>(now - d_pace_clock).count();
+    int64_t due = (int64_t)(d_pace_item - item) +
+                  (int64_t)std::floor(elapsed * d_pace_rate) + 1;
+    return (int)std::max((int64_t)0, std::min(due, (int64_t)noutput_items));
+}
+
+void file_source_impl::pace_rebase(uint64_t item)
+{
+    if (item <= d_pace_item) {
+        return;
+    }
+
+    d_pace_clock += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>((item - d_pace_item) / d_pace_rate));
+    if (d_pace_has_time) {
+        d_pace_time.advance(item - d_pace_item);
+    }
+    d_pace_item = item;
+}
+
+void file_source_impl::add_metadata_tag(uint64_t offset,
+                                        const pmt::pmt_t& key,
+                                        const pmt::pmt_t& value,
+                                        bool continuous)
+{
+    add_item_tag(0, offset, key, value);
+    if (not d_realtime) {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if ((not d_pace_started) or (d_pace_rate <= 0.0)) {
+        d_pace_started = true;
+        d_pace_clock = now;
+        d_pace_item = offset;
+    } else {
+        pace_rebase(offset);
+    }
+
+    // a new file or position starts no earlier than now
+    if ((not continuous) and (d_pace_clock < now)) {
+        d_pace_clock = now;
+    }
+
+    if (pmt::eq(key, RATE_KEY)) {
+        double rate = pmt::to_double(value);
+        d_pace_rate = (rate > 0.0) ? rate : d_realtime_rate;
+        d_pace_time.set_rate(d_pace_rate);
+    } else if (pmt::eq(key, RX_TIME_KEY)) {
+        uint64_t sec = pmt::to_uint64(pmt::tuple_ref(value, 0));
+        double frac = pmt::to_double(pmt::tuple_ref(value, 1));
+        if (continuous and d_pace_has_time) {
+            // replay the gap between segments
+            double gap = (double)((int64_t)sec - (int64_t)d_pace_time.epoch_sec()) +
+                         (frac - d_pace_time.epoch_frac());
+            if (gap > 0.0) {
+                d_pace_clock +=
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(gap));
+            }
+        }
+        d_pace_time.set(sec, frac);
+        d_pace_has_time = true;
+    }
+}
+
+bool file_source_impl::seek(int64_t seek_point, int whence)
 {
+    if (d_output_type == "message") {
+        return seek_msg(seek_point, whence);
+    }
+
+    gr::thread::scoped_lock lock(d_setlock);
+    if (not d_reader) {
+        return false;
+    }
+
     return d_reader->seek(seek_point, whence);
 }
 
+bool file_source_impl::seek_msg(int64_t seek_point, int whence)
+{
+    gr::thread::scoped_lock lock(d_msg_mutex);
+    if (not d_msg_log->is_open()) {
+        return false;
+    }
+
+    // the end of the log is only known from its index
+    int64_t base;
+    switch (whence) {
+    case SEEK_SET:
+        base = 0;
+        break;
+    case SEEK_CUR:
+        base = (int64_t)d_msg_log->tell();
+        break;
+    case SEEK_END:
+        if (d_msg_log->nmessages() == 0) {
+            return false;
+        }
+        base = (int64_t)d_msg_log->nmessages();
+        break;
+    default:
+        return false;
+    }
+    if (base + seek_point < 0) {
+        return false;
+    }
+
+    d_msg_reset = true;
+    return d_msg_log->seek((uint64_t)(base + seek_point));
+}
+
+bool file_source_impl::seek_time(double time)
+{
+    gr::thread::scoped_lock lock(d_setlock);
+    if ((not d_reader) or (not d_reader->is_open())) {
+        return false;
+    }
+
+    if (not d_reader->seek_time(epoch_time(time))) {
+        return false;
+    }
+
+    // metadata at the new position is tagged on the next sample
+    d_tag_position = true;
+    return true;
+}
+
+uint64_t file_source_impl::tell()
+{
+    if (d_output_type == "message") {
+        gr::thread::scoped_lock lock(d_msg_mutex);
+        return d_msg_log->tell();
+    }
+
+    gr::thread::scoped_lock lock(d_setlock);
+    if (not d_reader) {
+        return 0;
+    }
+
+    return d_reader->tell();
+}
+
 
 void file_source_impl::open(const char* filename, bool repeat)
 {
@@ -236,17 +526,19 @@ void file_source_impl::open(const char* filename, bool repeat)
         GR_LOG_DEBUG(d_logger, "Forcing file close and new file open");
         d_reader->close();
         d_reader->open(filename);
+        d_tags.clear();
         d_tag_now = true;
+        d_file_ended = false;
     } else {
-        if (d_file_queue.size() >= d_file_queue_depth) {
-            // modifynig queue so protect
-            gr::thread::scoped_lock lock(fp_mutex);
-
+        // modifying queue so protect
+        gr::thread::scoped_lock queue_lock(fp_mutex);
+        if (d_file_queue.size() + d_prefetch_queue.size() >= d_file_queue_depth) {
             // clear queue
             GR_LOG_DEBUG(d_logger, "Maximum number of file entries reached...resetting");
             while (d_file_queue.size()) {
                 d_file_queue.pop();
             }
+            d_prefetch_queue.clear();
 
             // add new file and tag
             d_file_queue.push(std::make_pair(std::string(filename), true));
@@ -256,27 +548,110 @@ void file_source_impl::open(const char* filename, bool repeat)
             d_file_queue.push(std::make_pair(std::string(filename), add_tags));
             d_first_pass = false;
         }
+        d_prefetch_cond.notify_all();
     }
 
     // attempt to open next files
     open_next();
+
+    // wake work if it is waiting for a file.  d_setlock is still held, so
+    // the notification can not fall between work finding no file open and
+    // starting to wait
+    d_file_cond.notify_all();
 }
 
 void file_source_impl::open_next()
 {
-    if ((not d_reader->is_open()) and (d_file_queue.size())) {
-        // obtain exclusive access for duration of this scope
-        gr::thread::scoped_lock lock(fp_mutex);
+    if (d_reader->is_open()) {
+        return;
+    }
+
+    // obtain exclusive access for duration of this scope
+    gr::thread::scoped_lock lock(fp_mutex);
 
+    // files opened ahead of time are played first to preserve order
+    while (d_prefetch_queue.size()) {
+        prefetch_entry_sptr entry = d_prefetch_queue.front();
+        while (not entry->done) {
+            d_prefetch_cond.wait(lock);
+        }
+
+        // queue may have been reset while waiting
+        if ((d_prefetch_queue.empty()) or (d_prefetch_queue.front() != entry)) {
+            continue;
+        }
+        d_prefetch_queue.pop_front();
+        d_prefetch_cond.notify_all();
+
+        if (entry->reader) {
+            d_reader = entry->reader;
+            d_tags.clear();
+            d_tag_now = entry->tag;
+            d_file_ended = false;
+            return;
+        }
+    }
+
+    if (d_file_queue.size()) {
         std::pair<std::string, bool> value = d_file_queue.front();
         d_reader->open(value.first.c_str());
+        d_tags.clear();
         d_tag_now = value.second;
+        d_file_ended = false;
 
         // remove file
         d_file_queue.pop();
     }
 }
 
+void file_source_impl::set_prefetch_depth(int depth)
+{
+    gr::thread::scoped_lock lock(fp_mutex);
+    d_prefetch_depth = (depth > 0) ? (size_t)depth : 0;
+    d_prefetch_cond.notify_all();
+}
+
+void file_source_impl::prefetch_run()
+{
+    gr::thread::scoped_lock lock(fp_mutex);
+    while (true) {
+        while ((not d_prefetch_finished) and
+               ((d_file_queue.empty()) or (d_prefetch_queue.size() >= d_prefetch_depth))) {
+            d_prefetch_cond.wait(lock);
+        }
+        if (d_prefetch_finished) {
+            break;
+        }
+
+        // take next file from queue
+        prefetch_entry_sptr entry(new prefetch_entry_t);
+        entry->fname = d_file_queue.front().first;
+        entry->tag = d_file_queue.front().second;
+        entry->done = false;
+        d_file_queue.pop();
+        d_prefetch_queue.push_back(entry);
+        lock.unlock();
+
+        // open and warm file outside of lock
+        file_reader_base::sptr reader;
+        try {
+            reader = make_reader();
+            reader->open(entry->fname.c_str());
+            reader->prefetch();
+        } catch (std::exception& e) {
+            GR_LOG_ERROR(d_logger,
+                         boost::format("Unable to open file %s: %s") % entry->fname %
+                             e.what());
+            reader.reset();
+        }
+
+        lock.lock();
+        entry->reader = reader;
+        entry->done = true;
+        d_prefetch_cond.notify_all();
+    }
+}
+
 void file_source_impl::close()
 {
     if (d_reader->is_open()) {
@@ -304,6 +679,12 @@ void file_source_impl::handle_msg(pmt::pmt_t pdu)
         return;
     }
 
+    // more files may follow this one
+    {
+        gr::thread::scoped_lock lock(d_setlock);
+        d_files_expected = true;
+    }
+
     // we have a dictionary or a pair of which one element is a dict
     pmt::pmt_t fname_pmt;
     fname_pmt = pmt::dict_ref(pdu, FNAME_KEY, pmt::PMT_NIL);
@@ -345,25 +726,47 @@ int file_source_impl::work(int noutput_items,
 
     int size = noutput_items;
     int nread = 0;
+    bool paced = false;
     char* out = (char*)output_items[0];
     // std::cout << "noutput_items = " << noutput_items << std::endl;
 
     d_method_count--;
 
     if (not d_reader->is_open()) {
-        // no file ready to be produced...sleep for a bit to avoid
-        // consuming all resources
-        usleep(1);
-        return 0;
+        // done once the last file has been played, unless more can arrive
+        if (d_file_ended and (not d_files_expected)) {
+            return -1;
+        }
+
+        // no file ready to be produced...wait for one to be queued rather
+        // than spinning.  messages are dispatched between calls to work, so
+        // do not wait if one is pending and bound the wait so a message that
+        // arrives later is not delayed for long
+        if (empty_p(d_pdu_port)) {
+            d_file_cond.timed_wait(lock,
+                                   boost::posix_time::milliseconds(IDLE_WAIT_PERIOD_MS));
+        }
+        open_next();
+        if (not d_reader->is_open()) {
+            return 0;
+        }
     }
 
     while (size) {
         // add stream tags if necessary
         if (d_tag_now) {
+            // a new file is paced at its own rate
+            d_pace_rate = d_realtime_rate;
+            d_pace_has_time = false;
+
+            // after a seek to a time, the metadata at the new position is
+            // tagged instead of that of the first sample
             d_tags = d_reader->get_tags();
             for (auto tag : d_tags) {
-                add_item_tag(
-                    0, nitems_written(0) + noutput_items - size, tag.key, tag.value);
+                if ((tag.offset == 0) and (not d_tag_position)) {
+                    add_metadata_tag(
+                        nitems_written(0) + noutput_items - size, tag.key, tag.value, false);
+                }
             }
 
             // add repeat tag if specified
@@ -378,8 +781,48 @@ int file_source_impl::work(int noutput_items,
             d_tag_now = false;
         }
 
-        // read data
-        nread = d_reader->read(out, size);
+        // metadata in effect after a seek to a time
+        if (d_tag_position) {
+            std::vector<gr::tag_t> tags;
+            d_reader->position_tags(d_reader->tell(), tags);
+            for (const auto& tag : tags) {
+                add_metadata_tag(
+                    nitems_written(0) + noutput_items - size, tag.key, tag.value, false);
+            }
+            d_tag_position = false;
+        }
+
+        // in realtime playback only samples that are due are read, waiting
+        // only if none have been produced yet
+        int count = size;
+        if (d_realtime) {
+            count = pace_items(lock,
+                               nitems_written(0) + noutput_items - size,
+                               size,
+                               size == noutput_items);
+            if (count == 0) {
+                paced = true;
+                break;
+            }
+        }
+
+        // read data, tags for metadata changes within the file are added
+        // as the samples they apply to are produced
+        uint64_t pos = d_reader->tell();
+        if (d_converter) {
+            nread = d_reader->read_converted((float*)out, count, *d_converter);
+        } else {
+            nread = d_reader->read(out, count);
+        }
+        for (const auto& tag : d_tags) {
+            if ((tag.offset > 0) and (tag.offset >= pos) and (tag.offset < pos + nread)) {
+                add_metadata_tag(nitems_written(0) + noutput_items - size +
+                                     (tag.offset - pos),
+                                 tag.key,
+                                 tag.value,
+                                 true);
+            }
+        }
 
         // update pointers
         size -= nread;
@@ -402,6 +845,12 @@ int file_source_impl::work(int noutput_items,
             if (d_reader->eof()) {
                 d_reader->close();
                 open_next();
+
+                // continue with the next file if one is ready
+                if (d_reader->is_open()) {
+                    continue;
+                }
+                d_file_ended = true;
             }
 
             // all done
@@ -409,11 +858,31 @@ int file_source_impl::work(int noutput_items,
         } else {
             d_reader->seek(0, SEEK_SET);
             d_repeat_cnt++;
+
+            // a file with metadata changes returns to its initial metadata
+            bool segments = false;
+            for (const auto& tag : d_tags) {
+                segments |= (tag.offset > 0);
+            }
+            for (const auto& tag : d_tags) {
+                if (segments and (tag.offset == 0)) {
+                    add_metadata_tag(nitems_written(0) + noutput_items - size,
+                                     tag.key,
+                                     tag.value,
+                                     false);
+                }
+            }
         }
     } /* end while(size) */
 
     if (size > 0) {
         if (size == noutput_items) {
+            // nothing due yet in realtime playback, or the last file ended
+            // and more may arrive
+            if (paced or (d_files_expected and (not d_reader->is_open()))) {
+                return 0;
+            }
+
             // didn't read anything so say we're done
             return -1;
         } else {
@@ -11,21 +11,30 @@
 #define INCLUDED_SANDIA_UTILS_FILE_SOURCE_IMPL_H
 
 #include "file_source/file_reader_base.h"
+#include "file_source/file_reader_bluefile.h"
+#include "file_source/file_reader_compressed.h"
+#include "file_source/file_reader_mmap.h"
 #include "file_source/file_reader_raw_header.h"
+#include "message_log.h"
 #include <gnuradio/tags.h>
 #include <sandia_utils/constants.h>
 #include <sandia_utils/file_source.h>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
+#include <chrono>
+#include <deque>
 #include <queue>
 #include <utility>
 
-// conditional libraries
-#ifdef HAVE_BLUEFILE_LIB
-#include "file_source/file_reader_bluefile.h"
-#endif
-
 #define DEFAULT_FILE_QUEUE_DEPTH 100
 
+// maximum time work waits for a new file before returning (ms)
+#define IDLE_WAIT_PERIOD_MS 10
+
+// samples are released in groups spanning at most this time in realtime
+// playback, bounding the release jitter (us)
+#define PACE_QUANTUM_US 1000
+
 namespace gr {
 namespace sandia_utils {
 
@@ -39,26 +48,79 @@ private:
     bool d_first_pass;
     pmt::pmt_t d_add_begin_tag;
 
+    // input message port, also checked for pending messages by work
+    pmt::pmt_t d_pdu_port = pmt::intern("pdu");
+
     boost::mutex fp_mutex;
 
+    // signalled when a file is queued while no file is being played
+    boost::condition_variable d_file_cond;
+
+    // the last file ended with no file queued after it.  the source only
+    // finishes then if no files are expected through pdu messages: it was
+    // made without a file, or has been sent one
+    bool d_file_ended;
+    bool d_files_expected;
+
     // reader object
     file_reader_base::sptr d_reader;
 
+    // conversion of file samples to the output type, and the size of a
+    // file item producing one output item
+    boost::shared_ptr<sample_converter> d_converter;
+    size_t d_file_itemsize;
+
     // file queue (filename, tag flag)
     std::queue<std::pair<std::string, bool>> d_file_queue;
     size_t d_file_queue_depth;
 
+    // files taken from the file queue and opened ahead of playback
+    struct prefetch_entry_t {
+        std::string fname;
+        bool tag;
+        bool done;
+        file_reader_base::sptr reader;
+    };
+    typedef boost::shared_ptr<prefetch_entry_t> prefetch_entry_sptr;
+    std::deque<prefetch_entry_sptr> d_prefetch_queue;
+    size_t d_prefetch_depth;
+    boost::condition_variable d_prefetch_cond;
+    boost::shared_ptr<gr::thread::thread> d_prefetch_thread;
+    bool d_prefetch_finished;
+
     // add output tags
     bool d_tag_now;
+    bool d_tag_position;
+
+    // realtime playback: samples are released on a monotonic clock schedule
+    // at the rate of the file, or the configured rate without one.  The
+    // schedule releases item d_pace_item, with file time d_pace_time, at
+    // d_pace_clock
+    bool d_realtime;
+    double d_realtime_rate;
+    double d_pace_rate;
+    bool d_pace_started;
+    std::chrono::steady_clock::time_point d_pace_clock;
+    uint64_t d_pace_item;
+    bool d_pace_has_time;
+    epoch_time d_pace_time;
     std::vector<gr::tag_t> d_tags;
     bool d_tag_on_open;
 
     // debug stuff
     int d_method_count;
 
-    // message hop period
+    // message hop period, 0 to emit as fast as possible
     int d_msg_hop_period;
 
+    // pace messages by their recorded times
+    bool d_msg_recorded_timing;
+
+    // message log reader, shared with seek() and tell()
+    boost::shared_ptr<message_log_reader> d_msg_log;
+    boost::mutex d_msg_mutex;
+    bool d_msg_reset;
+
     // output type
     std::string d_output_type;
 
@@ -76,7 +138,7 @@ public:
      * @param itemsize - per item size in bytes
      * @param filename - filename to open as source.
      * @param type - type of file input, Example Values = message, raw, raw_header,
-     * bluefile
+     * raw_mmap, raw_header_mmap, bluefile
      * @param repeat - repeat a single file over and over.
      * @param force_new - Force open new file upon command, regardless of current status
      */
@@ -98,11 +160,26 @@ public:
     /**
      * Seek in the file source
      *
-     * @param seek_point - offset position to seek to
+     * @param seek_point - sample offset position to seek to
      * @param whence - refrence point for seek, see fseek
-     * @return bool - 0 or false on success
+     * @return bool - true on success
+     */
+    bool seek(int64_t seek_point, int whence);
+
+    /**
+     * Current position in the file source
+     *
+     * @return uint64_t - sample offset from first sample
      */
-    bool seek(long seek_point, int whence);
+    uint64_t tell();
+
+    /**
+     * Seek to a time in the file source
+     *
+     * @param time - time in seconds since the epoch
+     * @return bool - true on success
+     */
+    bool seek_time(double time);
 
     /**
      * manages opening a file
@@ -131,10 +208,19 @@ public:
 
     void set_file_queue_depth(size_t depth) { d_file_queue_depth = depth; }
 
+    void set_prefetch_depth(int depth);
+    int get_prefetch_depth() { return (int)d_prefetch_depth; }
+
     void add_file_tags(bool tag) { d_tag_on_open = tag; }
 
     void set_msg_hop_period(int period_ms);
 
+    void set_realtime(bool realtime, double rate);
+    bool get_realtime() { return d_realtime; }
+
+    void set_conversion(const std::string& input_type, double scale, bool byte_swap);
+    void set_msg_recorded_timing(bool enable) { d_msg_recorded_timing = enable; }
+
 private:
     /**
      * Handles incoming PDUs to the PDU command port. Incoming PDUs
@@ -153,6 +239,54 @@ private:
 
     void open_next(); // get next file to be processed
 
+    /**
+     * Wait until samples are due in realtime playback
+     *
+     * @param lock - lock held by work, released while waiting
+     * @param item - absolute output item to be produced next
+     * @param noutput_items - number of items requested
+     * @param wait - wait a bounded time if none are due
+     * @return int - number of items due, 0 if none are due yet
+     */
+    int pace_items(gr::thread::scoped_lock& lock,
+                   uint64_t item,
+                   int noutput_items,
+                   bool wait);
+
+    /**
+     * Move the playback schedule reference to an item
+     */
+    void pace_rebase(uint64_t item);
+
+    /**
+     * Tag stream metadata, updating the playback schedule
+     *
+     * @param offset - absolute output item
+     * @param key - tag key
+     * @param value - tag value
+     * @param continuous - time discontinuities are replayed, otherwise a
+     *                     new time restarts the schedule at the item
+     */
+    void add_metadata_tag(uint64_t offset,
+                          const pmt::pmt_t& key,
+                          const pmt::pmt_t& value,
+                          bool continuous);
+
+    /**
+     * Seek to a message number in the message file
+     */
+    bool seek_msg(int64_t seek_point, int whence);
+
+    /**
+     * Create a reader for the configured file type
+     */
+    file_reader_base::sptr make_reader();
+
+    /**
+     * Thread function opening queued files ahead of playback
+     */
+    void prefetch_run();
+
     /**
      * Thread function for message source
      */
@@ -0,0 +1,521 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "message_log.h"
+
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <streambuf>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// batch and read buffer size
+#define MESSAGE_LOG_BUFFER_SIZE (1024 * 1024)
+
+// longest time a logged message is held before being written, in ns
+#define MESSAGE_LOG_MAX_HOLD 1000000000ULL
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    namespace
+    {
+      // appends serialized output to a byte vector
+      class vector_streambuf : public std::streambuf
+      {
+        private:
+          std::vector<char> &d_vec;
+
+        protected:
+          virtual int_type overflow( int_type c )
+          {
+            if( c != traits_type::eof() )
+            {
+              d_vec.push_back( (char)c );
+            }
+            return traits_type::not_eof( c );
+          }
+
+          virtual std::streamsize xsputn( const char *s, std::streamsize n )
+          {
+            d_vec.insert( d_vec.end(), s, s + n );
+            return n;
+          }
+
+        public:
+          vector_streambuf( std::vector<char> &vec ) : d_vec( vec ) {}
+      };
+
+      // reads serialized input in place
+      class memory_streambuf : public std::streambuf
+      {
+        public:
+          memory_streambuf( const char *data, size_t len )
+          {
+            char *p = const_cast<char *>( data );
+            setg( p, p, p + len );
+          }
+      };
+
+      uint64_t now_ns()
+      {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch() ).count();
+      }
+    }
+
+    message_log_writer::message_log_writer( bool indexed, bool timestamps, gr::logger_ptr logger )
+      : d_indexed( indexed ),
+        d_timestamps( indexed and timestamps ),
+        d_logger( logger ),
+        d_fd( -1 ),
+        d_offset( 0 ),
+        d_nmessages( 0 ),
+        d_batch_time( 0 ),
+        d_closing( false )
+    {
+      d_batch.reserve( MESSAGE_LOG_BUFFER_SIZE );
+    }
+
+    message_log_writer::~message_log_writer()
+    {
+      close();
+    }
+
+    void message_log_writer::open( const std::string &filename )
+    {
+      close();
+
+      boost::mutex::scoped_lock lock( d_mutex );
+      GR_LOG_DEBUG(d_logger,boost::format("Opening message file %s") % filename);
+      d_fd = ::open( filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+      if( d_fd < 0 )
+      {
+        perror( filename.c_str() );
+        throw std::runtime_error( "file_sink: can't open file" );
+      }
+
+      d_filename = filename;
+      d_offset = 0;
+      d_nmessages = 0;
+      d_index.clear();
+      d_batch.clear();
+
+      if( d_indexed )
+      {
+        message_log_header_t hdr;
+        memset( &hdr, 0, sizeof(hdr) );
+        memcpy( hdr.magic, MESSAGE_LOG_MAGIC, sizeof(hdr.magic) );
+        hdr.version = MESSAGE_LOG_VERSION;
+        hdr.flags = d_timestamps ? MESSAGE_LOG_TIMESTAMPS : 0;
+        d_batch.insert( d_batch.end(), (const char *)&hdr, (const char *)&hdr + sizeof(hdr) );
+        d_offset = sizeof(hdr);
+      }
+      d_batch_time = now_ns();
+
+      d_closing = false;
+      d_flush_thread = boost::shared_ptr<boost::thread>(
+          new boost::thread( boost::bind( &message_log_writer::flush_run, this ) ) );
+    }
+
+    void message_log_writer::close()
+    {
+      // stop the flush thread before the file is finished
+      {
+        boost::mutex::scoped_lock lock( d_mutex );
+        d_closing = true;
+        d_cond.notify_all();
+      }
+      if( d_flush_thread )
+      {
+        d_flush_thread->join();
+        d_flush_thread.reset();
+      }
+
+      boost::mutex::scoped_lock lock( d_mutex );
+      if( d_fd < 0 )
+      {
+        return;
+      }
+
+      GR_LOG_DEBUG(d_logger,boost::format("Closing message file %s") % d_filename);
+      flush_batch();
+
+      if( d_indexed )
+      {
+        message_log_trailer_t trailer;
+        memset( &trailer, 0, sizeof(trailer) );
+        trailer.index_offset = d_offset;
+        trailer.nentries = d_index.size();
+        trailer.nmessages = d_nmessages;
+        trailer.version = MESSAGE_LOG_VERSION;
+        memcpy( trailer.magic, MESSAGE_LOG_TRAILER_MAGIC, sizeof(trailer.magic) );
+        if( d_index.size() )
+        {
+          write_fd( (const char *)&d_index[0], d_index.size() * sizeof(message_log_index_t) );
+        }
+        write_fd( (const char *)&trailer, sizeof(trailer) );
+      }
+
+      ::close( d_fd );
+      d_fd = -1;
+    }
+
+    void message_log_writer::write( const pmt::pmt_t &msg )
+    {
+      boost::mutex::scoped_lock lock( d_mutex );
+      if( d_fd < 0 )
+      {
+        return;
+      }
+
+      // the flush thread times a batch from its first record
+      uint64_t now = now_ns();
+      if( d_batch.empty() )
+      {
+        d_batch_time = now;
+        d_cond.notify_all();
+      }
+
+      if( d_indexed and ((d_nmessages % MESSAGE_LOG_INDEX_INTERVAL) == 0) )
+      {
+        message_log_index_t entry = { d_nmessages, d_offset, d_timestamps ? now : 0 };
+        d_index.push_back( entry );
+      }
+
+      // serialize behind the record header, then fill in the length
+      size_t start = d_batch.size();
+      size_t hdr_len = sizeof(uint32_t) + (d_timestamps ? sizeof(uint64_t) : 0);
+      d_batch.resize( start + hdr_len );
+      vector_streambuf sb( d_batch );
+      if( not pmt::serialize( msg, sb ) )
+      {
+        GR_LOG_ERROR(d_logger,"Unable to serialize message");
+        d_batch.resize( start );
+        return;
+      }
+
+      uint32_t len = (uint32_t)(d_batch.size() - start - hdr_len);
+      memcpy( &d_batch[start], &len, sizeof(len) );
+      if( d_timestamps )
+      {
+        memcpy( &d_batch[start + sizeof(len)], &now, sizeof(now) );
+      }
+      d_offset += hdr_len + len;
+      d_nmessages++;
+
+      if( d_batch.size() >= MESSAGE_LOG_BUFFER_SIZE )
+      {
+        flush_batch();
+      }
+    }
+
+    void message_log_writer::flush()
+    {
+      boost::mutex::scoped_lock lock( d_mutex );
+      flush_batch();
+    }
+
+    void message_log_writer::flush_batch()
+    {
+      if( (d_fd >= 0) and d_batch.size() )
+      {
+        write_fd( &d_batch[0], d_batch.size() );
+      }
+      d_batch.clear();
+    }
+
+    void message_log_writer::flush_run()
+    {
+      boost::mutex::scoped_lock lock( d_mutex );
+      while( not d_closing )
+      {
+        if( d_batch.empty() )
+        {
+          d_cond.wait( lock );
+          continue;
+        }
+
+        // wait out the rest of the hold time of the current batch
+        uint64_t now = now_ns();
+        if( now - d_batch_time >= MESSAGE_LOG_MAX_HOLD )
+        {
+          flush_batch();
+        }
+        else
+        {
+          d_cond.wait_for( lock, boost::chrono::nanoseconds( d_batch_time + MESSAGE_LOG_MAX_HOLD - now ) );
+        }
+      }
+    }
+
+    void message_log_writer::write_fd( const char *buf, size_t nbytes )
+    {
+      while( nbytes )
+      {
+        ssize_t n = ::write( d_fd, buf, nbytes );
+        if( n < 0 )
+        {
+          if( errno == EINTR )
+          {
+            continue;
+          }
+          GR_LOG_ERROR(d_logger,boost::format("Unable to write to file %s: %s") % d_filename % strerror(errno));
+          return;
+        }
+        buf += n;
+        nbytes -= n;
+      }
+    }
+
+    message_log_reader::message_log_reader( gr::logger_ptr logger )
+      : d_logger( logger ),
+        d_fd( -1 ),
+        d_timestamps( false ),
+        d_data_offset( 0 ),
+        d_data_end( 0 ),
+        d_nmessages( 0 ),
+        d_pos( 0 ),
+        d_message( 0 ),
+        d_buf_offset( 0 ),
+        d_buf_len( 0 )
+    {
+    }
+
+    message_log_reader::~message_log_reader()
+    {
+      close();
+    }
+
+    void message_log_reader::open( const std::string &filename )
+    {
+      close();
+
+      GR_LOG_DEBUG(d_logger,boost::format("Opening message file: %s") % filename);
+      d_fd = ::open( filename.c_str(), O_RDONLY );
+      if( d_fd < 0 )
+      {
+        throw std::runtime_error( str(boost::format("Unable to open file %s") % filename) );
+      }
+
+      struct stat st;
+      if( fstat( d_fd, &st ) != 0 )
+      {
+        close();
+        throw std::runtime_error( str(boost::format("Unable to stat file %s") % filename) );
+      }
+      uint64_t file_size = (uint64_t)st.st_size;
+
+      d_timestamps = false;
+      d_data_offset = 0;
+      d_data_end = file_size;
+      d_nmessages = 0;
+      d_index.clear();
+      d_buf_len = 0;
+
+      // files without the header are in the original format
+      const message_log_header_t *hdr =
+        (const message_log_header_t *)fetch( 0, sizeof(message_log_header_t) );
+      if( hdr and (memcmp( hdr->magic, MESSAGE_LOG_MAGIC, sizeof(hdr->magic) ) == 0) )
+      {
+        if( hdr->version != MESSAGE_LOG_VERSION )
+        {
+          close();
+          throw std::runtime_error( "Unsupported message log version" );
+        }
+        d_timestamps = (hdr->flags & MESSAGE_LOG_TIMESTAMPS) != 0;
+        d_data_offset = sizeof(message_log_header_t);
+        load_index( file_size );
+      }
+
+      d_pos = d_data_offset;
+      d_message = 0;
+    }
+
+    void message_log_reader::close()
+    {
+      if( d_fd >= 0 )
+      {
+        ::close( d_fd );
+        d_fd = -1;
+      }
+      d_buf_len = 0;
+    }
+
+    void message_log_reader::load_index( uint64_t file_size )
+    {
+      message_log_trailer_t trailer;
+      if( file_size < d_data_offset + sizeof(trailer) )
+      {
+        return;
+      }
+      uint64_t trailer_offset = file_size - sizeof(trailer);
+      if( (pread( d_fd, &trailer, sizeof(trailer), trailer_offset ) != (ssize_t)sizeof(trailer)) or
+          (memcmp( trailer.magic, MESSAGE_LOG_TRAILER_MAGIC, sizeof(trailer.magic) ) != 0) )
+      {
+        return;
+      }
+
+      // index must fill the space before the trailer
+      if( (trailer.index_offset < d_data_offset) or (trailer.index_offset > trailer_offset) or
+          ((trailer_offset - trailer.index_offset) != trailer.nentries * sizeof(message_log_index_t)) )
+      {
+        return;
+      }
+
+      std::vector<message_log_index_t> index( trailer.nentries );
+      size_t nbytes = index.size() * sizeof(message_log_index_t);
+      if( nbytes and (pread( d_fd, &index[0], nbytes, trailer.index_offset ) != (ssize_t)nbytes) )
+      {
+        return;
+      }
+
+      d_index.swap( index );
+      d_nmessages = trailer.nmessages;
+      d_data_end = trailer.index_offset;
+    }
+
+    const char *message_log_reader::fetch( uint64_t offset, size_t nbytes )
+    {
+      if( (offset < d_buf_offset) or (offset + nbytes > d_buf_offset + d_buf_len) )
+      {
+        // refill from the requested offset
+        size_t len = std::max( nbytes, (size_t)MESSAGE_LOG_BUFFER_SIZE );
+        if( d_buf.size() < len )
+        {
+          d_buf.resize( len );
+        }
+        d_buf_offset = offset;
+        d_buf_len = 0;
+        while( d_buf_len < len )
+        {
+          ssize_t n = pread( d_fd, &d_buf[d_buf_len], len - d_buf_len, offset + d_buf_len );
+          if( n < 0 and errno == EINTR )
+          {
+            continue;
+          }
+          if( n <= 0 )
+          {
+            break;
+          }
+          d_buf_len += n;
+        }
+        if( d_buf_len < nbytes )
+        {
+          return NULL;
+        }
+      }
+      return &d_buf[offset - d_buf_offset];
+    }
+
+    bool message_log_reader::next_record( uint32_t &len, uint64_t &time, const char *&data )
+    {
+      size_t hdr_len = sizeof(uint32_t) + (d_timestamps ? sizeof(uint64_t) : 0);
+      if( (d_fd < 0) or (d_pos + hdr_len > d_data_end) )
+      {
+        return false;
+      }
+
+      const char *p = fetch( d_pos, hdr_len );
+      if( not p )
+      {
+        return false;
+      }
+      memcpy( &len, p, sizeof(len) );
+      time = 0;
+      if( d_timestamps )
+      {
+        memcpy( &time, p + sizeof(len), sizeof(time) );
+      }
+
+      // a record cut short by the end of the file is not read
+      if( d_pos + hdr_len + len > d_data_end )
+      {
+        return false;
+      }
+      p = fetch( d_pos, hdr_len + len );
+      if( not p )
+      {
+        return false;
+      }
+
+      data = p + hdr_len;
+      d_pos += hdr_len + len;
+      d_message++;
+      return true;
+    }
+
+    bool message_log_reader::next( pmt::pmt_t &msg, uint64_t &time )
+    {
+      uint32_t len;
+      const char *data;
+      while( next_record( len, time, data ) )
+      {
+        // empty records hold no message
+        if( len == 0 )
+        {
+          continue;
+        }
+
+        try {
+          memory_streambuf sb( data, len );
+          msg = pmt::deserialize( sb );
+        }
+        catch( ... ) {
+          GR_LOG_ERROR(d_logger,"Unable to deserialize message");
+          return false;
+        }
+        return true;
+      }
+      return false;
+    }
+
+    bool message_log_reader::seek( uint64_t message )
+    {
+      if( d_fd < 0 )
+      {
+        return false;
+      }
+
+      // start from the last indexed message at or before the target
+      d_pos = d_data_offset;
+      d_message = 0;
+      for( size_t i = 0; (i < d_index.size()) and (d_index[i].message <= message); i++ )
+      {
+        d_pos = d_index[i].offset;
+        d_message = d_index[i].message;
+      }
+
+      uint32_t len;
+      uint64_t time;
+      const char *data;
+      while( d_message < message )
+      {
+        if( not next_record( len, time, data ) )
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+  } /* namespace sandia_utils */
+} /* namespace gr */
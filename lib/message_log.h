@@ -0,0 +1,228 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_MESSAGE_LOG_H
+#define INCLUDED_SANDIA_UTILS_MESSAGE_LOG_H
+
+#include <stdint.h>           /* uint64_t */
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <gnuradio/logger.h>
+#include <pmt/pmt.h>
+#include <sandia_utils/api.h>
+
+/*
+ * Message log format
+ *
+ * The original message format is a sequence of records, each a uint32_t
+ * length followed by that many bytes of serialized PMT.  The indexed format
+ * starts with a file header; each record may also hold the time the message
+ * was logged, in ns since the epoch, between the length and the message.
+ * When the file is closed, an index entry for every
+ * MESSAGE_LOG_INDEX_INTERVAL messages and a trailer are appended.  A file
+ * that was never closed has no index and is read up to its last complete
+ * record.  All values are in host byte order.
+ */
+#define MESSAGE_LOG_MAGIC "SUMSGLOG"
+#define MESSAGE_LOG_TRAILER_MAGIC "SUMSGIDX"
+#define MESSAGE_LOG_VERSION 1
+#define MESSAGE_LOG_INDEX_INTERVAL 4096
+
+// header flags
+#define MESSAGE_LOG_TIMESTAMPS 0x1
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    struct message_log_header_t {
+      char magic[8];
+      uint32_t version;
+      uint32_t flags;
+    };
+
+    struct message_log_index_t {
+      // message number, file offset of its record and its time
+      uint64_t message;
+      uint64_t offset;
+      uint64_t time;
+    };
+
+    struct message_log_trailer_t {
+      uint64_t index_offset;
+      uint64_t nentries;
+      uint64_t nmessages;
+      uint32_t version;
+      uint32_t reserved;
+      char magic[8];
+    };
+
+    /**
+     * Message log writer
+     *
+     * Records are serialized directly into a batch buffer that is written
+     * when it fills or when the file is flushed or closed, so messages are
+     * not written one at a time.  While a file is open a flush thread also
+     * writes any batch that has been held for a second, so messages reach
+     * the file even when no more arrive.
+     */
+    class SANDIA_UTILS_API message_log_writer
+    {
+      private:
+        bool d_indexed;
+        bool d_timestamps;
+        gr::logger_ptr d_logger;
+
+        int d_fd;
+        std::string d_filename;
+        uint64_t d_offset;
+        uint64_t d_nmessages;
+        std::vector<message_log_index_t> d_index;
+
+        // batch of records not yet written
+        std::vector<char> d_batch;
+        uint64_t d_batch_time;
+
+        // writes batches held too long, the mutex protects the file and batch
+        boost::mutex d_mutex;
+        boost::condition_variable d_cond;
+        boost::shared_ptr<boost::thread> d_flush_thread;
+        bool d_closing;
+
+        void flush_batch();
+        void flush_run();
+        void write_fd( const char *buf, size_t nbytes );
+
+      public:
+        /**
+         * Constructor
+         *
+         * @param indexed - write the indexed format, otherwise the original
+         * @param timestamps - record the time each message is logged, only
+         *                     available in the indexed format
+         * @param logger - parent logger instance
+         */
+        message_log_writer( bool indexed, bool timestamps, gr::logger_ptr logger );
+        ~message_log_writer();
+
+        void open( const std::string &filename );
+        void close();
+        bool is_open()
+        {
+          boost::mutex::scoped_lock lock( d_mutex );
+          return (d_fd >= 0);
+        }
+
+        /**
+         * Log a message
+         */
+        void write( const pmt::pmt_t &msg );
+
+        /**
+         * Write all logged messages to the file
+         */
+        void flush();
+
+        uint64_t nmessages()
+        {
+          boost::mutex::scoped_lock lock( d_mutex );
+          return d_nmessages;
+        }
+    }; //end class message_log_writer
+
+    /**
+     * Message log reader
+     *
+     * Reads either format through a large buffer, deserializing each message
+     * in place.
+     */
+    class SANDIA_UTILS_API message_log_reader
+    {
+      private:
+        gr::logger_ptr d_logger;
+
+        int d_fd;
+        bool d_timestamps;
+        uint64_t d_data_offset;
+        uint64_t d_data_end;
+        uint64_t d_nmessages;
+        std::vector<message_log_index_t> d_index;
+
+        // current record and message number
+        uint64_t d_pos;
+        uint64_t d_message;
+
+        // buffered file contents
+        std::vector<char> d_buf;
+        uint64_t d_buf_offset;
+        size_t d_buf_len;
+
+        const char *fetch( uint64_t offset, size_t nbytes );
+        bool next_record( uint32_t &len, uint64_t &time, const char *&data );
+        void load_index( uint64_t file_size );
+
+      public:
+        message_log_reader( gr::logger_ptr logger );
+        ~message_log_reader();
+
+        void open( const std::string &filename );
+        void close();
+        bool is_open()
+        {
+          return (d_fd >= 0);
+        }
+
+        /**
+         * Read the next message
+         *
+         * @param msg - message read
+         * @param time - time the message was logged (ns since the epoch), 0
+         *               if not recorded
+         * @return bool - false at the end of the log or on error
+         */
+        bool next( pmt::pmt_t &msg, uint64_t &time );
+
+        /**
+         * Move to a message, using the index where available
+         *
+         * @param message - message number from the start of the log
+         * @return bool - true if the log holds that many messages
+         */
+        bool seek( uint64_t message );
+
+        /**
+         * Number of the next message to be read
+         */
+        uint64_t tell()
+        {
+          return d_message;
+        }
+
+        /**
+         * Number of messages, 0 if the log has no index
+         */
+        uint64_t nmessages()
+        {
+          return d_nmessages;
+        }
+
+        bool has_timestamps()
+        {
+          return d_timestamps;
+        }
+    }; //end class message_log_reader
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_MESSAGE_LOG_H */
@@ -5,6 +5,11 @@
  *
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
+#include "file_sink/crc32c.h"
+#include "file_sink/file_writer_base.h"
+#include "file_source/file_reader_bluefile.h"
+#include "file_source/file_reader_mmap.h"
+#include "message_log.h"
 #include "sandia_utils/constants.h"
 #include "sandia_utils/file_sink.h"
 #include "sandia_utils/file_source.h"
@@ -12,15 +17,23 @@
 #include <gnuradio/blocks/message_debug.h>
 #include <gnuradio/blocks/null_source.h>
 #include <gnuradio/blocks/throttle.h>
+#include <gnuradio/blocks/vector_sink.h>
 #include <gnuradio/blocks/vector_source.h>
 #include <gnuradio/buffer.h>
 #include <gnuradio/tags.h>
 #include <gnuradio/top_block.h>
 #include <pmt/pmt.h>
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/format.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 
 namespace gr {
@@ -162,6 +175,26 @@ BOOST_AUTO_TEST_CASE(t1)
 
     BOOST_REQUIRE_EQUAL(std::string("file_sink"), sink->name());
 
+    // raw direct I/O
+    sink = gr::sandia_utils::file_sink::make("complex",
+                                             sizeof(gr_complex),
+                                             "raw_direct",
+                                             gr::sandia_utils::MANUAL,
+                                             0,
+                                             1000,
+                                             "/tmp",
+                                             "test");
+
+    BOOST_REQUIRE_EQUAL(std::string("file_sink"), sink->name());
+
+#ifdef HAVE_LIBURING
+    // io_uring
+    sink = gr::sandia_utils::file_sink::make(
+        "complex", sizeof(gr_complex), "uring", gr::sandia_utils::MANUAL, 0, 1000, "/tmp", "test");
+
+    BOOST_REQUIRE_EQUAL(std::string("file_sink"), sink->name());
+#endif
+
 #ifdef HAVE_BLUEFILE_LIB
     // bluefile
     sink = gr::sandia_utils::file_sink::make(
@@ -582,8 +615,10 @@ BOOST_AUTO_TEST_CASE(t7)
     inbuf->add_item_tag(rx_time_tag);
 
     // add a second tag that will be on the first sample of the second
-    // work function call.  the curent file (t_01.fc32) should be closed and
-    // a second file opened
+    // work function call.  the curent file (t_00.fc32) should be closed and
+    // a second file opened.  the rate must differ, a tag repeating the
+    // current configuration does not start a new file
+    rx_time_tag.value = pmt::from_double(15.36e6);
     rx_time_tag.offset = 1000;
     inbuf->add_item_tag(rx_time_tag);
 
@@ -594,14 +629,15 @@ BOOST_AUTO_TEST_CASE(t7)
     BOOST_REQUIRE_EQUAL(noutput_items, 1000);
     reader->update_read_pointer(noutput_items);
 
-    // call work function again so second tag is consumed
+    // call work function again so second tag is consumed, the tag is
+    // handled in place so all items are consumed
     input_items[0] = reader->read_pointer();
     output_items[0] = NULL; // no output for block
     noutput_items = sink->work(1000, input_items, output_items);
-    BOOST_REQUIRE_EQUAL(noutput_items, 0);
+    BOOST_REQUIRE_EQUAL(noutput_items, 1000);
     reader->update_read_pointer(noutput_items);
 
-    // last work function call should have returned zero
+    // last work function call continues the second file
     input_items[0] = reader->read_pointer();
     output_items[0] = NULL; // no output for block
     noutput_items = sink->work(1000, input_items, output_items);
@@ -612,10 +648,1322 @@ BOOST_AUTO_TEST_CASE(t7)
     BOOST_REQUIRE_EQUAL(sink->stop(), true);
 
     // remove files
-    remove_file("/tmp/t_00.fc32"); // never actually written due to first stop call
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.fc32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_01.fc32"), true);
+}
+
+// test generation of multiple files using background I/O
+BOOST_AUTO_TEST_CASE(t8)
+{
+    // generate blocks
+    std::vector<gr_complex> data(4000);
+    gr::blocks::vector_source_c::sptr src(
+        gr::blocks::vector_source_c::make(data, false, 1));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("complex",
+                                          sizeof(gr_complex),
+                                          "raw",
+                                          gr::sandia_utils::MANUAL,
+                                          2000,
+                                          2000,
+                                          "/tmp",
+                                          "t_%02fd.fc32"));
+    gr::blocks::message_debug::sptr debug(gr::blocks::message_debug::make());
+    gr::block_sptr throttle(gr::blocks::throttle::make(sizeof(gr_complex), 32e3, true));
+
+    // use small buffers so the ring wraps several times
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+    sink->set_async(true, 4, 512 * sizeof(gr_complex), false);
+    sink->set_recording(true);
+    BOOST_REQUIRE_EQUAL(sink->get_async(), true);
+
+    gr::top_block_sptr tb(gr::make_top_block("t8"));
+    tb->connect(src, 0, throttle, 0);
+    tb->connect(throttle, 0, sink, 0);
+    tb->msg_connect(sink, "pdu", debug, "store");
+    tb->start();
+
+    // let it run for sometime
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(200));
+
+    // stop recording so all queued data is written
+    sink->set_recording(false);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+
+    // stop
+    tb->stop();
+    tb->wait();
+
+    // two full files should have been generated without dropping samples
+    BOOST_REQUIRE_EQUAL(debug->num_messages(), 2);
+    BOOST_REQUIRE_EQUAL(sink->get_ndropped(), uint64_t(0));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_00.fc32"),
+                        2000 * sizeof(gr_complex));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_01.fc32"),
+                        2000 * sizeof(gr_complex));
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.fc32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_01.fc32"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t9)
+{
+    // generate blocks
+    std::vector<gr_complex> data(5000);
+    gr::blocks::vector_source_c::sptr src(
+        gr::blocks::vector_source_c::make(data, false, 1));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("complex",
+                                          sizeof(gr_complex),
+                                          "raw",
+                                          gr::sandia_utils::MANUAL,
+                                          2000,
+                                          2000,
+                                          "/tmp",
+                                          "t_%02fd.fc32"));
+    gr::blocks::message_debug::sptr debug(gr::blocks::message_debug::make());
+
+    // open next file in advance
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+    sink->set_preopen(true);
+    sink->set_recording(true);
+    BOOST_REQUIRE_EQUAL(sink->get_preopen(), true);
+
+    gr::top_block_sptr tb(gr::make_top_block("t9"));
+    tb->connect(src, 0, sink, 0);
+    tb->msg_connect(sink, "pdu", debug, "store");
+    tb->run();
+
+    // all files should be complete
+    BOOST_REQUIRE_EQUAL(debug->num_messages(), 3);
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_00.fc32"),
+                        2000 * sizeof(gr_complex));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_01.fc32"),
+                        2000 * sizeof(gr_complex));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_02.fc32"),
+                        1000 * sizeof(gr_complex));
+
+    // file prepared for the next rollover must have been removed
+    BOOST_REQUIRE_EQUAL(boost::filesystem::exists("/tmp/t_03.fc32"), false);
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.fc32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_01.fc32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_02.fc32"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t10)
+{
+    // generate blocks
+    std::vector<gr_complex> data(5000);
+    gr::blocks::vector_source_c::sptr src(
+        gr::blocks::vector_source_c::make(data, false, 1));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("complex",
+                                          sizeof(gr_complex),
+                                          "raw_header",
+                                          gr::sandia_utils::MANUAL,
+                                          2000,
+                                          2000,
+                                          "/tmp",
+                                          "t_%02fd.fc32"));
+
+    // reserve full file size on open
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+    sink->set_preallocate(true);
+    sink->set_recording(true);
+    BOOST_REQUIRE_EQUAL(sink->get_preallocate(), true);
+
+    gr::top_block_sptr tb(gr::make_top_block("t10"));
+    tb->connect(src, 0, sink, 0);
+    tb->run();
+
+    // last file is closed early and must be truncated to the data written
+    size_t header = 3 * sizeof(double);
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_00.fc32"),
+                        header + 2000 * sizeof(gr_complex));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_01.fc32"),
+                        header + 2000 * sizeof(gr_complex));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_02.fc32"),
+                        header + 1000 * sizeof(gr_complex));
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.fc32"), true);
     BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_01.fc32"), true);
     BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_02.fc32"), true);
 }
 
+BOOST_AUTO_TEST_CASE(t11)
+{
+    // generate blocks
+    std::vector<gr_complex> data(5000);
+    gr::blocks::vector_source_c::sptr src0(
+        gr::blocks::vector_source_c::make(data, false, 1));
+    gr::blocks::vector_source_c::sptr src1(
+        gr::blocks::vector_source_c::make(data, false, 1));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("complex",
+                                          sizeof(gr_complex),
+                                          "raw",
+                                          gr::sandia_utils::MANUAL,
+                                          3000,
+                                          2000,
+                                          "/tmp",
+                                          "t_%ch_%02fd.fc32",
+                                          false,
+                                          2));
+
+    // both channels share a single I/O thread
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+    sink->set_io_threads(1);
+    sink->set_async(true, 4, 8192, false);
+    sink->set_recording(true);
+    BOOST_REQUIRE_EQUAL(sink->get_nchan(), 2);
+
+    gr::top_block_sptr tb(gr::make_top_block("t11"));
+    tb->connect(src0, 0, sink, 0);
+    tb->connect(src1, 0, sink, 1);
+    tb->run();
+
+    // each channel is written to its own set of files
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_0_00.fc32"),
+                        3000 * sizeof(gr_complex));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_0_01.fc32"),
+                        2000 * sizeof(gr_complex));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_1_00.fc32"),
+                        3000 * sizeof(gr_complex));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_1_01.fc32"),
+                        2000 * sizeof(gr_complex));
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_0_00.fc32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_0_01.fc32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_1_00.fc32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_1_01.fc32"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t12)
+{
+    // three bursts, the last two within the post trigger tail of each other
+    std::vector<gr::tag_t> tags;
+    tags.push_back(gen_tag(gr::sandia_utils::RX_TIME_KEY,
+                           pmt::make_tuple(pmt::from_uint64(1000), pmt::from_double(0)),
+                           0));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_START_KEY, pmt::PMT_T, 50));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_STOP_KEY, pmt::PMT_T, 60));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_START_KEY, pmt::PMT_T, 1000));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_STOP_KEY, pmt::PMT_T, 1999));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_START_KEY, pmt::PMT_T, 2500));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_STOP_KEY, pmt::PMT_T, 2600));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_START_KEY, pmt::PMT_T, 2620));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_STOP_KEY, pmt::PMT_T, 2700));
+
+    // generate blocks
+    std::vector<float> data(3000);
+    gr::blocks::vector_source_f::sptr src(
+        gr::blocks::vector_source_f::make(data, false, 1, tags));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("float",
+                                          sizeof(float),
+                                          "raw",
+                                          gr::sandia_utils::TRIGGERED,
+                                          0,
+                                          1000,
+                                          "/tmp",
+                                          "t_%02fd.f32"));
+    gr::blocks::message_debug::sptr debug(gr::blocks::message_debug::make());
+
+    sink->set_gen_new_folder(false);
+    sink->set_pretrigger(100);
+    sink->set_posttrigger(50);
+    sink->set_max_noutput_items(333);
+    BOOST_REQUIRE_EQUAL(sink->get_pretrigger(), 100);
+    BOOST_REQUIRE_EQUAL(sink->get_posttrigger(), 50);
+
+    gr::top_block_sptr tb(gr::make_top_block("t12"));
+    tb->connect(src, 0, sink, 0);
+    tb->msg_connect(sink, "pdu", debug, "store");
+    tb->run();
+
+    // first burst only has 50 samples before it
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_00.f32"),
+                        (50 + 11 + 50) * sizeof(float));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_01.f32"),
+                        (100 + 1000 + 50) * sizeof(float));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_02.f32"),
+                        (100 + 201 + 50) * sizeof(float));
+
+    // file time accounts for the pre trigger samples
+    BOOST_REQUIRE_EQUAL(debug->num_messages(), 3);
+    pmt::pmt_t time_tuple = pmt::dict_ref(
+        pmt::car(debug->get_message(1)), gr::sandia_utils::RX_TIME_KEY, pmt::PMT_NIL);
+    BOOST_REQUIRE_EQUAL(pmt::to_uint64(pmt::tuple_ref(time_tuple, 0)), 1000);
+    BOOST_REQUIRE_CLOSE(pmt::to_double(pmt::tuple_ref(time_tuple, 1)), 0.9, 1e-6);
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.f32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_01.f32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_02.f32"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t13)
+{
+    // overlapping bursts identified by id
+    std::vector<gr::tag_t> tags;
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_START_KEY, pmt::from_long(1), 100));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_START_KEY, pmt::from_long(2), 150));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_START_KEY, pmt::from_long(3), 200));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_STOP_KEY, pmt::from_long(3), 249));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_STOP_KEY, pmt::from_long(1), 299));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_STOP_KEY, pmt::from_long(2), 399));
+
+    // generate blocks
+    std::vector<float> data(1000);
+    gr::blocks::vector_source_f::sptr src(
+        gr::blocks::vector_source_f::make(data, false, 1, tags));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("float",
+                                          sizeof(float),
+                                          "raw",
+                                          gr::sandia_utils::TRIGGERED,
+                                          0,
+                                          1000,
+                                          "/tmp",
+                                          "t_%02fd.f32"));
+    gr::blocks::message_debug::sptr debug(gr::blocks::message_debug::make());
+
+    sink->set_gen_new_folder(false);
+    sink->set_max_bursts(3);
+    BOOST_REQUIRE_EQUAL(sink->get_max_bursts(), 3);
+
+    gr::top_block_sptr tb(gr::make_top_block("t13"));
+    tb->connect(src, 0, sink, 0);
+    tb->msg_connect(sink, "pdu", debug, "store");
+    tb->run();
+
+    // each burst is written to its own file, numbered in order of start
+    BOOST_REQUIRE_EQUAL(debug->num_messages(), 3);
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_00.f32"),
+                        200 * sizeof(float));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_01.f32"),
+                        250 * sizeof(float));
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_02.f32"),
+                        50 * sizeof(float));
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.f32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_01.f32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_02.f32"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t14)
+{
+    // frequency change and burst recorded in a single sigmf file
+    std::vector<gr::tag_t> tags;
+    tags.push_back(gen_tag(gr::sandia_utils::RATE_KEY, pmt::from_double(1000), 0));
+    tags.push_back(gen_tag(gr::sandia_utils::RX_TIME_KEY,
+                           pmt::make_tuple(pmt::from_uint64(1000), pmt::from_double(0.0)),
+                           0));
+    tags.push_back(gen_tag(gr::sandia_utils::FREQ_KEY, pmt::from_double(1e6), 0));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_START_KEY, pmt::PMT_T, 100));
+    tags.push_back(gen_tag(gr::sandia_utils::BURST_STOP_KEY, pmt::PMT_T, 199));
+    tags.push_back(gen_tag(gr::sandia_utils::FREQ_KEY, pmt::from_double(2e6), 500));
+
+    // generate blocks
+    std::vector<float> data(1000);
+    gr::blocks::vector_source_f::sptr src(
+        gr::blocks::vector_source_f::make(data, false, 1, tags));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("float",
+                                          sizeof(float),
+                                          "sigmf",
+                                          gr::sandia_utils::MANUAL,
+                                          0,
+                                          1000,
+                                          "/tmp",
+                                          "t_%02fd.sigmf-data"));
+    sink->set_recording(true);
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+
+    gr::top_block_sptr tb(gr::make_top_block("t14"));
+    tb->connect(src, 0, sink, 0);
+    tb->run();
+
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size("/tmp/t_00.sigmf-data"),
+                        1000 * sizeof(float));
+
+    std::ifstream meta_file("/tmp/t_00.sigmf-meta");
+    std::stringstream meta;
+    meta << meta_file.rdbuf();
+    BOOST_REQUIRE(meta.str().find("\"core:datatype\": \"rf32_le\"") != std::string::npos);
+    BOOST_REQUIRE(meta.str().find("\"core:sample_rate\": 1000") != std::string::npos);
+    BOOST_REQUIRE(meta.str().find("{\"core:sample_start\": 0, \"core:frequency\": 1000000, "
+                                  "\"core:datetime\": \"1970-01-01T00:16:40.000000000Z\"}") !=
+                  std::string::npos);
+    BOOST_REQUIRE(meta.str().find("{\"core:sample_start\": 500, \"core:frequency\": 2000000, "
+                                  "\"core:datetime\": \"1970-01-01T00:16:40.500000000Z\"}") !=
+                  std::string::npos);
+    BOOST_REQUIRE(meta.str().find("{\"core:sample_start\": 100, \"core:sample_count\": 100}") !=
+                  std::string::npos);
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.sigmf-data"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.sigmf-meta"), true);
+
+    // data files must have the sigmf extension
+    gr::logger_ptr logger, debug_logger;
+    gr::configure_default_loggers(logger, debug_logger, "t14");
+    BOOST_REQUIRE_THROW(gr::sandia_utils::file_writer_base::make(
+                            "float", "sigmf", sizeof(float), 0, 1000, "/tmp", "t_%02fd.f32", logger),
+                        std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(t15)
+{
+    // interleaved 16 bit samples through a compressed file and back, small
+    // samples are bit-packed and the rest stored at full width
+    std::vector<short> data(2 * 300000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (i < 400000) ? (short)((i % 37) - 18) : (short)(i * 7919);
+    }
+
+    gr::blocks::vector_source_s::sptr src(gr::blocks::vector_source_s::make(data, false, 2));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("complex_int",
+                                          2 * sizeof(short),
+                                          "compressed",
+                                          gr::sandia_utils::MANUAL,
+                                          0,
+                                          1000,
+                                          "/tmp",
+                                          "t_%02fd.sc16"));
+    sink->set_recording(true);
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+
+    gr::top_block_sptr tb(gr::make_top_block("t15"));
+    tb->connect(src, 0, sink, 0);
+    tb->run();
+    BOOST_REQUIRE(boost::filesystem::file_size("/tmp/t_00.sc16") <
+                  data.size() * sizeof(short));
+
+    gr::sandia_utils::file_source::sptr source(gr::sandia_utils::file_source::make(
+        2 * sizeof(short), "/tmp/t_00.sc16", "compressed", false, false));
+    gr::blocks::vector_sink_s::sptr dst(gr::blocks::vector_sink_s::make(2));
+
+    gr::top_block_sptr tb2(gr::make_top_block("t15_read"));
+    tb2->connect(source, 0, dst, 0);
+    tb2->run();
+    BOOST_REQUIRE(dst->data() == data);
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.sc16"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t16)
+{
+    // frequency and rate changes recorded as segments of a single file and
+    // tagged again on playback
+    std::vector<gr::tag_t> tags;
+    tags.push_back(gen_tag(gr::sandia_utils::RATE_KEY, pmt::from_double(1000), 0));
+    tags.push_back(gen_tag(gr::sandia_utils::RX_TIME_KEY,
+                           pmt::make_tuple(pmt::from_uint64(1000), pmt::from_double(0.0)),
+                           0));
+    tags.push_back(gen_tag(gr::sandia_utils::FREQ_KEY, pmt::from_double(1e6), 0));
+    tags.push_back(gen_tag(gr::sandia_utils::FREQ_KEY, pmt::from_double(2e6), 400));
+    tags.push_back(gen_tag(gr::sandia_utils::RATE_KEY, pmt::from_double(2000), 700));
+
+    std::vector<float> data(1000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i;
+    }
+    gr::blocks::vector_source_f::sptr src(
+        gr::blocks::vector_source_f::make(data, false, 1, tags));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("float",
+                                          sizeof(float),
+                                          "raw_header_v2",
+                                          gr::sandia_utils::MANUAL,
+                                          0,
+                                          1000,
+                                          "/tmp",
+                                          "t_%02fd.f32"));
+    sink->set_recording(true);
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+
+    gr::top_block_sptr tb(gr::make_top_block("t16"));
+    tb->connect(src, 0, sink, 0);
+    tb->run();
+    BOOST_REQUIRE_EQUAL(boost::filesystem::exists("/tmp/t_01.f32"), false);
+
+    gr::sandia_utils::file_source::sptr source(gr::sandia_utils::file_source::make(
+        sizeof(float), "/tmp/t_00.f32", "raw_header", false, false));
+    gr::blocks::vector_sink_f::sptr dst(gr::blocks::vector_sink_f::make());
+
+    // the source finishes once the file has been played
+    gr::top_block_sptr tb2(gr::make_top_block("t16_read"));
+    tb2->connect(source, 0, dst, 0);
+    tb2->run();
+    BOOST_REQUIRE(dst->data() == data);
+
+    // metadata of each segment on its first sample
+    std::vector<gr::tag_t> out_tags = dst->tags();
+    double freq_400 = 0, rate_700 = 0;
+    for (size_t i = 0; i < out_tags.size(); i++) {
+        if ((out_tags[i].offset == 400) and
+            pmt::eq(out_tags[i].key, gr::sandia_utils::FREQ_KEY)) {
+            freq_400 = pmt::to_double(out_tags[i].value);
+        }
+        if ((out_tags[i].offset == 700) and
+            pmt::eq(out_tags[i].key, gr::sandia_utils::RATE_KEY)) {
+            rate_700 = pmt::to_double(out_tags[i].value);
+        }
+    }
+    BOOST_REQUIRE_EQUAL(freq_400, 2e6);
+    BOOST_REQUIRE_EQUAL(rate_700, 2000);
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.f32"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t17)
+{
+    // message log written and replayed as fast as possible
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("message",
+                                          0,
+                                          "message_log",
+                                          gr::sandia_utils::MANUAL,
+                                          0,
+                                          0,
+                                          "/tmp",
+                                          "t17.msg"));
+    gr::blocks::message_debug::sptr sink_debug(gr::blocks::message_debug::make());
+
+    gr::top_block_sptr tb(gr::make_top_block("t17"));
+    tb->msg_connect(sink, "pdu", sink_debug, "store");
+    tb->start();
+    for (long i = 0; i < 100; i++) {
+        sink->_post(gr::sandia_utils::IN_KEY, pmt::from_long(i));
+    }
+    boost::this_thread::sleep(boost::posix_time::milliseconds(500));
+    tb->stop();
+    tb->wait();
+
+    gr::sandia_utils::file_source::sptr source(
+        gr::sandia_utils::file_source::make(1, "/tmp/t17.msg", "message", false, false));
+    source->set_msg_hop_period(0);
+    gr::blocks::message_debug::sptr debug(gr::blocks::message_debug::make());
+
+    gr::top_block_sptr tb2(gr::make_top_block("t17_read"));
+    tb2->msg_connect(source, "out", debug, "store");
+    tb2->start();
+    for (int i = 0; (i < 100) and (debug->num_messages() < 100); i++) {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+    tb2->stop();
+    tb2->wait();
+
+    BOOST_REQUIRE_EQUAL(debug->num_messages(), 100);
+    for (int i = 0; i < 100; i++) {
+        BOOST_REQUIRE_EQUAL(pmt::to_long(debug->get_message(i)), i);
+    }
+    BOOST_REQUIRE_EQUAL(source->tell(), 100);
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t17.msg"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t18)
+{
+    // checksum of each file's samples in its pdu
+    std::vector<float> data(1000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i;
+    }
+    gr::blocks::vector_source_f::sptr src(gr::blocks::vector_source_f::make(data));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("float",
+                                          sizeof(float),
+                                          "raw",
+                                          gr::sandia_utils::MANUAL,
+                                          500,
+                                          1000,
+                                          "/tmp",
+                                          "t_%02fd.f32"));
+    gr::blocks::message_debug::sptr debug(gr::blocks::message_debug::make());
+    sink->set_recording(true);
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+    sink->set_checksum(true);
+
+    gr::top_block_sptr tb(gr::make_top_block("t18"));
+    tb->connect(src, 0, sink, 0);
+    tb->msg_connect(sink, "pdu", debug, "store");
+    tb->run();
+
+    BOOST_REQUIRE_EQUAL(debug->num_messages(), 2);
+    for (int i = 0; i < 2; i++) {
+        pmt::pmt_t dict = pmt::car(debug->get_message(i));
+        pmt::pmt_t crc =
+            pmt::dict_ref(dict, gr::sandia_utils::CRC32C_KEY, pmt::PMT_NIL);
+        BOOST_REQUIRE_EQUAL(pmt::to_long(crc),
+                            (long)gr::sandia_utils::crc32c(
+                                0, &data[500 * i], 500 * sizeof(float)));
+    }
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.f32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_01.f32"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t19)
+{
+    // playback from a time within a later segment
+    std::vector<gr::tag_t> tags;
+    tags.push_back(gen_tag(gr::sandia_utils::RATE_KEY, pmt::from_double(1000), 0));
+    tags.push_back(gen_tag(gr::sandia_utils::RX_TIME_KEY,
+                           pmt::make_tuple(pmt::from_uint64(1000), pmt::from_double(0.0)),
+                           0));
+    tags.push_back(gen_tag(gr::sandia_utils::RATE_KEY, pmt::from_double(2000), 700));
+
+    std::vector<float> data(1000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i;
+    }
+    gr::blocks::vector_source_f::sptr src(
+        gr::blocks::vector_source_f::make(data, false, 1, tags));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("float",
+                                          sizeof(float),
+                                          "raw_header_v2",
+                                          gr::sandia_utils::MANUAL,
+                                          0,
+                                          1000,
+                                          "/tmp",
+                                          "t_%02fd.f32"));
+    sink->set_recording(true);
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+
+    gr::top_block_sptr tb(gr::make_top_block("t19"));
+    tb->connect(src, 0, sink, 0);
+    tb->run();
+
+    gr::sandia_utils::file_source::sptr source(gr::sandia_utils::file_source::make(
+        sizeof(float), "/tmp/t_00.f32", "raw_header", false, false));
+    gr::blocks::vector_sink_f::sptr dst(gr::blocks::vector_sink_f::make());
+
+    // 0.1 s into the segment starting at 1000.7 s
+    BOOST_REQUIRE_EQUAL(source->seek_time(999.0), false);
+    BOOST_REQUIRE_EQUAL(source->seek_time(1000.8), true);
+    BOOST_REQUIRE_EQUAL(source->tell(), 900);
+
+    // the source finishes once the rest of the file has been played
+    gr::top_block_sptr tb2(gr::make_top_block("t19_read"));
+    tb2->connect(source, 0, dst, 0);
+    tb2->run();
+    BOOST_REQUIRE(dst->data() == std::vector<float>(data.begin() + 900, data.end()));
+
+    // time and rate at the new position
+    std::vector<gr::tag_t> out_tags = dst->tags();
+    double time_0 = 0, rate_0 = 0;
+    for (size_t i = 0; i < out_tags.size(); i++) {
+        if (out_tags[i].offset != 0) {
+            continue;
+        }
+        if (pmt::eq(out_tags[i].key, gr::sandia_utils::RX_TIME_KEY)) {
+            time_0 = pmt::to_uint64(pmt::tuple_ref(out_tags[i].value, 0)) +
+                     pmt::to_double(pmt::tuple_ref(out_tags[i].value, 1));
+        }
+        if (pmt::eq(out_tags[i].key, gr::sandia_utils::RATE_KEY)) {
+            rate_0 = pmt::to_double(out_tags[i].value);
+        }
+    }
+    BOOST_REQUIRE_CLOSE(time_0, 1000.8, 1e-9);
+    BOOST_REQUIRE_EQUAL(rate_0, 2000);
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.f32"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t20)
+{
+    // realtime playback at the recorded rate
+    std::vector<gr::tag_t> tags;
+    tags.push_back(gen_tag(gr::sandia_utils::RATE_KEY, pmt::from_double(4000), 0));
+    tags.push_back(gen_tag(gr::sandia_utils::RX_TIME_KEY,
+                           pmt::make_tuple(pmt::from_uint64(1000), pmt::from_double(0.0)),
+                           0));
+
+    std::vector<float> data(2000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i;
+    }
+    gr::blocks::vector_source_f::sptr src(
+        gr::blocks::vector_source_f::make(data, false, 1, tags));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("float",
+                                          sizeof(float),
+                                          "raw_header",
+                                          gr::sandia_utils::MANUAL,
+                                          0,
+                                          4000,
+                                          "/tmp",
+                                          "t_%02fd.f32"));
+    sink->set_recording(true);
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+
+    gr::top_block_sptr tb(gr::make_top_block("t20"));
+    tb->connect(src, 0, sink, 0);
+    tb->run();
+
+    gr::sandia_utils::file_source::sptr source(gr::sandia_utils::file_source::make(
+        sizeof(float), "/tmp/t_00.f32", "raw_header", false, false));
+    gr::blocks::vector_sink_f::sptr dst(gr::blocks::vector_sink_f::make());
+    source->set_realtime(true);
+    BOOST_REQUIRE_EQUAL(source->get_realtime(), true);
+
+    // 2000 samples at 4 kHz take half a second, the source then waits for
+    // more files
+    gr::top_block_sptr tb2(gr::make_top_block("t20_read"));
+    tb2->connect(source, 0, dst, 0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    tb2->start();
+    for (int i = 0; (i < 400) and (dst->data().size() < data.size()); i++) {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+    }
+    double elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    tb2->stop();
+    tb2->wait();
+    BOOST_REQUIRE(dst->data() == data);
+    BOOST_REQUIRE_GE(elapsed, 0.49);
+    BOOST_REQUIRE_LT(elapsed, 1.0);
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.f32"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t21)
+{
+    // interleaved 16 bit files played as complex float, in host and swapped
+    // byte order
+    std::vector<short> data(2 * 5000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (short)((i * 7919) % 65536 - 32768);
+    }
+    std::vector<short> swapped(data.size());
+    for (size_t i = 0; i < data.size(); i++) {
+        swapped[i] = (short)((((unsigned short)data[i] & 0xff) << 8) |
+                             ((unsigned short)data[i] >> 8));
+    }
+    std::ofstream("/tmp/t_00.sc16", std::ios::binary)
+        .write((const char*)&data[0], data.size() * sizeof(short));
+    std::ofstream("/tmp/t_01.sc16", std::ios::binary)
+        .write((const char*)&swapped[0], swapped.size() * sizeof(short));
+
+    std::vector<gr_complex> expected(data.size() / 2);
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected[i] = gr_complex(data[2 * i] / 32768.0f, data[2 * i + 1] / 32768.0f);
+    }
+
+    // converted from the mapping, and staged from reads
+    const char* types[] = { "raw_mmap", "raw" };
+    for (int i = 0; i < 2; i++) {
+        gr::sandia_utils::file_source::sptr source(gr::sandia_utils::file_source::make(
+            sizeof(gr_complex), (i ? "/tmp/t_01.sc16" : "/tmp/t_00.sc16"), types[i],
+            false, false));
+        source->set_conversion("sc16", 32768.0, i == 1);
+        gr::blocks::vector_sink_c::sptr dst(gr::blocks::vector_sink_c::make());
+
+        // source waits for more files once the file has been played
+        gr::top_block_sptr tb(gr::make_top_block("t21"));
+        tb->connect(source, 0, dst, 0);
+        tb->start();
+        for (int n = 0; (n < 100) and (dst->data().size() < expected.size()); n++) {
+            boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+        }
+        tb->stop();
+        tb->wait();
+        BOOST_REQUIRE(dst->data() == expected);
+    }
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.sc16"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_01.sc16"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t22)
+{
+    // big endian bluefile with the frequency in an extended header keyword
+    std::vector<char> file(1024 + 2 * sizeof(short) * 1000, 0);
+    const uint16_t one = 1;
+    bool little = (*(const char*)&one == 1);
+    auto put = [&](size_t offset, const void* value, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            file[offset + i] = ((const char*)value)[little ? (size - 1 - i) : i];
+        }
+    };
+    memcpy(&file[0], "BLUEIEEEIEEE", 12);
+    int32_t ext_start = 1, ext_size = 24, type = 1000, lkey = 24, length = 0;
+    int16_t lext = 16;
+    double data_start = 1024, data_size = 2 * sizeof(short) * 1000, xstart = 1000.25,
+           xdelta = 1e-3, freq = 915e6;
+    put(24, &ext_start, 4);
+    put(28, &ext_size, 4);
+    put(32, &data_start, 8);
+    put(40, &data_size, 8);
+    put(48, &type, 4);
+    memcpy(&file[52], "CI", 2);
+    put(160, &length, 4);
+    put(256, &xstart, 8);
+    put(264, &xdelta, 8);
+    put(512, &lkey, 4);
+    put(516, &lext, 2);
+    file[518] = 6;
+    file[519] = 'D';
+    put(520, &freq, 8);
+    memcpy(&file[528], "RFFREQ", 6);
+
+    std::vector<short> data(2 * 1000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (short)(i * 7919);
+        put(1024 + 2 * i, &data[i], 2);
+    }
+    std::ofstream("/tmp/t_00.blue", std::ios::binary).write(&file[0], file.size());
+
+    gr::sandia_utils::file_source::sptr source(gr::sandia_utils::file_source::make(
+        2 * sizeof(short), "/tmp/t_00.blue", "bluefile", false, false));
+    gr::blocks::vector_sink_s::sptr dst(gr::blocks::vector_sink_s::make(2));
+    gr::top_block_sptr tb(gr::make_top_block("t22"));
+    tb->connect(source, 0, dst, 0);
+    tb->start();
+    for (int i = 0; (i < 100) and (dst->data().size() < data.size()); i++) {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+    tb->stop();
+    tb->wait();
+    BOOST_REQUIRE(dst->data() == data);
+
+    double time_0 = 0, rate_0 = 0, freq_0 = 0;
+    std::vector<gr::tag_t> out_tags = dst->tags();
+    for (size_t i = 0; i < out_tags.size(); i++) {
+        if (pmt::eq(out_tags[i].key, gr::sandia_utils::RX_TIME_KEY)) {
+            time_0 = pmt::to_uint64(pmt::tuple_ref(out_tags[i].value, 0)) +
+                     pmt::to_double(pmt::tuple_ref(out_tags[i].value, 1));
+        } else if (pmt::eq(out_tags[i].key, gr::sandia_utils::RATE_KEY)) {
+            rate_0 = pmt::to_double(out_tags[i].value);
+        } else if (pmt::eq(out_tags[i].key, gr::sandia_utils::FREQ_KEY)) {
+            freq_0 = pmt::to_double(out_tags[i].value);
+        }
+    }
+    BOOST_REQUIRE_CLOSE(time_0, 1000.25, 1e-9);
+    BOOST_REQUIRE_CLOSE(rate_0, 1000, 1e-9);
+    BOOST_REQUIRE_EQUAL(freq_0, 915e6);
+
+    // only type 1000 files are read
+    type = 2000;
+    put(48, &type, 4);
+    std::ofstream("/tmp/t_00.blue", std::ios::binary).write(&file[0], file.size());
+    gr::logger_ptr logger, debug_logger;
+    gr::configure_default_loggers(logger, debug_logger, "t22");
+    file_reader_bluefile reader(2 * sizeof(short), logger);
+    BOOST_REQUIRE_THROW(reader.open("/tmp/t_00.blue"), std::runtime_error);
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.blue"), true);
+}
+
+// configuration changes are ordered with queued background I/O
+struct file_record {
+    std::vector<double> freqs;
+    std::vector<double> rates;
+    void update(std::string fname, epoch_time time, double freq, double rate, int64_t crc)
+    {
+        freqs.push_back(freq);
+        rates.push_back(rate);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(t23)
+{
+    gr::logger_ptr logger, debug_logger;
+    gr::configure_default_loggers(logger, debug_logger, "t23");
+
+    file_writer_base::sptr writer(file_writer_base::make(
+        "complex", "raw", sizeof(gr_complex), 0, 1000, "/tmp", "t_%02fd.fc32", logger));
+    file_record record;
+    writer->register_callback(boost::bind(&file_record::update, &record, _1, _2, _3, _4, _5));
+    writer->set_gen_new_folder(false);
+    writer->set_freq(1000000000);
+    writer->set_async(true, 4, 64 * sizeof(gr_complex), false);
+
+    // the new settings are requested while the first file is still queued
+    std::vector<gr_complex> data(1000);
+    writer->start(epoch_time(1000.0));
+    writer->write(&data[0], data.size());
+    writer->stop();
+    writer->set_freq(2000000000);
+    writer->set_rate(2000);
+    BOOST_REQUIRE_EQUAL(writer->get_freq(), uint64_t(2000000000));
+    BOOST_REQUIRE_EQUAL(writer->get_rate(), 2000);
+    writer->start(epoch_time(1001.0));
+    writer->write(&data[0], data.size());
+    writer->stop();
+    writer->flush();
+
+    BOOST_REQUIRE_EQUAL(record.freqs.size(), size_t(2));
+    BOOST_REQUIRE_EQUAL(record.freqs[0], 1e9);
+    BOOST_REQUIRE_EQUAL(record.rates[0], 1000);
+    BOOST_REQUIRE_EQUAL(record.freqs[1], 2e9);
+    BOOST_REQUIRE_EQUAL(record.rates[1], 2000);
+    BOOST_REQUIRE_EQUAL(writer->get_nerrors(), uint64_t(0));
+
+    writer->set_async(false);
+
+    // failures in the I/O thread are counted
+    file_writer_base::sptr missing(file_writer_base::make(
+        "complex", "raw", sizeof(gr_complex), 0, 1000, "/tmp/t23_missing", "t_%02fd.fc32", logger));
+    missing->set_async(true, 4, 64 * sizeof(gr_complex), false);
+    missing->start(epoch_time(1002.0));
+    missing->flush();
+    BOOST_REQUIRE_EQUAL(missing->get_nerrors(), uint64_t(1));
+    missing->set_async(false);
+
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.fc32"), true);
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_01.fc32"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t24)
+{
+    // direct I/O files that are not a multiple of the alignment
+    std::vector<gr_complex> data(2500);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = gr_complex(i, -(float)i);
+    }
+    gr::blocks::vector_source_c::sptr src(gr::blocks::vector_source_c::make(data));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("complex",
+                                          sizeof(gr_complex),
+                                          "raw_direct",
+                                          gr::sandia_utils::MANUAL,
+                                          1000,
+                                          1000,
+                                          "/tmp",
+                                          "t_%02fd.fc32"));
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+    sink->set_preallocate(true);
+    sink->set_recording(true);
+
+    gr::top_block_sptr tb(gr::make_top_block("t24"));
+    tb->connect(src, 0, sink, 0);
+    tb->run();
+
+    // last file is closed early and truncated to the data written
+    size_t nitems[3] = { 1000, 1000, 500 };
+    for (int f = 0; f < 3; f++) {
+        std::string fname = str(boost::format("/tmp/t_%02d.fc32") % f);
+        BOOST_REQUIRE_EQUAL(boost::filesystem::file_size(fname),
+                            nitems[f] * sizeof(gr_complex));
+
+        std::vector<gr_complex> file_data(nitems[f]);
+        std::ifstream(fname.c_str(), std::ios::binary)
+            .read((char*)&file_data[0], file_data.size() * sizeof(gr_complex));
+        BOOST_REQUIRE(std::equal(
+            file_data.begin(), file_data.end(), data.begin() + 1000 * f));
+        BOOST_REQUIRE_EQUAL(remove_file(fname), true);
+    }
+}
+
+#ifdef HAVE_LIBURING
+BOOST_AUTO_TEST_CASE(t25)
+{
+    // io_uring files are complete and truncated once closed
+    std::vector<gr_complex> data(2500);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = gr_complex(i, -(float)i);
+    }
+    gr::blocks::vector_source_c::sptr src(gr::blocks::vector_source_c::make(data));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("complex",
+                                          sizeof(gr_complex),
+                                          "uring",
+                                          gr::sandia_utils::MANUAL,
+                                          1000,
+                                          1000,
+                                          "/tmp",
+                                          "t_%02fd.fc32"));
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+    sink->set_recording(true);
+
+    gr::top_block_sptr tb(gr::make_top_block("t25"));
+    tb->connect(src, 0, sink, 0);
+    tb->run();
+
+    size_t nitems[3] = { 1000, 1000, 500 };
+    for (int f = 0; f < 3; f++) {
+        std::string fname = str(boost::format("/tmp/t_%02d.fc32") % f);
+        BOOST_REQUIRE_EQUAL(boost::filesystem::file_size(fname),
+                            nitems[f] * sizeof(gr_complex));
+
+        std::vector<gr_complex> file_data(nitems[f]);
+        std::ifstream(fname.c_str(), std::ios::binary)
+            .read((char*)&file_data[0], file_data.size() * sizeof(gr_complex));
+        BOOST_REQUIRE(std::equal(
+            file_data.begin(), file_data.end(), data.begin() + 1000 * f));
+        BOOST_REQUIRE_EQUAL(remove_file(fname), true);
+    }
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(t26)
+{
+    // compiled name specifiers match the names generated by substituting and
+    // formatting the whole specifier for every file
+    struct {
+        const char* spec;
+        uint64_t file_num;
+        uint64_t epoch_sec;
+        const char* name;
+    } cases[] = {
+        { "t_%fd.dat", 7, 0, "/tmp/t_00007.dat" },
+        { "t_%fd.dat", 123456, 1600000000, "/tmp/t_23456.dat" },
+        { "t_%3fd.dat", 7, 0, "/tmp/t_  7.dat" },
+        { "t_%3fd.dat", 123456, 1600000000, "/tmp/t_456.dat" },
+        { "t_%03fd.dat", 7, 0, "/tmp/t_007.dat" },
+        { "t_%fd_%fd.dat", 123456, 1600000000, "/tmp/t_23456_23456.dat" },
+        { "t_%02fd_%02fd.dat", 7, 0, "/tmp/t_07_07.dat" },
+        { "%Y_%Y_%fd.dat", 123456, 1600000000, "/tmp/2020_2020_23456.dat" },
+        { "%Y%m%d_%H_%M_%S_%j_%y.dat", 7, 0, "/tmp/19700101_00_00_00_001_70.dat" },
+        { "%Y%m%d_%H_%M_%S_%j_%y.dat",
+          123456,
+          1600000000,
+          "/tmp/20200913_12_26_40_257_20.dat" },
+        { "%F_%T_%a_%b_%3fd.dat",
+          123456,
+          1600000000,
+          "/tmp/2020-09-13_12:26:40_Sun_Sep_456.dat" },
+        { "%Y%m%d_%H_%M_%S_fc=%fcMMHz_fs=%fskkHz_%06fd.dat",
+          123456,
+          1600000000,
+          "/tmp/20200913_12_26_40_fc=915MHz_fs=2000kHz_123456.dat" },
+        { "t_%fcc_%fsc_%%_%fd", 7, 0, "/tmp/t_915000000_2000000_%_00007" },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        file_name_spec spec;
+        spec.compile(cases[i].spec, "/tmp", 915000000, 2000000);
+        std::string fname;
+        spec.render(fname, cases[i].file_num, cases[i].epoch_sec);
+        BOOST_REQUIRE_EQUAL(fname, std::string(cases[i].name));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(t27)
+{
+    // advancing by samples is exact over long runs
+    epoch_time t(1000, 0.25);
+    t.set_rate(30.72e6);
+    for (int i = 0; i < 10000000; i++) {
+        t.advance(30720);
+    }
+    BOOST_REQUIRE_EQUAL(t.epoch_sec(), uint64_t(11000));
+    BOOST_REQUIRE_EQUAL(t.epoch_frac(), 0.25);
+    t.advance(10240000);
+    BOOST_REQUIRE_EQUAL(t.epoch_sec(), uint64_t(11000));
+    BOOST_REQUIRE_CLOSE(t.epoch_frac(), 0.25 + 1.0 / 3.0, 1e-10);
+
+    // non-integer rates are kept as thousandths of a sample per second
+    epoch_time u(1000, 0.25);
+    u.set_rate(1000.5);
+    for (int i = 0; i < 1000000; i++) {
+        u.advance(2001);
+    }
+    BOOST_REQUIRE_EQUAL(u.epoch_sec(), uint64_t(2001000));
+    BOOST_REQUIRE_EQUAL(u.epoch_frac(), 0.25);
+    u.advance(1);
+    BOOST_REQUIRE_CLOSE(u.epoch_frac(), 0.25 + 1.0 / 1000.5, 1e-10);
+
+    // rewinding borrows from the whole seconds
+    epoch_time v(1000, 0.25);
+    v.set_rate(1000);
+    v.advance(500);
+    v.rewind(800);
+    BOOST_REQUIRE_EQUAL(v.epoch_sec(), uint64_t(999));
+    BOOST_REQUIRE_CLOSE(v.epoch_frac(), 0.95, 1e-10);
+    v.rewind(2000);
+    BOOST_REQUIRE_EQUAL(v.epoch_sec(), uint64_t(997));
+    BOOST_REQUIRE_CLOSE(v.epoch_frac(), 0.95, 1e-10);
+    v.advance(2300);
+    BOOST_REQUIRE_EQUAL(v.epoch_sec(), uint64_t(1000));
+    BOOST_REQUIRE_EQUAL(v.epoch_frac(), 0.25);
+}
+
+BOOST_AUTO_TEST_CASE(t28)
+{
+    // messages logged 200 ms apart reach the file without another message
+    // or a flush, and are replayed at their recorded timing
+    gr::logger_ptr logger, debug_logger;
+    gr::configure_default_loggers(logger, debug_logger, "t28");
+    message_log_writer writer(true, true, logger);
+    writer.open("/tmp/t28.msg");
+    for (long i = 0; i < 3; i++) {
+        if (i) {
+            boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+        }
+        writer.write(pmt::from_long(i));
+    }
+    boost::this_thread::sleep(boost::posix_time::milliseconds(1500));
+
+    message_log_reader reader(logger);
+    reader.open("/tmp/t28.msg");
+    BOOST_REQUIRE(reader.has_timestamps());
+    pmt::pmt_t msg;
+    uint64_t times[3];
+    for (long i = 0; i < 3; i++) {
+        BOOST_REQUIRE(reader.next(msg, times[i]));
+        BOOST_REQUIRE_EQUAL(pmt::to_long(msg), i);
+    }
+    BOOST_REQUIRE_GE(times[1] - times[0], uint64_t(200000000));
+    BOOST_REQUIRE_GE(times[2] - times[1], uint64_t(200000000));
+    reader.close();
+    writer.close();
+
+    gr::sandia_utils::file_source::sptr source(
+        gr::sandia_utils::file_source::make(1, "/tmp/t28.msg", "message", false, false));
+    source->set_msg_recorded_timing(true);
+    gr::blocks::message_debug::sptr debug(gr::blocks::message_debug::make());
+
+    gr::top_block_sptr tb(gr::make_top_block("t28"));
+    tb->msg_connect(source, "out", debug, "store");
+    std::chrono::steady_clock::time_point arrival[3];
+    tb->start();
+    for (int i = 0; (i < 400) and (debug->num_messages() < 3); i++) {
+        for (int n = 0; n < debug->num_messages(); n++) {
+            if (arrival[n] == std::chrono::steady_clock::time_point()) {
+                arrival[n] = std::chrono::steady_clock::now();
+            }
+        }
+        boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+    }
+    arrival[2] = std::chrono::steady_clock::now();
+    tb->stop();
+    tb->wait();
+
+    BOOST_REQUIRE_EQUAL(debug->num_messages(), 3);
+    for (int i = 0; i < 3; i++) {
+        BOOST_REQUIRE_EQUAL(pmt::to_long(debug->get_message(i)), i);
+    }
+    BOOST_REQUIRE_GE(
+        std::chrono::duration_cast<std::chrono::milliseconds>(arrival[1] - arrival[0]).count(),
+        150);
+    BOOST_REQUIRE_GE(
+        std::chrono::duration_cast<std::chrono::milliseconds>(arrival[2] - arrival[0]).count(),
+        350);
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t28.msg"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t29)
+{
+    // seek and tell through the index, and by reading records without it
+    gr::logger_ptr logger, debug_logger;
+    gr::configure_default_loggers(logger, debug_logger, "t29");
+    const uint64_t nmessages = 3 * MESSAGE_LOG_INDEX_INTERVAL + 100;
+    message_log_writer writer(true, true, logger);
+    writer.open("/tmp/t29.msg");
+    for (uint64_t i = 0; i < nmessages; i++) {
+        writer.write(pmt::from_uint64(i));
+    }
+    writer.flush();
+
+    const uint64_t targets[] = { 0,
+                                 1,
+                                 MESSAGE_LOG_INDEX_INTERVAL - 1,
+                                 MESSAGE_LOG_INDEX_INTERVAL,
+                                 2 * MESSAGE_LOG_INDEX_INTERVAL + 17,
+                                 5,
+                                 nmessages - 1 };
+    for (int closed = 0; closed < 2; closed++) {
+        if (closed) {
+            writer.close();
+        }
+
+        message_log_reader reader(logger);
+        reader.open("/tmp/t29.msg");
+        BOOST_REQUIRE_EQUAL(reader.nmessages(), closed ? nmessages : 0);
+
+        pmt::pmt_t msg;
+        uint64_t time;
+        for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+            BOOST_REQUIRE(reader.seek(targets[i]));
+            BOOST_REQUIRE_EQUAL(reader.tell(), targets[i]);
+            BOOST_REQUIRE(reader.next(msg, time));
+            BOOST_REQUIRE_EQUAL(pmt::to_uint64(msg), targets[i]);
+            BOOST_REQUIRE_EQUAL(reader.tell(), targets[i] + 1);
+        }
+
+        // the end of the log can be reached but not passed
+        BOOST_REQUIRE(reader.seek(nmessages));
+        BOOST_REQUIRE(not reader.next(msg, time));
+        BOOST_REQUIRE(not reader.seek(nmessages + 1));
+    }
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t29.msg"), true);
+}
+
+BOOST_AUTO_TEST_CASE(t30)
+{
+    // CRC32C check value, and the hardware and table implementations
+    // agree for any alignment, length and split of the data
+    const char* check = "123456789";
+    BOOST_REQUIRE_EQUAL(crc32c(0, check, strlen(check)), uint32_t(0xe3069283));
+    BOOST_REQUIRE_EQUAL(crc32c_table(0, check, strlen(check)), uint32_t(0xe3069283));
+    BOOST_REQUIRE_EQUAL(crc32c(crc32c(0, check, 4), check + 4, 5), uint32_t(0xe3069283));
+
+    std::vector<unsigned char> buf(4096 + 8);
+    for (size_t i = 0; i < buf.size(); i++) {
+        buf[i] = (unsigned char)((i * 131) ^ (i >> 3));
+    }
+    const size_t lengths[] = { 0, 1, 3, 7, 8, 9, 15, 17, 63, 1001, 4095 };
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+            const unsigned char* p = &buf[offset];
+            size_t n = lengths[i];
+            uint32_t crc = crc32c(0, p, n);
+            BOOST_REQUIRE_EQUAL(crc, crc32c_table(0, p, n));
+            BOOST_REQUIRE_EQUAL(crc32c(crc32c(0, p, n / 3), p + n / 3, n - n / 3), crc);
+        }
+    }
+}
+
+#ifdef HAVE_BLUEFILE_LIB
+BOOST_AUTO_TEST_CASE(t31)
+{
+    // bluefile written by the sink is read back with its start time and
+    // frequency keyword
+    std::vector<gr::tag_t> tags;
+    tags.push_back(gen_tag(gr::sandia_utils::RATE_KEY, pmt::from_double(1000), 0));
+    tags.push_back(gen_tag(gr::sandia_utils::RX_TIME_KEY,
+                           pmt::make_tuple(pmt::from_uint64(1000), pmt::from_double(0.25)),
+                           0));
+    tags.push_back(gen_tag(gr::sandia_utils::FREQ_KEY, pmt::from_double(915e6), 0));
+
+    std::vector<short> data(2 * 1000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (short)(i * 7919);
+    }
+    gr::blocks::vector_source_s::sptr src(
+        gr::blocks::vector_source_s::make(data, false, 2, tags));
+    gr::sandia_utils::file_sink::sptr sink(
+        gr::sandia_utils::file_sink::make("complex_int",
+                                          2 * sizeof(short),
+                                          "bluefile",
+                                          gr::sandia_utils::MANUAL,
+                                          0,
+                                          1000,
+                                          "/tmp",
+                                          "t_%02fd.blue"));
+    sink->set_recording(true);
+    sink->set_second_align(false);
+    sink->set_gen_new_folder(false);
+
+    gr::top_block_sptr tb(gr::make_top_block("t31"));
+    tb->connect(src, 0, sink, 0);
+    tb->run();
+
+    gr::logger_ptr logger, debug_logger;
+    gr::configure_default_loggers(logger, debug_logger, "t31");
+    file_reader_bluefile reader(2 * sizeof(short), logger);
+    reader.open("/tmp/t_00.blue");
+    BOOST_REQUIRE_EQUAL(reader.nitems(), uint64_t(1000));
+
+    double freq = 0;
+    BOOST_REQUIRE(reader.keyword("RFFREQ", freq));
+    BOOST_REQUIRE_EQUAL(freq, 915e6);
+
+    double time_0 = 0, rate_0 = 0;
+    std::vector<gr::tag_t> file_tags = reader.get_tags();
+    for (size_t i = 0; i < file_tags.size(); i++) {
+        if (pmt::eq(file_tags[i].key, gr::sandia_utils::RX_TIME_KEY)) {
+            time_0 = pmt::to_uint64(pmt::tuple_ref(file_tags[i].value, 0)) +
+                     pmt::to_double(pmt::tuple_ref(file_tags[i].value, 1));
+        } else if (pmt::eq(file_tags[i].key, gr::sandia_utils::RATE_KEY)) {
+            rate_0 = pmt::to_double(file_tags[i].value);
+        }
+    }
+    BOOST_REQUIRE_CLOSE(time_0, 1000.25, 1e-9);
+    BOOST_REQUIRE_CLOSE(rate_0, 1000, 1e-9);
+
+    std::vector<short> read(data.size());
+    int nread = 0, n;
+    while ((nread < 1000) and ((n = reader.read((char*)&read[2 * nread], 1000 - nread)) > 0)) {
+        nread += n;
+    }
+    BOOST_REQUIRE_EQUAL(nread, 1000);
+    BOOST_REQUIRE(read == data);
+    reader.close();
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.blue"), true);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(t32)
+{
+    // positions past 4 GiB, in a sparse file holding a single item there
+    const uint64_t item = (uint64_t(1) << 32) / sizeof(uint64_t) + 5;
+    const uint64_t value = 0x0123456789abcdefULL;
+    {
+        std::ofstream file("/tmp/t_00.u64", std::ios::binary);
+        file.seekp(item * sizeof(uint64_t));
+        file.write((const char*)&value, sizeof(value));
+        BOOST_REQUIRE(file.good());
+    }
+
+    gr::logger_ptr logger, debug_logger;
+    gr::configure_default_loggers(logger, debug_logger, "t32");
+
+    // read through the file and from the mapping
+    for (int mm = 0; mm < 2; mm++) {
+        file_reader_base::sptr reader(
+            mm ? new file_reader_mmap(sizeof(uint64_t), false, logger)
+               : new file_reader_base(sizeof(uint64_t), logger));
+        reader->open("/tmp/t_00.u64");
+        BOOST_REQUIRE_EQUAL(reader->nitems(), item + 1);
+
+        uint64_t read[2] = { 1, 1 };
+        BOOST_REQUIRE(reader->seek(item - 1, SEEK_SET));
+        BOOST_REQUIRE_EQUAL(reader->tell(), item - 1);
+        BOOST_REQUIRE_EQUAL(reader->read((char*)read, 2), 2);
+        BOOST_REQUIRE_EQUAL(read[0], uint64_t(0));
+        BOOST_REQUIRE_EQUAL(read[1], value);
+        BOOST_REQUIRE(reader->eof());
+
+        BOOST_REQUIRE(reader->seek(-1, SEEK_END));
+        BOOST_REQUIRE_EQUAL(reader->tell(), item);
+        read[1] = 0;
+        BOOST_REQUIRE_EQUAL(reader->read((char*)&read[1], 1), 1);
+        BOOST_REQUIRE_EQUAL(read[1], value);
+        reader->close();
+    }
+
+    // clean up
+    BOOST_REQUIRE_EQUAL(remove_file("/tmp/t_00.u64"), true);
+}
+
 } // namespace sandia_utils
 } // namespace gr
@@ -0,0 +1,53 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2018, 2019, 2020 National Technology & Engineering Solutions of Sandia, LLC
+ * (NTESS). Under the terms of Contract DE-NA0003525 with NTESS, the U.S. Government
+ * retains certain rights in this software.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_SANDIA_UTILS_RAW_HEADER_FORMAT_H
+#define INCLUDED_SANDIA_UTILS_RAW_HEADER_FORMAT_H
+
+#include <stdint.h>           /* uint64_t */
+
+/*
+ * Raw IQ + Header capture format
+ *
+ * A version 1 file holds the frequency, rate and start time of its first
+ * sample as three doubles, followed by the samples.  A version 2 file has
+ * the same layout, with a segment index and trailer appended when the file
+ * is closed.  Each segment gives the frequency, rate and time from one
+ * sample onward; the first segment starts at sample 0 and matches the
+ * header.  A version 2 file that was never closed reads as version 1.  All
+ * values are in host byte order.
+ */
+#define RAW_HEADER_TRAILER_MAGIC "SURHIDX2"
+#define RAW_HEADER_FORMAT_VERSION 2
+
+namespace gr
+{
+  namespace sandia_utils
+  {
+    struct raw_header_segment_t {
+      // first sample of the segment
+      uint64_t sample;
+      // frequency, rate and time of that sample, as in the header
+      double metadata[3];
+    };
+
+    struct raw_header_trailer_t {
+      // bytes of samples following the header
+      uint64_t data_size;
+      // segments in the index, which directly precedes the trailer
+      uint64_t nsegments;
+      uint32_t version;
+      uint32_t reserved;
+      char magic[8];
+    };
+
+  } // namespace sandia_utils
+} // namespace gr
+
+#endif /* INCLUDED_SANDIA_UTILS_RAW_HEADER_FORMAT_H */
@@ -12,6 +12,9 @@ from gnuradio import gr, gr_unittest
 from gnuradio import blocks
 import sandia_utils_swig as sandia_utils
 import pdu_utils
+import os
+import pmt
+import struct
 import time
 
 class qa_file_source(gr_unittest.TestCase):
@@ -36,6 +39,59 @@ class qa_file_source(gr_unittest.TestCase):
         
         self.assertTrue(True)
 
+    def test_002_mmap (self):
+        data = list(range(1000))
+        fname = '/tmp/qa_file_source_mmap.dat'
+
+        # header is frequency, rate and start time
+        with open(fname, 'wb') as f:
+            f.write(struct.pack('3d', 100e6, 1e6, 1.5))
+            f.write(struct.pack('%df' % len(data), *data))
+
+        dut = sandia_utils.file_source(gr.sizeof_float, fname, 'raw_header_mmap', False, False)
+        dut.add_file_tags(True)
+        snk = blocks.vector_sink_f()
+        self.tb.connect(dut, snk)
+
+        # source finishes once the file has been played
+        self.tb.run()
+
+        self.assertFloatTuplesAlmostEqual(snk.data(), data)
+        keys = [pmt.symbol_to_string(t.key) for t in snk.tags()]
+        self.assertTrue('rx_freq' in keys)
+        self.assertTrue('rx_rate' in keys)
+        self.assertTrue('rx_time' in keys)
+        os.remove(fname)
+
+    def test_003_prefetch (self):
+        nfiles = 5
+        fnames = ['/tmp/qa_file_source_prefetch_%d.dat' % i for i in range(nfiles)]
+        data = list(range(nfiles * 1000))
+        for i, fname in enumerate(fnames):
+            with open(fname, 'wb') as f:
+                f.write(struct.pack('1000f', *data[i * 1000:(i + 1) * 1000]))
+
+        dut = sandia_utils.file_source(gr.sizeof_float, '', 'raw', False, False)
+        dut.set_prefetch_depth(2)
+        self.assertEqual(dut.get_prefetch_depth(), 2)
+        for fname in fnames:
+            dut.open(fname, False)
+        snk = blocks.vector_sink_f()
+        self.tb.connect(dut, snk)
+
+        # source waits for more files once the queue is empty
+        self.tb.start()
+        for i in range(100):
+            if len(snk.data()) >= len(data):
+                break
+            time.sleep(.05)
+        self.tb.stop()
+        self.tb.wait()
+
+        self.assertFloatTuplesAlmostEqual(snk.data(), data)
+        for fname in fnames:
+            os.remove(fname)
+
 
 if __name__ == '__main__':
     gr_unittest.run(qa_file_source)